@@ -0,0 +1,123 @@
+//
+// Throughput of a ping-pong store kept in a file through the file/mmap
+// backend. Run it once on tmpfs and once on a disk backed filesystem to
+// see what the page cache and msync() cost. Results are printed in JSON.
+//
+// usage: file_bench <path> [saves] [erase unit] [data size] [sync every write]
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+#include "wearleveling.h"
+#include "wearleveling_file.h"
+
+namespace
+{
+    wearleveling_file_typeDef file;
+    WEARLEVELING_FILE_DEFINE_CALLBACKS(bench, &file)
+
+    double secondsSince(const std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <path> [saves] [erase unit] [data size] [sync every write]\n", argv[0]);
+        return 1;
+    }
+
+    const char * const PATH = argv[1];
+    const uint32_t NUM_OF_SAVES = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 0) : 200000U;
+    const uint32_t ERASE_UNIT = argc > 3 ? (uint32_t)strtoul(argv[3], NULL, 0) : 65536U;
+    const uint16_t DATA_SIZE = argc > 4 ? (uint16_t)strtoul(argv[4], NULL, 0) : 32U;
+    const uint8_t IS_SYNC = argc > 5 ? (uint8_t)strtoul(argv[5], NULL, 0) : 0U;
+
+    /* a page is addressed with 16 bits, larger erase units leave the tail unused */
+    const uint16_t PAGE_CAPACITY = ERASE_UNIT > 0xFFFE ? (uint16_t)0xFFFE : (uint16_t)ERASE_UNIT;
+    if ((DATA_SIZE == 0) || ((uint32_t)DATA_SIZE + 8 > PAGE_CAPACITY))
+    {
+        fprintf(stderr, "invalid erase unit or data size\n");
+        return 1;
+    }
+
+    const wearleveling_file_params_typeDef FILE_PARAMS = { ERASE_UNIT * 2, ERASE_UNIT, IS_SYNC };
+    unlink(PATH);
+    if (wearleveling_file_open(&file, PATH, &FILE_PARAMS) == 0)
+    {
+        fprintf(stderr, "cannot open %s\n", PATH);
+        return 1;
+    }
+
+    wearleveling_params_typeDef params =
+    {
+        .pageCapacityInByte = PAGE_CAPACITY,
+        .dataSizeInByte = DATA_SIZE,
+        .readTwoByte = bench_readTwoByte,
+        .writeTwoByte = bench_writeTwoByte,
+        .pageErase = bench_pageErase,
+    };
+
+    wearleveling_sector_params_typeDef sectorParams =
+    {
+        .spareSectorAddr = ERASE_UNIT,
+        .sectorErase = bench_sectorErase,
+    };
+
+    wearleveling_state_typeDef state;
+    wearleveling_handle_typeDef handle = wearleveling_v2_constructPingPong(&state, &params, &sectorParams);
+    if (handle == NULL)
+    {
+        fprintf(stderr, "cannot construct the store\n");
+        return 1;
+    }
+
+    std::vector<uint8_t> data(DATA_SIZE);
+    uint32_t numOfFailedSaves = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < NUM_OF_SAVES; i++)
+    {
+        memcpy(data.data(), &i, DATA_SIZE < sizeof(i) ? DATA_SIZE : sizeof(i));
+        if (wearleveling_v2_save(handle, data.data()) == 0) numOfFailedSaves++;
+    }
+    const double SAVE_SECONDS = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < NUM_OF_SAVES; i++)
+    {
+        wearleveling_v2_read(handle, data.data());
+    }
+    const double READ_SECONDS = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    handle = wearleveling_v2_constructPingPong(&state, &params, &sectorParams);
+    const double MOUNT_SECONDS = secondsSince(start);
+
+    const uint32_t NUM_OF_REJECTED = file.numOfRejectedWrites;
+    wearleveling_file_close(&file);
+    unlink(PATH);
+
+    printf("{\n");
+    printf("  \"path\": \"%s\",\n", PATH);
+    printf("  \"saves\": %u,\n", NUM_OF_SAVES);
+    printf("  \"erase_unit\": %u,\n", ERASE_UNIT);
+    printf("  \"data_size\": %u,\n", DATA_SIZE);
+    printf("  \"sync_every_write\": %u,\n", IS_SYNC);
+    printf("  \"failed_saves\": %u,\n", numOfFailedSaves);
+    printf("  \"rejected_writes\": %u,\n", NUM_OF_REJECTED);
+    printf("  \"saves_per_second\": %.0f,\n", NUM_OF_SAVES / SAVE_SECONDS);
+    printf("  \"save_bytes_per_second\": %.0f,\n", ((double)NUM_OF_SAVES * DATA_SIZE) / SAVE_SECONDS);
+    printf("  \"reads_per_second\": %.0f,\n", NUM_OF_SAVES / READ_SECONDS);
+    printf("  \"mount_us\": %.1f\n", MOUNT_SECONDS * 1e6);
+    printf("}\n");
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+//
+// RAM per store, the usual wearleveling_v2 state against the compact one
+// that shares a const device object. For 1 to 10000 stores every compact
+// store is constructed on its own page of a simulated device, saved and
+// read back, so the numbers are for stores that work. Results are printed
+// in JSON.
+//
+// usage: memory_bench [page size] [data size]
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "wearleveling.h"
+#include "wearleveling_compact.h"
+
+namespace
+{
+    std::vector<uint8_t> flash;
+    uint16_t pageSize = 64;
+
+    uint16_t device_readTwoByte(uint32_t addr)
+    {
+        return (uint16_t)(flash[addr] | (flash[addr + 1] << 8));
+    }
+
+    uint8_t device_writeTwoByte(uint32_t addr, uint16_t data)
+    {
+        flash[addr] &= (uint8_t)data;
+        flash[addr + 1] &= (uint8_t)(data >> 8);
+        return 1;
+    }
+
+    uint8_t device_pageErase(uint32_t addr)
+    {
+        memset(flash.data() + addr, 0xFF, pageSize);
+        return 1;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    pageSize = argc > 1 ? (uint16_t)strtoul(argv[1], NULL, 0) : 64U;
+    const uint16_t DATA_SIZE = argc > 2 ? (uint16_t)strtoul(argv[2], NULL, 0) : 8U;
+
+    const wearleveling_compact_device_typeDef DEVICE =
+    {
+        .pageCapacityInByte = pageSize,
+        .dataSizeInByte = DATA_SIZE,
+        .readTwoByte = device_readTwoByte,
+        .writeTwoByte = device_writeTwoByte,
+        .pageErase = device_pageErase,
+    };
+
+    if (wearleveling_compact_getNumOfBuckets(&DEVICE) == 0)
+    {
+        fprintf(stderr, "invalid page size or data size\n");
+        return 1;
+    }
+
+    const uint32_t COUNTS[] = { 1, 10, 100, 1000, 10000 };
+    const uint32_t NUM_OF_COUNTS = sizeof(COUNTS) / sizeof(COUNTS[0]);
+    std::vector<uint8_t> data(DATA_SIZE);
+    std::vector<uint8_t> dataRead(DATA_SIZE);
+
+    printf("{\n");
+    printf("  \"page_size\": %u,\n", pageSize);
+    printf("  \"data_size\": %u,\n", DATA_SIZE);
+    printf("  \"v2_state_bytes\": %u,\n", (uint32_t)sizeof(wearleveling_state_typeDef));
+    printf("  \"compact_state_bytes\": %u,\n", (uint32_t)sizeof(wearleveling_compact_state_typeDef));
+    printf("  \"compact_device_bytes\": %u,\n", (uint32_t)sizeof(wearleveling_compact_device_typeDef));
+    printf("  \"runs\": [\n");
+
+    for(uint32_t c = 0; c < NUM_OF_COUNTS; c++)
+    {
+        const uint32_t NUM_OF_STORES = COUNTS[c];
+        flash.assign((size_t)NUM_OF_STORES * pageSize, 0xFF);
+        std::vector<wearleveling_compact_state_typeDef> stores(NUM_OF_STORES);
+        uint32_t numOfFailed = 0;
+
+        for(uint32_t i = 0; i < NUM_OF_STORES; i++)
+        {
+            memcpy(data.data(), &i, DATA_SIZE < sizeof(i) ? DATA_SIZE : sizeof(i));
+            if (wearleveling_compact_construct(&DEVICE, &stores[i], (uint16_t)i) == 0) numOfFailed++;
+            else if (wearleveling_compact_save(&DEVICE, &stores[i], data.data()) == 0) numOfFailed++;
+        }
+
+        for(uint32_t i = 0; i < NUM_OF_STORES; i++)
+        {
+            memcpy(data.data(), &i, DATA_SIZE < sizeof(i) ? DATA_SIZE : sizeof(i));
+            if ((wearleveling_compact_read(&DEVICE, &stores[i], dataRead.data()) == 0) || (memcmp(data.data(), dataRead.data(), DATA_SIZE) != 0)) numOfFailed++;
+        }
+
+        const uint64_t V2_BYTES = (uint64_t)NUM_OF_STORES * sizeof(wearleveling_state_typeDef);
+        const uint64_t COMPACT_BYTES = ((uint64_t)NUM_OF_STORES * sizeof(wearleveling_compact_state_typeDef)) + sizeof(wearleveling_compact_device_typeDef);
+
+        printf("    { \"stores\": %u, \"failed\": %u, \"v2_bytes\": %llu, \"compact_bytes\": %llu, \"compact_bytes_per_store\": %.2f }%s\n",
+            NUM_OF_STORES, numOfFailed, (unsigned long long)V2_BYTES, (unsigned long long)COMPACT_BYTES,
+            (double)COMPACT_BYTES / NUM_OF_STORES, (c + 1) < NUM_OF_COUNTS ? "," : "");
+    }
+
+    printf("  ]\n");
+    printf("}\n");
+    return 0;
+}
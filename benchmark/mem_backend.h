@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//
+// In-memory NOR page for the benchmarks. Included by micro_bench for the
+// callback build and, through WEARLEVELING_BACKEND_HEADER, by wearleveling.c
+// itself for micro_bench_static, so both builds run the very same backend.
+// unit_test_static tests the library against it the same way.
+//
+#define MEM_BACKEND_MAX_PAGE_SIZE   (0xFFFEU)
+
+extern uint8_t mem_flash[MEM_BACKEND_MAX_PAGE_SIZE];
+extern uint32_t mem_flashSize;
+
+static inline uint16_t mem_readTwoByte(uint32_t addr)
+{
+    if ((addr + 1) >= mem_flashSize) return 0;
+    return (uint16_t)(mem_flash[addr] | (mem_flash[addr + 1] << 8));
+}
+
+static inline uint8_t mem_writeTwoByte(uint32_t addr, uint16_t data)
+{
+    if ((addr + 1) >= mem_flashSize) return 0;
+    mem_flash[addr] &= (uint8_t)data;
+    mem_flash[addr + 1] &= (uint8_t)(data >> 8);
+    return 1;
+}
+
+static inline uint8_t mem_pageErase(void)
+{
+    memset(mem_flash, 0xFF, mem_flashSize);
+    return 1;
+}
+
+#define WEARLEVELING_BACKEND_READ_TWO_BYTE(addr)            mem_readTwoByte(addr)
+#define WEARLEVELING_BACKEND_WRITE_TWO_BYTE(addr, data)     mem_writeTwoByte(addr, data)
+#define WEARLEVELING_BACKEND_PAGE_ERASE()                   mem_pageErase()
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,200 @@
+//
+// Microbenchmarks of the v2 hot paths against an in-memory page.
+//
+// JSON for comparing releases or compiler flags:
+//   micro_bench --benchmark_out=result.json --benchmark_out_format=json
+//
+// micro_bench_static is the same source with the backend bound at compile
+// time (WEARLEVELING_BACKEND_HEADER), compare the two runs for the cost of
+// the callback pointers.
+//
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "wearleveling.h"
+#include "wearleveling.hpp"
+#include "mem_backend.h"
+
+uint8_t mem_flash[MEM_BACKEND_MAX_PAGE_SIZE];
+uint32_t mem_flashSize = 0;
+
+namespace
+{
+    /* larger than the last level cache, read through before a cold mount */
+    std::vector<uint8_t> evictBuffer(16U * 1024U * 1024U, 1);
+
+    /* the same page as a compile time policy of the C++ wrapper */
+    struct MemBackend
+    {
+        static uint16_t readTwoByte(uint32_t addr) { return mem_readTwoByte(addr); }
+        static uint8_t writeTwoByte(uint32_t addr, uint16_t data) { return mem_writeTwoByte(addr, data); }
+        static uint8_t pageErase(void) { return mem_pageErase(); }
+    };
+
+    struct Record16
+    {
+        uint8_t bytes[16];
+    };
+
+    wearleveling_params_typeDef makeParams(const int64_t pageSize, const int64_t dataSize)
+    {
+        mem_flashSize = (uint32_t)pageSize;
+        wearleveling_params_typeDef params =
+        {
+            .pageCapacityInByte = (uint16_t)pageSize,
+            .dataSizeInByte = (uint16_t)dataSize,
+            .readTwoByte = mem_readTwoByte,
+            .writeTwoByte = mem_writeTwoByte,
+            .pageErase = mem_pageErase,
+        };
+        return params;
+    }
+
+    void evictCaches(void)
+    {
+        uint32_t sum = 0;
+        for(size_t i = 0; i < evictBuffer.size(); i += 64)
+        {
+            sum += evictBuffer[i]++;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    /* args: data size, page size */
+    void BM_save(benchmark::State &state)
+    {
+        wearleveling_params_typeDef params = makeParams(state.range(1), state.range(0));
+        std::vector<uint8_t> data((size_t)state.range(0), 0x5A);
+        wearleveling_state_typeDef wearlevelingState;
+
+        mem_pageErase();
+        wearleveling_handle_typeDef handle = wearleveling_v2_construct(&wearlevelingState, &params);
+
+        /* roll overs included, at the rate a real page sees them */
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(wearleveling_v2_save(handle, data.data()));
+        }
+
+        state.SetItemsProcessed(state.iterations());
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+        state.counters["buckets"] = handle->numOfBuckets;
+    }
+
+    /* args: data size, page size */
+    void BM_read(benchmark::State &state)
+    {
+        wearleveling_params_typeDef params = makeParams(state.range(1), state.range(0));
+        std::vector<uint8_t> data((size_t)state.range(0), 0x5A);
+        wearleveling_state_typeDef wearlevelingState;
+
+        mem_pageErase();
+        wearleveling_handle_typeDef handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        wearleveling_v2_save(handle, data.data());
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(wearleveling_v2_read(handle, data.data()));
+            benchmark::ClobberMemory();
+        }
+
+        state.SetItemsProcessed(state.iterations());
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+
+    /* args: page size, fill level in percent, cold (1) or warm (0) caches; 16 byte records */
+    void BM_construct(benchmark::State &state)
+    {
+        const int64_t DATA_SIZE = 16;
+        wearleveling_params_typeDef params = makeParams(state.range(0), DATA_SIZE);
+        std::vector<uint8_t> data((size_t)DATA_SIZE, 0x5A);
+        wearleveling_state_typeDef wearlevelingState;
+
+        mem_pageErase();
+        wearleveling_handle_typeDef handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        const uint32_t NUM_OF_SAVES = ((uint32_t)handle->numOfBuckets * (uint32_t)state.range(1)) / 100U;
+        for(uint32_t i = 0; i < NUM_OF_SAVES; i++)
+        {
+            wearleveling_v2_save(handle, data.data());
+        }
+
+        const bool IS_COLD = state.range(2) != 0;
+        for (auto _ : state)
+        {
+            if (IS_COLD)
+            {
+                state.PauseTiming();
+                evictCaches();
+                state.ResumeTiming();
+            }
+            benchmark::DoNotOptimize(wearleveling_v2_construct(&wearlevelingState, &params));
+        }
+
+        state.SetItemsProcessed(state.iterations());
+        state.counters["used_buckets"] = wearlevelingState.indexBucketWrite;
+    }
+
+    /* C++ wrapper, 16 byte records on a 4 KiB page, callback pointers against an inlined policy */
+    template <typename Store> void BM_cppSave(benchmark::State &state, Store &store)
+    {
+        Record16 record = {};
+        for (auto _ : state)
+        {
+            record.bytes[0]++;
+            benchmark::DoNotOptimize(store.save(record));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    template <typename Store> void BM_cppLoad(benchmark::State &state, Store &store)
+    {
+        store.save(Record16{});
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(store.load());
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void BM_cppSave_callback(benchmark::State &state)
+    {
+        mem_flashSize = 4096;
+        wearlevelingLibrary::WearLeveled<Record16, 4096> store(mem_readTwoByte, mem_writeTwoByte, mem_pageErase);
+        BM_cppSave(state, store);
+    }
+
+    void BM_cppSave_policy(benchmark::State &state)
+    {
+        mem_flashSize = 4096;
+        wearlevelingLibrary::WearLeveled<Record16, 4096, 2, MemBackend> store;
+        BM_cppSave(state, store);
+    }
+
+    void BM_cppLoad_callback(benchmark::State &state)
+    {
+        mem_flashSize = 4096;
+        wearlevelingLibrary::WearLeveled<Record16, 4096> store(mem_readTwoByte, mem_writeTwoByte, mem_pageErase);
+        BM_cppLoad(state, store);
+    }
+
+    void BM_cppLoad_policy(benchmark::State &state)
+    {
+        mem_flashSize = 4096;
+        wearlevelingLibrary::WearLeveled<Record16, 4096, 2, MemBackend> store;
+        BM_cppLoad(state, store);
+    }
+}
+
+BENCHMARK(BM_save)->ArgNames({"data", "page"})->ArgsProduct({ { 4, 16, 64 }, { 256, 4096, 32768 } });
+BENCHMARK(BM_read)->ArgNames({"data", "page"})->ArgsProduct({ { 4, 16, 64 }, { 256, 4096, 32768 } });
+BENCHMARK(BM_construct)->ArgNames({"page", "fill", "cold"})->ArgsProduct({ { 256, 4096, 32768 }, { 0, 50, 100 }, { 0 } });
+/* every cold iteration walks the eviction buffer, a fixed count keeps the run short */
+BENCHMARK(BM_construct)->ArgNames({"page", "fill", "cold"})->ArgsProduct({ { 256, 4096, 32768 }, { 0, 50, 100 }, { 1 } })->Iterations(200);
+
+BENCHMARK(BM_cppSave_callback);
+BENCHMARK(BM_cppSave_policy);
+BENCHMARK(BM_cppLoad_callback);
+BENCHMARK(BM_cppLoad_policy);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,231 @@
+//
+// Power-loss recovery benchmark.
+//
+// A simulated NOR page loses power at a random half word program or during
+// the page erase of a save. The store is then mounted again with
+// wearleveling_v2_construct() and the record it returns is checked against
+// the last two records that were saved; a read that returns 0 counts as
+// lost. Then one more record is saved on the recovered store and checked
+// right away and after another mount: a torn bucket programmed over again
+// would show up here as a failed save after recovery. Mount time and the
+// number of half word reads per mount are reported as percentiles, in JSON.
+//
+// What is left in corrupt_or_lost is a cut during a roll over, where the
+// old records are gone once the erase starts, and, for odd record sizes, a
+// cut in the last program that leaves a complete dirty flag next to a torn
+// last data byte.
+//
+// usage: powerloss_bench [iterations] [page size] [data size] [seed]
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "wearleveling.h"
+
+namespace
+{
+    const uint32_t MAX_PAGE_SIZE = 0xFFFE;
+
+    uint8_t flash[MAX_PAGE_SIZE];
+    uint32_t flashSize = 1024;
+
+    std::mt19937 rng;
+
+    /* number of program/erase operations left before the power goes, -1 when not armed */
+    int32_t opsBeforeCut = -1;
+    bool isPowerCut = false;
+    uint32_t numOfReads = 0;
+
+    /* true when the power goes during the operation that is about to run */
+    bool isCutNow(void)
+    {
+        if (opsBeforeCut < 0) return false;
+        if (opsBeforeCut > 0)
+        {
+            opsBeforeCut--;
+            return false;
+        }
+        opsBeforeCut = -1;
+        isPowerCut = true;
+        return true;
+    }
+
+    uint16_t sim_readTwoByte(uint32_t addr)
+    {
+        numOfReads++;
+        if ((addr + 1) >= flashSize) return 0;
+        return (uint16_t)(flash[addr] | (flash[addr + 1] << 8));
+    }
+
+    uint8_t sim_writeTwoByte(uint32_t addr, uint16_t data)
+    {
+        if (isPowerCut) return 0;
+        if ((addr + 1) >= flashSize) return 0;
+
+        /* NOR program, bits only go from 1 to 0; a cut program only clears some of them */
+        const bool IS_CUT = isCutNow();
+        const uint16_t TARGET = IS_CUT ? (uint16_t)(data | (uint16_t)rng()) : data;
+
+        flash[addr] &= (uint8_t)TARGET;
+        flash[addr + 1] &= (uint8_t)(TARGET >> 8);
+
+        return IS_CUT ? 0 : 1;
+    }
+
+    uint8_t sim_pageErase(void)
+    {
+        if (isPowerCut) return 0;
+
+        if (isCutNow())
+        {
+            /* erase runs front to back, the byte at the cut is half erased */
+            const uint32_t CUT = rng() % flashSize;
+            memset(flash, 0xFF, CUT);
+            flash[CUT] |= (uint8_t)rng();
+            return 0;
+        }
+
+        memset(flash, 0xFF, flashSize);
+        return 1;
+    }
+
+    void powerOn(void)
+    {
+        isPowerCut = false;
+        opsBeforeCut = -1;
+    }
+
+    void fillRecord(uint8_t * const pData, const uint16_t dataSize, const uint32_t sequence)
+    {
+        for(uint16_t i = 0; i < dataSize; i++)
+        {
+            pData[i] = (uint8_t)((sequence * 31U) + (i * 7U) + (sequence >> 8));
+        }
+    }
+
+    uint64_t percentile(std::vector<uint64_t> &samples, const double fraction)
+    {
+        if (samples.empty()) return 0;
+        const size_t INDEX = (size_t)(fraction * (double)(samples.size() - 1));
+        return samples[INDEX];
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const uint32_t ITERATIONS = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 1000000U;
+    flashSize = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 0) : 1024U;
+    const uint16_t DATA_SIZE = argc > 3 ? (uint16_t)strtoul(argv[3], NULL, 0) : 8U;
+    const uint32_t SEED = argc > 4 ? (uint32_t)strtoul(argv[4], NULL, 0) : 1U;
+
+    if ((flashSize > MAX_PAGE_SIZE) || (DATA_SIZE == 0) || ((uint32_t)DATA_SIZE + 4 > flashSize))
+    {
+        fprintf(stderr, "invalid page size or data size\n");
+        return 1;
+    }
+
+    rng.seed(SEED);
+
+    wearleveling_params_typeDef params =
+    {
+        .pageCapacityInByte = (uint16_t)flashSize,
+        .dataSizeInByte = DATA_SIZE,
+        .readTwoByte = sim_readTwoByte,
+        .writeTwoByte = sim_writeTwoByte,
+        .pageErase = sim_pageErase,
+    };
+
+    std::vector<uint8_t> expectedNew(DATA_SIZE);
+    std::vector<uint8_t> expectedOld(DATA_SIZE);
+    std::vector<uint8_t> dataRead(DATA_SIZE);
+    std::vector<uint64_t> mountTimeInNs;
+    std::vector<uint64_t> mountReads;
+    mountTimeInNs.reserve(ITERATIONS);
+    mountReads.reserve(ITERATIONS);
+
+    uint32_t numOfNew = 0;
+    uint32_t numOfOld = 0;
+    uint32_t numOfCorrupt = 0;
+    uint32_t numOfCutDuringErase = 0;
+    uint32_t numOfSaveAfterRecoveryOk = 0;
+    uint32_t numOfSaveAfterRecoveryFailed = 0;
+
+    wearleveling_state_typeDef state;
+
+    for(uint32_t iteration = 0; iteration < ITERATIONS; iteration++)
+    {
+        /* start from a page at a random fill level */
+        powerOn();
+        sim_pageErase();
+        wearleveling_handle_typeDef handle = wearleveling_v2_construct(&state, &params);
+        const uint32_t NUM_OF_WARM_UP = 1 + (rng() % (2U * handle->numOfBuckets + 1));
+        for(uint32_t sequence = 0; sequence < NUM_OF_WARM_UP; sequence++)
+        {
+            fillRecord(expectedOld.data(), DATA_SIZE, sequence);
+            wearleveling_v2_save(handle, expectedOld.data());
+        }
+
+        /* the save that loses power: half word programs, plus erase and format flag on a roll over */
+        const bool IS_ROLL_OVER = wearleveling_v2_getNumOfFreeBuckets(handle) == 0;
+        const uint32_t NUM_OF_OPS = (handle->bucketSize >> 1) + (IS_ROLL_OVER ? 2U : 0U);
+        const uint32_t CUT = rng() % NUM_OF_OPS;
+        if (IS_ROLL_OVER && (CUT == 0)) numOfCutDuringErase++;
+
+        fillRecord(expectedNew.data(), DATA_SIZE, NUM_OF_WARM_UP);
+        opsBeforeCut = (int32_t)CUT;
+        wearleveling_v2_save(handle, expectedNew.data());
+
+        /* brown-out recovery */
+        powerOn();
+        numOfReads = 0;
+        const auto START = std::chrono::steady_clock::now();
+        handle = wearleveling_v2_construct(&state, &params);
+        const auto STOP = std::chrono::steady_clock::now();
+        mountTimeInNs.push_back((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(STOP - START).count());
+        mountReads.push_back(numOfReads);
+
+        if (wearleveling_v2_read(handle, dataRead.data()) == 0) numOfCorrupt++;
+        else if (memcmp(dataRead.data(), expectedNew.data(), DATA_SIZE) == 0) numOfNew++;
+        else if (memcmp(dataRead.data(), expectedOld.data(), DATA_SIZE) == 0) numOfOld++;
+        else numOfCorrupt++;
+
+        /* the next save on the recovered store, read back directly and after a mount */
+        fillRecord(expectedNew.data(), DATA_SIZE, NUM_OF_WARM_UP + 1);
+        bool isSaveOk = wearleveling_v2_save(handle, expectedNew.data()) != 0;
+        isSaveOk = isSaveOk && (wearleveling_v2_read(handle, dataRead.data()) != 0) && (memcmp(dataRead.data(), expectedNew.data(), DATA_SIZE) == 0);
+        handle = wearleveling_v2_construct(&state, &params);
+        isSaveOk = isSaveOk && (wearleveling_v2_read(handle, dataRead.data()) != 0) && (memcmp(dataRead.data(), expectedNew.data(), DATA_SIZE) == 0);
+        if (isSaveOk) numOfSaveAfterRecoveryOk++;
+        else numOfSaveAfterRecoveryFailed++;
+    }
+
+    std::sort(mountTimeInNs.begin(), mountTimeInNs.end());
+    std::sort(mountReads.begin(), mountReads.end());
+
+    printf("{\n");
+    printf("  \"iterations\": %u,\n", ITERATIONS);
+    printf("  \"page_size\": %u,\n", flashSize);
+    printf("  \"data_size\": %u,\n", DATA_SIZE);
+    printf("  \"seed\": %u,\n", SEED);
+    printf("  \"cut_during_erase\": %u,\n", numOfCutDuringErase);
+    printf("  \"recovered_new\": %u,\n", numOfNew);
+    printf("  \"recovered_old\": %u,\n", numOfOld);
+    printf("  \"corrupt_or_lost\": %u,\n", numOfCorrupt);
+    printf("  \"save_after_recovery_ok\": %u,\n", numOfSaveAfterRecoveryOk);
+    printf("  \"save_after_recovery_failed\": %u,\n", numOfSaveAfterRecoveryFailed);
+    printf("  \"mount_time_ns\": { \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu },\n",
+        (unsigned long long)percentile(mountTimeInNs, 0.50), (unsigned long long)percentile(mountTimeInNs, 0.90),
+        (unsigned long long)percentile(mountTimeInNs, 0.99), (unsigned long long)percentile(mountTimeInNs, 0.999),
+        (unsigned long long)percentile(mountTimeInNs, 1.0));
+    printf("  \"mount_reads\": { \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"max\": %llu }\n",
+        (unsigned long long)percentile(mountReads, 0.50), (unsigned long long)percentile(mountReads, 0.90),
+        (unsigned long long)percentile(mountReads, 0.99), (unsigned long long)percentile(mountReads, 1.0));
+    printf("}\n");
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+//
+// Many stores in parallel. Every store has its own simulated page and the
+// stores are split over a pool of threads; the callbacks take no context,
+// so each thread points a thread local device at the page of the store it
+// is about to use. Every read is checked against the last save of that
+// store and every store is mounted again at the end, so state shared
+// between handles inside the library shows up as mismatches. Runs from 1
+// thread up to max threads and prints ops/sec and the scaling against
+// one thread, in JSON.
+//
+// usage: stress_bench [stores] [saves per store] [max threads] [page size] [data size]
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "wearleveling.h"
+
+namespace
+{
+    thread_local uint8_t * pDevice = NULL;
+    uint16_t pageSize = 256;
+
+    uint16_t device_readTwoByte(uint32_t addr)
+    {
+        return (uint16_t)(pDevice[addr] | (pDevice[addr + 1] << 8));
+    }
+
+    uint8_t device_writeTwoByte(uint32_t addr, uint16_t data)
+    {
+        pDevice[addr] &= (uint8_t)data;
+        pDevice[addr + 1] &= (uint8_t)(data >> 8);
+        return 1;
+    }
+
+    uint8_t device_pageErase(void)
+    {
+        memset(pDevice, 0xFF, pageSize);
+        return 1;
+    }
+
+    typedef struct
+    {
+        uint32_t numOfThreads;
+        double opsPerSecond;
+        uint32_t numOfMismatches;
+    }run_typeDef;
+
+    run_typeDef runStores(const uint32_t numOfStores, const uint32_t numOfSaves, const uint32_t numOfThreads, const uint16_t dataSize)
+    {
+        std::vector<uint8_t> flash((size_t)numOfStores * pageSize, 0xFF);
+        std::vector<wearleveling_state_typeDef> states(numOfStores);
+        std::atomic<uint32_t> numOfMismatches(0);
+
+        auto worker = [&](const uint32_t first)
+        {
+            std::vector<uint8_t> data(dataSize);
+            std::vector<uint8_t> dataRead(dataSize);
+            uint32_t mismatches = 0;
+
+            wearleveling_params_typeDef params =
+            {
+                .pageCapacityInByte = pageSize,
+                .dataSizeInByte = dataSize,
+                .readTwoByte = device_readTwoByte,
+                .writeTwoByte = device_writeTwoByte,
+                .pageErase = device_pageErase,
+            };
+
+            /* store by store, interleaved so every store sees other stores' calls in between */
+            for(uint32_t i = first; i < numOfStores; i += numOfThreads)
+            {
+                pDevice = flash.data() + ((size_t)i * pageSize);
+                if (wearleveling_v2_construct(&states[i], &params) == NULL) mismatches++;
+            }
+
+            for(uint32_t n = 0; n < numOfSaves; n++)
+            {
+                for(uint32_t i = first; i < numOfStores; i += numOfThreads)
+                {
+                    const uint32_t VALUE = (i * 2654435761U) ^ n;
+                    pDevice = flash.data() + ((size_t)i * pageSize);
+                    memset(data.data(), (uint8_t)n, dataSize);
+                    memcpy(data.data(), &VALUE, std::min<size_t>(dataSize, sizeof(VALUE)));
+
+                    if (wearleveling_v2_save(&states[i], data.data()) == 0) mismatches++;
+                    if ((wearleveling_v2_read(&states[i], dataRead.data()) == 0) || (memcmp(data.data(), dataRead.data(), dataSize) != 0)) mismatches++;
+                }
+            }
+
+            /* a fresh mount must find the same record */
+            for(uint32_t i = first; i < numOfStores; i += numOfThreads)
+            {
+                const uint32_t VALUE = (i * 2654435761U) ^ (numOfSaves - 1);
+                pDevice = flash.data() + ((size_t)i * pageSize);
+                memset(data.data(), (uint8_t)(numOfSaves - 1), dataSize);
+                memcpy(data.data(), &VALUE, std::min<size_t>(dataSize, sizeof(VALUE)));
+
+                wearleveling_state_typeDef state;
+                if (wearleveling_v2_construct(&state, &params) == NULL) mismatches++;
+                else if ((wearleveling_v2_read(&state, dataRead.data()) == 0) || (memcmp(data.data(), dataRead.data(), dataSize) != 0)) mismatches++;
+            }
+
+            numOfMismatches += mismatches;
+        };
+
+        const auto START = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for(uint32_t t = 0; t < numOfThreads; t++) threads.emplace_back(worker, t);
+        for(auto & thread : threads) thread.join();
+        const double SECONDS = std::chrono::duration<double>(std::chrono::steady_clock::now() - START).count();
+
+        /* a save and a read per step */
+        const double NUM_OF_OPS = (double)numOfStores * numOfSaves * 2;
+        return { numOfThreads, NUM_OF_OPS / SECONDS, numOfMismatches.load() };
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const uint32_t NUM_OF_STORES = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 4096U;
+    const uint32_t NUM_OF_SAVES = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 0) : 200U;
+    const uint32_t HARDWARE_THREADS = std::max(1U, std::thread::hardware_concurrency());
+    const uint32_t MAX_THREADS = argc > 3 ? (uint32_t)strtoul(argv[3], NULL, 0) : HARDWARE_THREADS;
+    pageSize = argc > 4 ? (uint16_t)strtoul(argv[4], NULL, 0) : 256U;
+    const uint16_t DATA_SIZE = argc > 5 ? (uint16_t)strtoul(argv[5], NULL, 0) : 8U;
+
+    if ((NUM_OF_STORES == 0) || (NUM_OF_SAVES == 0) || (MAX_THREADS == 0) || (DATA_SIZE == 0) || ((uint32_t)DATA_SIZE + 4 > pageSize))
+    {
+        fprintf(stderr, "invalid arguments\n");
+        return 1;
+    }
+
+    /* 1, 2, 4 ... and max threads */
+    std::vector<uint32_t> threadCounts;
+    for(uint32_t t = 1; t < MAX_THREADS; t *= 2) threadCounts.push_back(t);
+    threadCounts.push_back(MAX_THREADS);
+
+    std::vector<run_typeDef> runs;
+    uint32_t numOfMismatches = 0;
+    for(const uint32_t t : threadCounts)
+    {
+        runs.push_back(runStores(NUM_OF_STORES, NUM_OF_SAVES, t, DATA_SIZE));
+        numOfMismatches += runs.back().numOfMismatches;
+    }
+
+    printf("{\n");
+    printf("  \"stores\": %u,\n", NUM_OF_STORES);
+    printf("  \"saves_per_store\": %u,\n", NUM_OF_SAVES);
+    printf("  \"page_size\": %u,\n", pageSize);
+    printf("  \"data_size\": %u,\n", DATA_SIZE);
+    printf("  \"hardware_threads\": %u,\n", HARDWARE_THREADS);
+    printf("  \"mismatches\": %u,\n", numOfMismatches);
+    printf("  \"runs\": [\n");
+    for(size_t r = 0; r < runs.size(); r++)
+    {
+        const double EFFICIENCY = runs[r].opsPerSecond / (runs[0].opsPerSecond * runs[r].numOfThreads);
+        printf("    { \"threads\": %u, \"ops_per_second\": %.0f, \"scaling_efficiency\": %.2f, \"mismatches\": %u }%s\n",
+            runs[r].numOfThreads, runs[r].opsPerSecond, EFFICIENCY, runs[r].numOfMismatches, (r + 1) < runs.size() ? "," : "");
+    }
+    printf("  ]\n");
+    printf("}\n");
+
+    return numOfMismatches == 0 ? 0 : 1;
+}
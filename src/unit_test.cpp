@@ -1,9 +1,31 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <time.h>
+#include <unistd.h>
 #include <mutex>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
 #include "gtest/gtest.h"
 #include "wearleveling.h"
+#include "wearleveling_counter.h"
+#include "wearleveling.hpp"
+#include "wearleveling_scheduler.h"
+#include "wearleveling_coro.hpp"
+#include "wearleveling_file.h"
+#include "wearleveling_lifetime.h"
+#include "wearleveling_txn.h"
+#include "wearleveling_blob.h"
+#include "wearleveling_stripe.h"
+#include "wearleveling_throttle.h"
+#include "wearleveling_nand.h"
+#include "wearleveling_nand_sim.h"
+#include "wearleveling_eeprom.h"
+#include "wearleveling_compact.h"
 
 const uint16_t PAGE_SIZE_32K = 1024 * 32;
 static uint8_t page[PAGE_SIZE_32K] = {0};
@@ -14,6 +36,151 @@ uint8_t mock_pageErase(void);
 uint8_t mock_formatPage(void);
 uint8_t mock_writeTwoByte(uint32_t addr, uint16_t data);
 uint16_t mock_readTwoByte(uint32_t addr);
+
+/* a page placed at BASE inside the mock page, for tests with more than one store */
+template <uint32_t BASE> uint16_t mock_regionReadTwoByte(uint32_t addr) { return mock_readTwoByte(BASE + addr); }
+template <uint32_t BASE> uint8_t mock_regionWriteTwoByte(uint32_t addr, uint16_t data) { return mock_writeTwoByte(BASE + addr, data); }
+template <uint32_t BASE, uint32_t SIZE> uint8_t mock_regionPageErase(void) { memset((void *)(page + BASE), 0xFF, SIZE); return 1; }
+template <uint32_t BASE, uint32_t SIZE> uint8_t mock_regionSectorErase(uint32_t addr) { memset((void *)(page + BASE + addr), 0xFF, SIZE); return 1; }
+uint8_t mock_sectorErase64(uint32_t addr) { memset((void *)(page + addr), 0xFF, 64); return 1; }
+uint8_t mock_sectorErase128(uint32_t addr) { memset((void *)(page + addr), 0xFF, 128); return 1; }
+
+/* one page per store for tests running stores on several threads, each thread points at the store it uses */
+static thread_local uint8_t * mock_pThreadPage = NULL;
+uint16_t mock_threadReadTwoByte(uint32_t addr) { return (uint16_t)(mock_pThreadPage[addr] | (mock_pThreadPage[addr + 1] << 8)); }
+uint8_t mock_threadWriteTwoByte(uint32_t addr, uint16_t data) { mock_pThreadPage[addr] &= (uint8_t)data; mock_pThreadPage[addr + 1] &= (uint8_t)(data >> 8); return 1; }
+uint8_t mock_threadPageErase(void) { memset((void *)mock_pThreadPage, 0xFF, 64); return 1; }
+
+/* power goes at the first write of mock_cutAtTwoByte once armed, that write never reaches the flash */
+static uint8_t mock_isCutArmed = 0;
+static uint16_t mock_cutAtTwoByte = 0;
+uint8_t mock_cuttingWriteTwoByte(uint32_t addr, uint16_t data)
+{
+    if (mock_isCutArmed && (data == mock_cutAtTwoByte)) { mock_isCutArmed = 0; return 0; }
+    return mock_writeTwoByte(addr, data);
+}
+
+/* counts flash reads, for tests on how much a mount has to touch */
+static uint32_t mock_numOfReads = 0;
+uint16_t mock_countingReadTwoByte(uint32_t addr) { mock_numOfReads++; return mock_readTwoByte(addr); }
+
+/* burst reads, for history without a mapped base */
+static uint32_t mock_numOfBursts = 0;
+uint8_t mock_readBytes(uint32_t addr, uint8_t * pBuf, uint16_t len) { mock_numOfBursts++; memcpy(pBuf, &page[addr], len); return 1; }
+
+/* DMA style driver, transfers are queued and only run when the test drains the queue */
+typedef struct
+{
+    uint8_t type;
+    uint32_t addr;
+    const uint8_t * pSource;
+    uint8_t * pDestination;
+    uint16_t len;
+    wearleveling_done_callback_typeDef done;
+    void * pContext;
+}mock_asyncTransfer_typeDef;
+
+static std::deque<mock_asyncTransfer_typeDef> mock_asyncQueue;
+/* base and size inside the mock page of the store a transfer belongs to, keyed by its handle */
+static std::unordered_map<const void *, std::pair<uint32_t, uint32_t>> mock_asyncRegions;
+uint8_t mock_submitProgram(uint32_t addr, const uint8_t * pBuf, uint16_t len, wearleveling_done_callback_typeDef done, void * pContext)
+{
+    mock_asyncQueue.push_back({ 0, addr, pBuf, NULL, len, done, pContext });
+    return 1;
+}
+uint8_t mock_submitRead(uint32_t addr, uint8_t * pBuf, uint16_t len, wearleveling_done_callback_typeDef done, void * pContext)
+{
+    mock_asyncQueue.push_back({ 1, addr, NULL, pBuf, len, done, pContext });
+    return 1;
+}
+uint8_t mock_submitErase(uint32_t addr, wearleveling_done_callback_typeDef done, void * pContext)
+{
+    mock_asyncQueue.push_back({ 2, addr, NULL, NULL, 0, done, pContext });
+    return 1;
+}
+/* runs the oldest queued transfer, its done callback may queue the next one */
+uint8_t mock_runAsyncTransfer(void)
+{
+    if (mock_asyncQueue.empty()) return 0;
+
+    const mock_asyncTransfer_typeDef TRANSFER = mock_asyncQueue.front();
+    mock_asyncQueue.pop_front();
+    const auto REGION = mock_asyncRegions.find(TRANSFER.pContext);
+    const uint32_t BASE = REGION == mock_asyncRegions.end() ? 0 : REGION->second.first;
+    const uint32_t SIZE = REGION == mock_asyncRegions.end() ? PAGE_SIZE_32K - TRANSFER.addr : REGION->second.second;
+    if (TRANSFER.type == 0) memcpy(page + BASE + TRANSFER.addr, TRANSFER.pSource, TRANSFER.len);
+    if (TRANSFER.type == 1) memcpy(TRANSFER.pDestination, page + BASE + TRANSFER.addr, TRANSFER.len);
+    if (TRANSFER.type == 2) memset(page + BASE + TRANSFER.addr, 0xFF, SIZE);
+    TRANSFER.done(TRANSFER.pContext, 1);
+    return 1;
+}
+uint32_t mock_drainAsyncQueue(void)
+{
+    uint32_t numOfTransfers = 0;
+    while (mock_runAsyncTransfer()) numOfTransfers++;
+    return numOfTransfers;
+}
+static const wearleveling_async_driver_typeDef mock_asyncDriver = { mock_submitProgram, mock_submitRead, mock_submitErase };
+
+/* synchronous access to the store selected by mock_selectedBase, used to mount many stores */
+static uint32_t mock_selectedBase = 0;
+uint16_t mock_selectedReadTwoByte(uint32_t addr) { return mock_readTwoByte(mock_selectedBase + addr); }
+uint8_t mock_selectedWriteTwoByte(uint32_t addr, uint16_t data) { return mock_writeTwoByte(mock_selectedBase + addr, data); }
+uint8_t mock_selectedPageErase(void) { memset((void *)(page + mock_selectedBase), 0xFF, 32); return 1; }
+
+/* an erase that gets interrupted by a reader, like an ISR on single-bank flash */
+static wearleveling_handle_typeDef mock_interruptingHandle = NULL;
+static uint8_t mock_interruptingRead[5];
+static uint32_t mock_numOfInterruptingReads = 0;
+uint8_t mock_interruptedPageErase(void)
+{
+    mock_pageErase();
+    mock_numOfReads = 0;
+    if (mock_interruptingHandle != NULL) wearleveling_v2_read(mock_interruptingHandle, mock_interruptingRead);
+    mock_numOfInterruptingReads += mock_numOfReads;
+    return 1;
+}
+
+/* time source the tests move by hand */
+static uint32_t mock_timeInSecond = 0;
+uint32_t mock_getTimeInSecond(void) { return mock_timeInSecond; }
+
+/* store on a temporary file */
+static wearleveling_file_typeDef testFile;
+WEARLEVELING_FILE_DEFINE_CALLBACKS(testFile, &testFile)
+
+/* SPI-NAND sized: 2 KiB pages, 4 pages per block, 6 blocks */
+static uint8_t nandMemory[6 * 4 * 2048];
+static uint8_t nandPageFlags[6 * 4];
+static uint8_t nandBlockFlags[6];
+static wearleveling_nand_sim_typeDef nandSim = { 2048, 4, 6, nandMemory, nandPageFlags, nandBlockFlags, 0, 0, 0 };
+WEARLEVELING_NAND_SIM_DEFINE_CALLBACKS(nandSim, &nandSim)
+
+/* started right away, frees itself when it returns */
+struct mock_detachedTask
+{
+    struct promise_type
+    {
+        mock_detachedTask get_return_object(void) { return {}; }
+        std::suspend_never initial_suspend(void) noexcept { return {}; }
+        std::suspend_never final_suspend(void) noexcept { return {}; }
+        void return_void(void) {}
+        void unhandled_exception(void) { std::terminate(); }
+    };
+};
+
+/* gcc lowers every coroutine into a switch without a default case */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wswitch-default"
+mock_detachedTask mock_runStore(wearlevelingLibrary::AsyncWearLeveled<uint32_t> &store, const uint32_t seed, uint32_t * const pNumOfMatches)
+{
+    for(uint32_t i = 0; i < 20; i++)
+    {
+        if (co_await store.save(seed + i) == false) co_return;
+        if (co_await store.load() == (seed + i)) (*pNumOfMatches)++;
+    }
+}
+#pragma GCC diagnostic pop
 namespace wearlevelingLibraryTest
 {
     class wearlevelingLibraryTest:public::testing::Test
@@ -1624,6 +1791,2440 @@ namespace wearlevelingLibraryTest
             }
         }
     }
+
+    TEST_F(wearlevelingLibraryTest, counter_1)
+    {
+        /* common data */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 1024,
+            .dataSizeInByte = 0,
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        mock_pageErase();
+        wearleveling_counter_state_typeDef counterState;
+        const wearleveling_counter_handle_typeDef handle = wearleveling_counter_construct(&counterState, &params);
+
+        ASSERT_EQ(0, wearleveling_counter_read(handle));
+        ASSERT_EQ(((1024 - 6) / 2) * 16, wearleveling_counter_getIncrementsPerErase(handle));
+        ASSERT_EQ(0x21, page[0]);
+        ASSERT_EQ(0x43, page[1]);
+
+        wearleveling_counter_increment(handle);
+        wearleveling_counter_increment(handle);
+        wearleveling_counter_increment(handle);
+        ASSERT_EQ(3, wearleveling_counter_read(handle));
+        ASSERT_EQ(0xF8, page[6]);
+        ASSERT_EQ(0xFF, page[7]);
+        ASSERT_EQ(0xFF, page[8]);
+    }
+
+    TEST_F(wearlevelingLibraryTest, counter_2_construct)
+    {
+        /* common data */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 1024,
+            .dataSizeInByte = 0,
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        mock_pageErase();
+        wearleveling_counter_state_typeDef counterState;
+        wearleveling_counter_handle_typeDef handle = wearleveling_counter_construct(&counterState, &params);
+
+        for(uint16_t i = 0; i < 37; i++) wearleveling_counter_increment(handle);
+
+        handle = wearleveling_counter_construct(&counterState, &params);
+        ASSERT_EQ(37, wearleveling_counter_read(handle));
+        ASSERT_EQ(2, handle->indexHalfWord);
+
+        for(uint16_t i = 0; i < 11; i++) wearleveling_counter_increment(handle);
+
+        handle = wearleveling_counter_construct(&counterState, &params);
+        ASSERT_EQ(48, wearleveling_counter_read(handle));
+        ASSERT_EQ(3, handle->indexHalfWord);
+        ASSERT_EQ(0xFFFF, handle->currentHalfWord);
+    }
+
+    TEST_F(wearlevelingLibraryTest, counter_3_roll_over)
+    {
+        /* common data */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 10,
+            .dataSizeInByte = 0,
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        mock_pageErase();
+        wearleveling_counter_state_typeDef counterState;
+        wearleveling_counter_handle_typeDef handle = wearleveling_counter_construct(&counterState, &params);
+        ASSERT_EQ(32, wearleveling_counter_getIncrementsPerErase(handle));
+
+        for(uint32_t i = 1; i <= 1000; i++)
+        {
+            ASSERT_EQ(1, wearleveling_counter_increment(handle));
+            ASSERT_EQ(i, wearleveling_counter_read(handle));
+
+            handle = wearleveling_counter_construct(&counterState, &params);
+            ASSERT_EQ(i, wearleveling_counter_read(handle));
+        }
+
+        /* 1000 = 31 * 32 + 8, base value was compacted at the last roll over */
+        ASSERT_EQ(992, handle->baseValue);
+        ASSERT_EQ(0xE0, page[2]);
+        ASSERT_EQ(0x03, page[3]);
+    }
+
+    TEST_F(wearlevelingLibraryTest, counter_4_power_cut)
+    {
+        /* common data, 32 increments per sector */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 10,
+            .dataSizeInByte = 0,
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_cuttingWriteTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        wearleveling_sector_params_typeDef sectorParams = 
+        {
+            .spareSectorAddr = 1024,
+            .sectorErase = mock_sectorErase64,
+        };
+
+        mock_pageErase();
+        wearleveling_counter_state_typeDef counterState;
+        wearleveling_counter_handle_typeDef handle = wearleveling_counter_constructPingPong(&counterState, &params, &sectorParams);
+        for(uint32_t i = 1; i <= 100; i++)
+        {
+            ASSERT_EQ(1, wearleveling_counter_increment(handle));
+            handle = wearleveling_counter_constructPingPong(&counterState, &params, &sectorParams);
+            ASSERT_EQ(i, wearleveling_counter_read(handle));
+        }
+
+        /* 100 = 3 * 32 + 4, three roll overs, back and forth */
+        ASSERT_EQ(96, handle->baseValue);
+        ASSERT_EQ(1024U, handle->baseAddr);
+
+        for(uint32_t i = 101; i <= 128; i++) ASSERT_EQ(1, wearleveling_counter_increment(handle));
+
+        /* power goes after the erase and the base, before the formated flag */
+        mock_isCutArmed = 1;
+        mock_cutAtTwoByte = 0x4321;
+        ASSERT_EQ(0, wearleveling_counter_increment(handle));
+        ASSERT_EQ(0, mock_isCutArmed);
+        ASSERT_EQ(0xFFFF, mock_readTwoByte(0));
+
+        handle = wearleveling_counter_constructPingPong(&counterState, &params, &sectorParams);
+        ASSERT_EQ(128, wearleveling_counter_read(handle));
+        ASSERT_EQ(1, wearleveling_counter_increment(handle));
+        handle = wearleveling_counter_constructPingPong(&counterState, &params, &sectorParams);
+        ASSERT_EQ(129, wearleveling_counter_read(handle));
+        ASSERT_EQ(0U, handle->baseAddr);
+    }
+
+    TEST_F(wearlevelingLibraryTest, cpp_wrapper_geometry)
+    {
+        struct oddRecord { uint8_t data[5]; };
+        struct evenRecord { uint16_t data[5]; };
+
+        static_assert(wearlevelingLibrary::WearLeveled<oddRecord, 1024>::BucketSize == 6, "");
+        static_assert(wearlevelingLibrary::WearLeveled<evenRecord, 1024>::BucketSize == 12, "");
+        static_assert(wearlevelingLibrary::WearLeveled<evenRecord, 1024, 8>::BucketSize == 16, "");
+        static_assert(wearlevelingLibrary::WearLeveled<oddRecord, 1024>::NumOfBuckets == (1024 - 2) / 6, "");
+        static_assert(wearlevelingLibrary::WearLeveled<evenRecord, 1024, 8>::NumOfBuckets == (1024 - 8) / 16, "");
+
+        /* same geometry as the C code */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 1024,
+            .dataSizeInByte = sizeof(oddRecord),
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        mock_pageErase();
+        wearleveling_state_typeDef wearlevelingState;
+        const wearleveling_handle_typeDef handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        ASSERT_EQ(handle->bucketSize, (wearlevelingLibrary::WearLeveled<oddRecord, 1024>::BucketSize));
+        ASSERT_EQ(wearleveling_v2_getEraseWriteCycleMultiplier(handle), (wearlevelingLibrary::WearLeveled<oddRecord, 1024>::getEraseWriteCycleMultiplier()));
+    }
+
+    TEST_F(wearlevelingLibraryTest, cpp_wrapper_save_load)
+    {
+        struct record { uint8_t data[7]; };
+        typedef wearlevelingLibrary::WearLeveled<record, 64> store_typeDef;
+
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = sizeof(record),
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        mock_pageErase();
+        store_typeDef store(mock_readTwoByte, mock_writeTwoByte, mock_pageErase);
+        ASSERT_EQ(0x34, page[0]);
+        ASSERT_EQ(0x12, page[1]);
+
+        record dataWrite;
+        record dataRead;
+        for(uint16_t i = 0; i < 100; i++)
+        {
+            fillRandomData(dataWrite.data, sizeof(dataWrite.data) - 1);
+            ASSERT_TRUE(store.save(dataWrite));
+            ASSERT_EQ(0, memcmp(dataWrite.data, store.load().data, sizeof(record)));
+
+            /* page written by the wrapper is readable by the C code */
+            wearleveling_state_typeDef wearlevelingState;
+            const wearleveling_handle_typeDef handle = wearleveling_v2_construct(&wearlevelingState, &params);
+            ASSERT_EQ(store.indexBucketRead(), handle->indexBucketRead);
+            wearleveling_v2_read(handle, dataRead.data);
+            ASSERT_EQ(0, memcmp(dataWrite.data, dataRead.data, sizeof(record)));
+
+            /* and the other way round */
+            fillRandomData(dataWrite.data, sizeof(dataWrite.data) - 1);
+            wearleveling_v2_save(handle, dataWrite.data);
+            store_typeDef remounted(mock_readTwoByte, mock_writeTwoByte, mock_pageErase);
+            ASSERT_EQ(handle->indexBucketWrite, remounted.getIndexBucketWrite());
+            ASSERT_EQ(0, memcmp(dataWrite.data, remounted.load().data, sizeof(record)));
+            store = remounted;
+        }
+    }
+
+    /* the mock page as a compile time backend */
+    struct mock_backend
+    {
+        static uint16_t readTwoByte(uint32_t addr) { return mock_readTwoByte(addr); }
+        static uint8_t writeTwoByte(uint32_t addr, uint16_t data) { return mock_writeTwoByte(addr, data); }
+        static uint8_t pageErase(void) { return mock_pageErase(); }
+    };
+
+    /* a flash programmed eight bytes at a time, every unit is logged */
+    std::vector<uint32_t> mock_unitAddresses;
+    struct mock_unitBackend
+    {
+        static uint16_t readTwoByte(uint32_t addr) { return mock_readTwoByte(addr); }
+        static uint8_t writeTwoByte(uint32_t addr, uint16_t data) { (void)addr; (void)data; return 0; }
+        static uint8_t writeUnit(uint32_t addr, const uint8_t *pUnit)
+        {
+            mock_unitAddresses.push_back(addr);
+            memcpy(&page[addr], pUnit, 8);
+            return 1;
+        }
+        static uint8_t pageErase(void) { return mock_pageErase(); }
+    };
+
+    TEST_F(wearlevelingLibraryTest, cpp_wrapper_program_unit)
+    {
+        /* no default constructor, load still works */
+        struct record
+        {
+            explicit record(uint32_t value) : low(value), high(~value) { }
+            uint32_t low;
+            uint32_t high;
+        };
+        typedef wearlevelingLibrary::WearLeveled<record, 256, 8, mock_unitBackend> store_typeDef;
+        static_assert(store_typeDef::HasWriteUnit, "");
+        static_assert(store_typeDef::BucketSize == 16, "");
+
+        mock_pageErase();
+        mock_unitAddresses.clear();
+        store_typeDef store;
+        ASSERT_EQ(1U, mock_unitAddresses.size());
+        ASSERT_EQ(0x34, page[0]);
+        ASSERT_EQ(0x12, page[1]);
+        ASSERT_EQ(0xFF, page[7]);
+
+        for(uint32_t i = 0; i < 10; i++)
+        {
+            mock_unitAddresses.clear();
+            ASSERT_TRUE(store.save(record(i)));
+
+            /* whole units only, the one holding the dirty flag last */
+            ASSERT_EQ(2U, mock_unitAddresses.size());
+            for(const uint32_t addr : mock_unitAddresses) ASSERT_EQ(0U, addr % 8);
+            ASSERT_EQ(store_typeDef::HeaderSize + (store.indexBucketRead() * 16U) + 8U, mock_unitAddresses.back());
+
+            store_typeDef remounted;
+            ASSERT_EQ(i, remounted.load().low);
+            ASSERT_EQ(~i, remounted.load().high);
+        }
+    }
+
+    TEST_F(wearlevelingLibraryTest, throttle_1)
+    {
+        /* 10 buckets rated for 10 erases over 1000 s: one save every 10 s */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 5,
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        uint8_t dummy_data [5] = { 0 };
+        uint8_t dummy_data_read [5] = { 0 };
+        uint8_t pending [5] = { 0 };
+
+        mock_pageErase();
+        mock_timeInSecond = 500;
+        wearleveling_state_typeDef wearlevelingState;
+        wearleveling_handle_typeDef handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        const wearleveling_throttle_params_typeDef throttleParams = { 10, 1000, mock_getTimeInSecond, pending };
+        wearleveling_throttle_state_typeDef throttleState;
+        wearleveling_throttle_handle_typeDef throttle = wearleveling_throttle_construct(&throttleState, handle, &throttleParams);
+        ASSERT_NE(nullptr, throttle);
+        ASSERT_EQ(100U, wearleveling_throttle_getBudgetInMilliPerSecond(throttle));
+
+        /* a page worth of burst goes to flash, the rest is coalesced */
+        for(uint16_t i = 0; i < 30; i++)
+        {
+            fillRandomData(dummy_data, sizeof(dummy_data) - 1);
+            ASSERT_EQ(1, wearleveling_throttle_save(throttle, dummy_data));
+        }
+        ASSERT_EQ(10U, handle->generation);
+        ASSERT_EQ(20U, wearleveling_throttle_getNumOfThrottled(throttle));
+        ASSERT_EQ(19U, wearleveling_throttle_getNumOfCoalesced(throttle));
+        ASSERT_EQ(1, wearleveling_throttle_read(throttle, dummy_data_read));
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+        /* half a save of budget is not enough */
+        mock_timeInSecond += 5;
+        ASSERT_EQ(1, wearleveling_throttle_run(throttle));
+        ASSERT_EQ(1, wearleveling_throttle_isPending(throttle));
+        mock_timeInSecond += 5;
+        ASSERT_EQ(1, wearleveling_throttle_run(throttle));
+        ASSERT_EQ(0, wearleveling_throttle_isPending(throttle));
+        ASSERT_EQ(11U, handle->generation);
+        wearleveling_v2_read(handle, dummy_data_read);
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+        /* out of budget, only a flush gets it to flash */
+        fillRandomData(dummy_data, sizeof(dummy_data) - 1);
+        ASSERT_EQ(1, wearleveling_throttle_save(throttle, dummy_data));
+        ASSERT_EQ(1, wearleveling_throttle_isPending(throttle));
+        ASSERT_EQ(1, wearleveling_throttle_flush(throttle));
+        ASSERT_EQ(12U, handle->generation);
+        handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        wearleveling_v2_read(handle, dummy_data_read);
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+    }
+    TEST_F(wearlevelingLibraryTest, nand_1)
+    {
+        static uint8_t pageBuffer [2048];
+        uint8_t badBlockTable [1] = { 0 };
+        uint8_t newest [32] = { 0 };
+        uint8_t dummy_data [32] = { 0 };
+        uint8_t dummy_data_read [32] = { 0 };
+
+        const wearleveling_nand_params_typeDef params =
+        {
+            .pageSizeInByte = 2048,
+            .pagesPerBlock = 4,
+            .numOfBlocks = 6,
+            .dataSizeInByte = sizeof(dummy_data),
+            .eccSizeInByte = WEARLEVELING_NAND_SIM_ECC_SIZE,
+            .programPage = nandSim_programPage,
+            .readPage = nandSim_readPage,
+            .eraseBlock = nandSim_eraseBlock,
+            .isBadBlock = nandSim_isBadBlock,
+            .markBadBlock = nandSim_markBadBlock,
+            .eccEncode = wearleveling_nand_sim_eccEncode,
+            .eccCorrect = wearleveling_nand_sim_eccCorrect,
+            .pPageBuffer = pageBuffer,
+            .pBadBlockTable = badBlockTable,
+            .pNewest = newest,
+        };
+
+        wearleveling_nand_sim_init(&nandSim);
+        nandBlockFlags[2] = WEARLEVELING_NAND_SIM_FACTORY_BAD;
+        wearleveling_nand_state_typeDef nandState;
+        wearleveling_nand_handle_typeDef nand = wearleveling_nand_construct(&nandState, &params);
+        ASSERT_NE(nullptr, nand);
+        ASSERT_EQ(0, wearleveling_nand_read(nand, dummy_data_read));
+        ASSERT_EQ(1U, wearleveling_nand_getNumOfBadBlocks(nand));
+        const uint16_t RECORDS_PER_PAGE = wearleveling_nand_getRecordsPerPage(nand);
+        ASSERT_EQ((2048U - 8U - WEARLEVELING_NAND_SIM_ECC_SIZE) / 32U, RECORDS_PER_PAGE);
+
+        /* one page program per full buffer, around the log past the bad block */
+        const uint32_t NUM_OF_SAVES = RECORDS_PER_PAGE * 30U + 7U;
+        for(uint32_t i = 0; i < NUM_OF_SAVES; i++)
+        {
+            fillRandomData(dummy_data, sizeof(dummy_data) - 1);
+            ASSERT_EQ(1, wearleveling_nand_save(nand, dummy_data));
+        }
+        ASSERT_EQ(30U, nandSim.numOfPrograms);
+        ASSERT_EQ(0U, nandSim.numOfReprograms);
+        ASSERT_EQ(0, memcmp(nandPageFlags + (2 * 4), "\0\0\0\0", 4));
+        ASSERT_EQ(1, wearleveling_nand_read(nand, dummy_data_read));
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+        /* the partial buffer goes out on flush, a flipped bit is corrected at the next mount */
+        ASSERT_EQ(1, wearleveling_nand_flush(nand));
+        const uint32_t NEWEST_PAGE = ((uint32_t)nand->writeBlock * 4U) + nand->writePage - 1U;
+        wearleveling_nand_sim_flipBit(&nandSim, NEWEST_PAGE, 8U * (8U + (6U * 32U)) + 3U);
+        nand = wearleveling_nand_construct(&nandState, &params);
+        ASSERT_EQ(1, wearleveling_nand_read(nand, dummy_data_read));
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+        /* a block failing its erase or program is retired, nothing is lost */
+        for(uint16_t i = 0; i < 6; i++)
+        {
+            if (nandBlockFlags[i] == 0) nandBlockFlags[i] = WEARLEVELING_NAND_SIM_FAILING;
+            if (i == nand->writeBlock) nandBlockFlags[i] = 0;
+        }
+        nandBlockFlags[(nand->writeBlock + 1) % 6] = 0;
+        for(uint32_t i = 0; i < RECORDS_PER_PAGE * 8U; i++)
+        {
+            fillRandomData(dummy_data, sizeof(dummy_data) - 1);
+            ASSERT_EQ(1, wearleveling_nand_save(nand, dummy_data));
+        }
+        ASSERT_GT(wearleveling_nand_getNumOfBadBlocks(nand), 1);
+        nand = wearleveling_nand_construct(&nandState, &params);
+        ASSERT_EQ(1, wearleveling_nand_read(nand, dummy_data_read));
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+        ASSERT_EQ(0U, nandSim.numOfReprograms);
+    }
+    TEST_F(wearlevelingLibraryTest, eeprom_1)
+    {
+        /* 256 byte sectors at 0 and 1024, 63 entries for 20 variables */
+        uint16_t values [20] = { 0 };
+        uint8_t isWritten [3] = { 0 };
+        const wearleveling_eeprom_params_typeDef params =
+        {
+            .sectorSizeInByte = 256,
+            .spareSectorAddr = 1024,
+            .numOfVariables = 20,
+            .readTwoByte = mock_countingReadTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .sectorErase = mock_regionSectorErase<0, 256>,
+            .pValues = values,
+            .pIsWritten = isWritten,
+        };
+
+        uint16_t expected [20] = { 0 };
+        uint16_t value = 0;
+
+        mock_pageErase();
+        wearleveling_eeprom_state_typeDef eepromState;
+        wearleveling_eeprom_handle_typeDef eeprom = wearleveling_eeprom_construct(&eepromState, &params);
+        ASSERT_NE(nullptr, eeprom);
+        ASSERT_EQ(0, wearleveling_eeprom_read(eeprom, 3, &value));
+        ASSERT_EQ(0, wearleveling_eeprom_write(eeprom, 20, 1));
+
+        for(uint16_t i = 0; i < 20; i++)
+        {
+            expected[i] = (uint16_t)rand();
+            ASSERT_EQ(1, wearleveling_eeprom_write(eeprom, i, expected[i]));
+        }
+
+        /* an unchanged value is not written again */
+        const uint16_t NUM_OF_FREE = wearleveling_eeprom_getNumOfFreeEntries(eeprom);
+        ASSERT_EQ(1, wearleveling_eeprom_write(eeprom, 7, expected[7]));
+        ASSERT_EQ(NUM_OF_FREE, wearleveling_eeprom_getNumOfFreeEntries(eeprom));
+
+        for(uint16_t i = 0; i < 500; i++)
+        {
+            const uint16_t VIRT_ADDR = (uint16_t)(rand() % 20);
+            expected[VIRT_ADDR] = (uint16_t)rand();
+            ASSERT_EQ(1, wearleveling_eeprom_write(eeprom, VIRT_ADDR, expected[VIRT_ADDR]));
+
+            if ((i % 37) != 0) continue;
+            eeprom = wearleveling_eeprom_construct(&eepromState, &params);
+            mock_numOfReads = 0;
+            for(uint16_t j = 0; j < 20; j++)
+            {
+                ASSERT_EQ(1, wearleveling_eeprom_read(eeprom, j, &value));
+                ASSERT_EQ(expected[j], value);
+            }
+            ASSERT_EQ(0U, mock_numOfReads);
+        }
+        ASSERT_GT(eeprom->sequence, 5);
+
+        /* a compaction cut short leaves the other sector without its valid flag */
+        const uint32_t OTHER_ADDR = eeprom->activeAddr == 0 ? 1024 : 0;
+        mock_regionSectorErase<0, 256>(OTHER_ADDR);
+        mock_writeTwoByte(OTHER_ADDR + 4, 0x0BAD);
+        mock_writeTwoByte(OTHER_ADDR + 6, 3);
+        mock_writeTwoByte(OTHER_ADDR + 2, (uint16_t)(eeprom->sequence + 1));
+        eeprom = wearleveling_eeprom_construct(&eepromState, &params);
+        for(uint16_t j = 0; j < 20; j++)
+        {
+            ASSERT_EQ(1, wearleveling_eeprom_read(eeprom, j, &value));
+            ASSERT_EQ(expected[j], value);
+        }
+    }
+    TEST_F(wearlevelingLibraryTest, lazy_mount_1)
+    {
+        /* common data */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 5,
+            .readTwoByte = mock_countingReadTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        uint8_t dummy_data [5] = { 0 };
+        uint8_t dummy_data_read [5] = { 0 };
+
+        mock_pageErase();
+        wearleveling_state_typeDef wearlevelingState;
+        wearleveling_handle_typeDef handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        for(uint16_t i = 0; i < 7; i++)
+        {
+            fillRandomData(dummy_data, sizeof(dummy_data) - 1);
+            wearleveling_v2_save(handle, dummy_data);
+        }
+
+        /* nothing read at construct */
+        mock_numOfReads = 0;
+        handle = wearleveling_v2_constructLazy(&wearlevelingState, &params, NULL);
+        ASSERT_NE(nullptr, handle);
+        ASSERT_EQ(0U, mock_numOfReads);
+        ASSERT_EQ(0, wearleveling_v2_isMounted(handle));
+
+        /* the formated flag and two buckets, then three buckets at a time, the blank check of the frontier and the newest flag */
+        ASSERT_EQ(0, wearleveling_v2_mountStep(handle, 3));
+        ASSERT_EQ(3U, mock_numOfReads);
+        ASSERT_EQ(0, wearleveling_v2_mountStep(handle, 3));
+        ASSERT_EQ(6U, mock_numOfReads);
+        ASSERT_EQ(0, wearleveling_v2_mountStep(handle, 3));
+        ASSERT_EQ(9U, mock_numOfReads);
+        ASSERT_EQ(0, wearleveling_v2_mountStep(handle, 3));
+        ASSERT_EQ(12U, mock_numOfReads);
+        ASSERT_EQ(1, wearleveling_v2_mountStep(handle, 3));
+        ASSERT_EQ(13U, mock_numOfReads);
+        ASSERT_EQ(1, wearleveling_v2_isMounted(handle));
+        ASSERT_EQ(7, handle->indexBucketWrite);
+        ASSERT_EQ(1, wearleveling_v2_mountStep(handle, 3));
+        ASSERT_EQ(13U, mock_numOfReads);
+        wearleveling_v2_read(handle, dummy_data_read);
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+        /* or all at once on the first read */
+        handle = wearleveling_v2_constructLazy(&wearlevelingState, &params, NULL);
+        ASSERT_EQ(0, wearleveling_v2_mountStep(handle, 2));
+        memset(dummy_data_read, 0, sizeof(dummy_data_read));
+        ASSERT_EQ(1, wearleveling_v2_read(handle, dummy_data_read));
+        ASSERT_EQ(1, wearleveling_v2_isMounted(handle));
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+        /* a blank page is formated by the first save */
+        mock_pageErase();
+        page[0] = 0xFF;
+        page[1] = 0xFF;
+        handle = wearleveling_v2_constructLazy(&wearlevelingState, &params, NULL);
+        ASSERT_EQ(0xFFFF, mock_readTwoByte(0));
+        ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data));
+        handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        ASSERT_EQ(1, handle->indexBucketWrite);
+        wearleveling_v2_read(handle, dummy_data_read);
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+    }
+    TEST_F(wearlevelingLibraryTest, lazy_mount_2_budget)
+    {
+        /* 2 byte buckets: 240 of them and a 30 byte bitmap in 512 bytes */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 512,
+            .dataSizeInByte = 1,
+            .readTwoByte = mock_countingReadTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        wearleveling_config_typeDef config = { NULL, 1 };
+        uint8_t dummy_data [1] = { 0 };
+        uint8_t dummy_data_read [1] = { 0 };
+
+        mock_pageErase();
+        wearleveling_state_typeDef wearlevelingState;
+        wearleveling_handle_typeDef handle = wearleveling_v2_constructWithConfig(&wearlevelingState, &params, &config);
+        ASSERT_EQ(240, handle->numOfBuckets);
+        ASSERT_EQ(30, handle->bitmapSizeInByte);
+        for(uint16_t i = 0; i < 200; i++)
+        {
+            dummy_data[0] = (uint8_t)i;
+            ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data));
+        }
+
+        /* never more than maxReads per step: the flag, 13 bitmap half words, the first empty bucket, its blank check and the newest flag */
+        handle = wearleveling_v2_constructLazy(&wearlevelingState, &params, &config);
+        uint32_t numOfSteps = 0;
+        uint8_t isMounted = 0;
+        mock_numOfReads = 0;
+        while (isMounted == 0)
+        {
+            const uint32_t NUM_OF_READS_BEFORE = mock_numOfReads;
+            isMounted = wearleveling_v2_mountStep(handle, 2);
+            ASSERT_LE(mock_numOfReads - NUM_OF_READS_BEFORE, 2U);
+            numOfSteps++;
+        }
+        ASSERT_EQ(17U, mock_numOfReads);
+        ASSERT_EQ(9U, numOfSteps);
+        ASSERT_EQ(200, handle->indexBucketWrite);
+        ASSERT_EQ(1, wearleveling_v2_read(handle, dummy_data_read));
+        ASSERT_EQ(dummy_data[0], dummy_data_read[0]);
+
+        /* a blank page: the step that finds it reads, the next one erases */
+        mock_pageErase();
+        page[0] = 0xFF;
+        page[1] = 0xFF;
+        handle = wearleveling_v2_constructLazy(&wearlevelingState, &params, &config);
+        mock_numOfReads = 0;
+        ASSERT_EQ(0, wearleveling_v2_mountStep(handle, 2));
+        ASSERT_EQ(1U, mock_numOfReads);
+        ASSERT_EQ(0U, wearleveling_v2_getNumOfErases(handle));
+        ASSERT_EQ(0xFFFF, mock_readTwoByte(0));
+        ASSERT_EQ(1, wearleveling_v2_mountStep(handle, 2));
+        ASSERT_EQ(1U, mock_numOfReads);
+        ASSERT_EQ(1U, wearleveling_v2_getNumOfErases(handle));
+        ASSERT_EQ(0, handle->indexBucketWrite);
+
+        /* ping-pong headers take 4 reads in one step, a smaller budget does nothing */
+        wearleveling_sector_params_typeDef sectorParams = 
+        {
+            .spareSectorAddr = 1024,
+            .sectorErase = mock_sectorErase64,
+        };
+        wearleveling_params_typeDef pingPongParams = 
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 6,
+            .readTwoByte = mock_countingReadTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+        const wearleveling_config_typeDef pingPongConfig = { &sectorParams, 0 };
+        mock_pageErase();
+        handle = wearleveling_v2_constructLazy(&wearlevelingState, &pingPongParams, &pingPongConfig);
+        mock_numOfReads = 0;
+        ASSERT_EQ(0, wearleveling_v2_mountStep(handle, 3));
+        ASSERT_EQ(0U, mock_numOfReads);
+        ASSERT_EQ(0, wearleveling_v2_mountStep(handle, 4));
+        ASSERT_EQ(4U, mock_numOfReads);
+        ASSERT_EQ(1, wearleveling_v2_mountStep(handle, 4));
+        ASSERT_EQ(4U, mock_numOfReads);
+        ASSERT_EQ(1U, wearleveling_v2_getNumOfErases(handle));
+    }
+    TEST_F(wearlevelingLibraryTest, geometry_1)
+    {
+        /* common data */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 5,
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        uint8_t dummy_data [5] = { 1, 2, 3, 4, 5 };
+        uint8_t dummy_data_read [8] = { 0 };
+        uint8_t scratch [8] = { 0 };
+
+        mock_pageErase();
+        wearleveling_state_typeDef wearlevelingState;
+        wearleveling_handle_typeDef handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        for(uint16_t i = 0; i < 3; i++)
+        {
+            dummy_data[0] = (uint8_t)i;
+            ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data));
+        }
+
+        /* a plain page gets the geometry header, same record size */
+        handle = wearleveling_v2_constructWithGeometry(&wearlevelingState, &params, NULL, scratch);
+        ASSERT_NE(nullptr, handle);
+        ASSERT_EQ(0x35, page[0]);
+        ASSERT_EQ(0x12, page[1]);
+        ASSERT_EQ(1, page[2]);
+        ASSERT_EQ(5, page[4]);
+        ASSERT_EQ(64, page[6]);
+        ASSERT_EQ(1, handle->indexBucketWrite);
+        ASSERT_EQ(1, wearleveling_v2_read(handle, dummy_data_read));
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+        /* a matching header costs nothing */
+        ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data));
+        handle = wearleveling_v2_constructWithGeometry(&wearlevelingState, &params, NULL, scratch);
+        ASSERT_EQ(0U, wearleveling_v2_getNumOfErases(handle));
+        ASSERT_EQ(2, handle->indexBucketWrite);
+
+        /* a longer record keeps the old bytes and is padded with zeros */
+        params.dataSizeInByte = 8;
+        handle = wearleveling_v2_constructWithGeometry(&wearlevelingState, &params, NULL, scratch);
+        ASSERT_NE(nullptr, handle);
+        ASSERT_EQ(1U, wearleveling_v2_getNumOfErases(handle));
+        ASSERT_EQ(8, page[4]);
+        ASSERT_EQ(1, wearleveling_v2_read(handle, dummy_data_read));
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+        ASSERT_EQ(0, dummy_data_read[5]);
+        ASSERT_EQ(0, dummy_data_read[7]);
+
+        /* a shorter one keeps its head */
+        params.dataSizeInByte = 3;
+        handle = wearleveling_v2_constructWithGeometry(&wearlevelingState, &params, NULL, scratch);
+        memset(dummy_data_read, 0, sizeof(dummy_data_read));
+        ASSERT_EQ(1, wearleveling_v2_read(handle, dummy_data_read));
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, 3));
+        ASSERT_EQ(0, dummy_data_read[3]);
+
+        /* a layout this code does not know is left alone */
+        page[2] = 2;
+        ASSERT_EQ(nullptr, wearleveling_v2_constructWithGeometry(&wearlevelingState, &params, NULL, scratch));
+        ASSERT_EQ(0x35, page[0]);
+
+        /* ping-pong, the copy goes to the spare sector and the old one is kept until it is committed */
+        wearleveling_sector_params_typeDef sectorParams = 
+        {
+            .spareSectorAddr = 1024,
+            .sectorErase = mock_sectorErase64,
+        };
+        wearleveling_config_typeDef config = 
+        {
+            .pSectorParam = &sectorParams,
+            .useAllocationBitmap = 0,
+        };
+
+        mock_pageErase();
+        params.dataSizeInByte = 6;
+        uint8_t record [6] = { 6, 5, 4, 3, 2, 1 };
+        handle = wearleveling_v2_constructPingPong(&wearlevelingState, &params, &sectorParams);
+        ASSERT_EQ(1, wearleveling_v2_save(handle, record));
+        ASSERT_EQ(1, wearleveling_v2_save(handle, record));
+        handle = wearleveling_v2_constructWithGeometry(&wearlevelingState, &params, &config, scratch);
+        ASSERT_EQ(1024U, handle->baseAddr);
+        ASSERT_EQ(0x34, page[0]);
+        ASSERT_EQ(0x35, page[1024]);
+        ASSERT_EQ(6, page[1024 + 6]);
+
+        params.dataSizeInByte = 8;
+        handle = wearleveling_v2_constructWithGeometry(&wearlevelingState, &params, &config, scratch);
+        ASSERT_NE(nullptr, handle);
+        ASSERT_EQ(0U, handle->baseAddr);
+        ASSERT_EQ(2, handle->sequence);
+        ASSERT_EQ(6, page[1024 + 6]);
+        ASSERT_EQ(8, page[6]);
+        ASSERT_EQ(1, handle->indexBucketWrite);
+        memset(dummy_data_read, 0xAA, sizeof(dummy_data_read));
+        ASSERT_EQ(1, wearleveling_v2_read(handle, dummy_data_read));
+        ASSERT_EQ(0, memcmp(record, dummy_data_read, sizeof(record)));
+        ASSERT_EQ(0, dummy_data_read[6]);
+
+        /* and keeps working in the new layout across switches */
+        for(uint16_t i = 0; i < 30; i++)
+        {
+            dummy_data_read[7] = (uint8_t)i;
+            ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data_read));
+            while (wearleveling_v2_compactStep(handle, 4));
+
+            uint8_t check [8] = { 0 };
+            handle = wearleveling_v2_constructWithGeometry(&wearlevelingState, &params, &config, scratch);
+            ASSERT_EQ(1, wearleveling_v2_read(handle, check));
+            ASSERT_EQ(0, memcmp(dummy_data_read, check, sizeof(check)));
+        }
+        ASSERT_EQ(0U, wearleveling_v2_getNumOfForegroundErases(handle));
+    }
+    TEST_F(wearlevelingLibraryTest, geometry_2_plain_mount)
+    {
+        /* common data */
+        wearleveling_params_typeDef params =
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 5,
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        uint8_t dummy_data [5] = { 1, 2, 3, 4, 5 };
+        uint8_t dummy_data_read [5] = { 0 };
+        uint8_t scratch [5] = { 0 };
+
+        mock_pageErase();
+        wearleveling_state_typeDef wearlevelingState;
+        wearleveling_handle_typeDef handle = wearleveling_v2_constructWithGeometry(&wearlevelingState, &params, NULL, scratch);
+        ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data));
+        ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data));
+
+        /* a plain handle with the same params mounts the geometry page as it is */
+        handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        ASSERT_NE(nullptr, handle);
+        ASSERT_EQ(0U, wearleveling_v2_getNumOfErases(handle));
+        ASSERT_EQ(2, handle->indexBucketWrite);
+        ASSERT_EQ(1, wearleveling_v2_read(handle, dummy_data_read));
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+        /* and keeps writing the geometry header across roll overs */
+        for(uint16_t i = 0; i < 20; i++)
+        {
+            dummy_data[0] = (uint8_t)i;
+            ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data));
+        }
+        ASSERT_EQ(0x35, page[0]);
+        ASSERT_EQ(5, page[4]);
+        handle = wearleveling_v2_constructWithGeometry(&wearlevelingState, &params, NULL, scratch);
+        ASSERT_EQ(0U, wearleveling_v2_getNumOfErases(handle));
+        ASSERT_EQ(1, wearleveling_v2_read(handle, dummy_data_read));
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+        /* lazy, the geometry takes a step of its own */
+        handle = wearleveling_v2_constructLazy(&wearlevelingState, &params, NULL);
+        ASSERT_EQ(0, wearleveling_v2_mountStep(handle, 1));
+        ASSERT_EQ(0, wearleveling_v2_mountStep(handle, 2));
+        ASSERT_EQ(1, wearleveling_v2_mountStep(handle, 0xFFFF));
+        ASSERT_EQ(1, wearleveling_v2_read(handle, dummy_data_read));
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+        /* another record size is refused, the page is neither erased nor written */
+        uint8_t image [64];
+        memcpy(image, page, sizeof(image));
+        params.dataSizeInByte = 6;
+        ASSERT_EQ(nullptr, wearleveling_v2_construct(&wearlevelingState, &params));
+        handle = wearleveling_v2_constructLazy(&wearlevelingState, &params, NULL);
+        uint8_t record [6] = { 0 };
+        ASSERT_EQ(0, wearleveling_v2_save(handle, record));
+        ASSERT_EQ(0, wearleveling_v2_read(handle, record));
+        ASSERT_EQ(0, memcmp(image, page, sizeof(image)));
+
+        /* ping-pong, the newer sector is the geometry one */
+        wearleveling_sector_params_typeDef sectorParams =
+        {
+            .spareSectorAddr = 1024,
+            .sectorErase = mock_sectorErase64,
+        };
+        wearleveling_config_typeDef config =
+        {
+            .pSectorParam = &sectorParams,
+            .useAllocationBitmap = 0,
+        };
+
+        mock_pageErase();
+        handle = wearleveling_v2_constructPingPong(&wearlevelingState, &params, &sectorParams);
+        ASSERT_EQ(1, wearleveling_v2_save(handle, record));
+        handle = wearleveling_v2_constructWithGeometry(&wearlevelingState, &params, &config, scratch);
+        ASSERT_EQ(1024U, handle->baseAddr);
+        record[5] = 0x66;
+        ASSERT_EQ(1, wearleveling_v2_save(handle, record));
+
+        handle = wearleveling_v2_constructPingPong(&wearlevelingState, &params, &sectorParams);
+        ASSERT_NE(nullptr, handle);
+        ASSERT_EQ(1024U, handle->baseAddr);
+        uint8_t check [6] = { 0 };
+        ASSERT_EQ(1, wearleveling_v2_read(handle, check));
+        ASSERT_EQ(0, memcmp(record, check, sizeof(record)));
+        for(uint16_t i = 0; i < 20; i++)
+        {
+            record[0] = (uint8_t)i;
+            ASSERT_EQ(1, wearleveling_v2_save(handle, record));
+            while (wearleveling_v2_compactStep(handle, 4));
+        }
+        ASSERT_EQ(0x35, page[handle->baseAddr]);
+        handle = wearleveling_v2_constructPingPong(&wearlevelingState, &params, &sectorParams);
+        ASSERT_EQ(1, wearleveling_v2_read(handle, check));
+        ASSERT_EQ(0, memcmp(record, check, sizeof(record)));
+    }
+    TEST_F(wearlevelingLibraryTest, compact_1)
+    {
+        /* one device, four stores of 64 bytes each */
+        const wearleveling_compact_device_typeDef device =
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 5,
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_sectorErase64,
+        };
+
+        uint8_t dummy_data [5] = { 0 };
+        uint8_t dummy_data_read [5] = { 0 };
+        wearleveling_compact_state_typeDef stores[4];
+        ASSERT_EQ(4U, sizeof(wearleveling_compact_state_typeDef));
+        ASSERT_EQ(10, wearleveling_compact_getNumOfBuckets(&device));
+
+        mock_pageErase();
+        for(uint16_t i = 0; i < 4; i++)
+        {
+            ASSERT_EQ(1, wearleveling_compact_construct(&device, &stores[i], i));
+            ASSERT_EQ(0, wearleveling_compact_read(&device, &stores[i], dummy_data_read));
+        }
+
+        /* store n gets n + 1 saves per round, the pages roll over on their own */
+        for(uint16_t round = 0; round < 12; round++)
+        {
+            for(uint16_t i = 0; i < 4; i++)
+            {
+                for(uint16_t j = 0; j <= i; j++)
+                {
+                    dummy_data[0] = (uint8_t)i;
+                    dummy_data[4] = (uint8_t)(round + j);
+                    ASSERT_EQ(1, wearleveling_compact_save(&device, &stores[i], dummy_data));
+                }
+            }
+        }
+
+        for(uint16_t i = 0; i < 4; i++)
+        {
+            const uint16_t NUM_OF_SAVES = 12 * (i + 1);
+            wearleveling_compact_state_typeDef mounted;
+            ASSERT_EQ(1, wearleveling_compact_construct(&device, &mounted, i));
+            ASSERT_EQ(((NUM_OF_SAVES - 1) % 10) + 1, mounted.indexBucketWrite);
+            ASSERT_EQ(stores[i].indexBucketWrite, mounted.indexBucketWrite);
+            ASSERT_EQ(1, wearleveling_compact_read(&device, &mounted, dummy_data_read));
+            ASSERT_EQ(i, dummy_data_read[0]);
+            ASSERT_EQ(11 + i, dummy_data_read[4]);
+        }
+
+        /* same page layout as a single page v2 store */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 5,
+            .readTwoByte = mock_regionReadTwoByte<128>,
+            .writeTwoByte = mock_regionWriteTwoByte<128>,
+            .pageErase = mock_regionPageErase<128, 64>,
+        };
+        wearleveling_state_typeDef wearlevelingState;
+        wearleveling_handle_typeDef handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        ASSERT_EQ(stores[2].indexBucketWrite, handle->indexBucketWrite);
+        wearleveling_v2_read(handle, dummy_data_read);
+        ASSERT_EQ(2, dummy_data_read[0]);
+        ASSERT_EQ(13, dummy_data_read[4]);
+    }
+    TEST_F(wearlevelingLibraryTest, threads_1)
+    {
+        /* 4 threads, 32 stores each, every store on its own page */
+        const uint32_t NUM_OF_THREADS = 4;
+        const uint32_t NUM_OF_STORES = 128;
+        std::vector<uint8_t> pages(NUM_OF_STORES * 64, 0xFF);
+        std::vector<wearleveling_state_typeDef> states(NUM_OF_STORES);
+        std::vector<uint32_t> numOfMismatches(NUM_OF_THREADS, 0);
+
+        auto worker = [&](const uint32_t first)
+        {
+            wearleveling_params_typeDef params = 
+            {
+                .pageCapacityInByte = 64,
+                .dataSizeInByte = 5,
+                .readTwoByte = mock_threadReadTwoByte,
+                .writeTwoByte = mock_threadWriteTwoByte,
+                .pageErase = mock_threadPageErase,
+            };
+
+            for(uint32_t i = first; i < NUM_OF_STORES; i += NUM_OF_THREADS)
+            {
+                mock_pThreadPage = pages.data() + (i * 64);
+                wearleveling_v2_construct(&states[i], &params);
+            }
+
+            for(uint32_t n = 0; n < 50; n++)
+            {
+                for(uint32_t i = first; i < NUM_OF_STORES; i += NUM_OF_THREADS)
+                {
+                    uint8_t data [5] = { (uint8_t)i, (uint8_t)n, (uint8_t)first, 0, (uint8_t)(i ^ n) };
+                    uint8_t dataRead [5] = { 0 };
+                    mock_pThreadPage = pages.data() + (i * 64);
+                    if (wearleveling_v2_save(&states[i], data) == 0) numOfMismatches[first]++;
+                    wearleveling_v2_read(&states[i], dataRead);
+                    if (memcmp(data, dataRead, sizeof(data)) != 0) numOfMismatches[first]++;
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for(uint32_t t = 0; t < NUM_OF_THREADS; t++) threads.emplace_back(worker, t);
+        for(auto & thread : threads) thread.join();
+
+        for(uint32_t t = 0; t < NUM_OF_THREADS; t++) ASSERT_EQ(0U, numOfMismatches[t]);
+
+        /* and every page mounts to its own last record */
+        for(uint32_t i = 0; i < NUM_OF_STORES; i++)
+        {
+            wearleveling_params_typeDef params = 
+            {
+                .pageCapacityInByte = 64,
+                .dataSizeInByte = 5,
+                .readTwoByte = mock_threadReadTwoByte,
+                .writeTwoByte = mock_threadWriteTwoByte,
+                .pageErase = mock_threadPageErase,
+            };
+            uint8_t data [5] = { (uint8_t)i, 49, (uint8_t)(i % NUM_OF_THREADS), 0, (uint8_t)(i ^ 49) };
+            uint8_t dataRead [5] = { 0 };
+            mock_pThreadPage = pages.data() + (i * 64);
+            wearleveling_state_typeDef state;
+            wearleveling_v2_read(wearleveling_v2_construct(&state, &params), dataRead);
+            ASSERT_EQ(0, memcmp(data, dataRead, sizeof(data)));
+        }
+    }
+    TEST_F(wearlevelingLibraryTest, cpp_wrapper_policy)
+    {
+        struct record { uint8_t data[7]; };
+
+        mock_pageErase();
+        wearlevelingLibrary::WearLeveled<record, 64, 2, mock_backend> store;
+        static_assert(sizeof(store) == sizeof(uint16_t), "a static backend takes no room");
+
+        record dataWrite;
+        for(uint16_t i = 0; i < 30; i++)
+        {
+            fillRandomData(dataWrite.data, sizeof(dataWrite.data) - 1);
+            ASSERT_TRUE(store.save(dataWrite));
+        }
+
+        /* same page as the callback build */
+        wearlevelingLibrary::WearLeveled<record, 64> remounted(mock_readTwoByte, mock_writeTwoByte, mock_pageErase);
+        ASSERT_EQ(store.getIndexBucketWrite(), remounted.getIndexBucketWrite());
+        ASSERT_EQ(0, memcmp(dataWrite.data, remounted.load().data, sizeof(record)));
+    }
+
+    TEST_F(wearlevelingLibraryTest, view_1)
+    {
+        /* common data */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 5,
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        uint8_t dummy_data [5] = { 0 };
+
+        mock_pageErase();
+        wearleveling_state_typeDef wearlevelingState;
+        const wearleveling_handle_typeDef handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        wearleveling_v2_setMappedBase(handle, page);
+
+        /* nothing saved yet */
+        wearleveling_view_typeDef view = wearleveling_v2_view(handle);
+        ASSERT_EQ(NULL, view.pData);
+        ASSERT_EQ(0, wearleveling_v2_isViewValid(handle, &view));
+
+        for(uint16_t i = 0; i < 100; i++)
+        {
+            fillRandomData(dummy_data, sizeof(dummy_data) - 1);
+            wearleveling_v2_save(handle, dummy_data);
+
+            view = wearleveling_v2_view(handle);
+            ASSERT_EQ(5, view.lengthInByte);
+            ASSERT_EQ(1, wearleveling_v2_isViewValid(handle, &view));
+            ASSERT_EQ(0, memcmp(dummy_data, view.pData, sizeof(dummy_data)));
+            ASSERT_EQ(page + 2 + (handle->indexBucketRead * handle->bucketSize), view.pData);
+
+            wearleveling_v2_save(handle, dummy_data);
+            ASSERT_EQ(0, wearleveling_v2_isViewValid(handle, &view));
+        }
+    }
+
+    TEST_F(wearlevelingLibraryTest, view_2_not_mapped)
+    {
+        /* common data */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 5,
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        uint8_t dummy_data [5] = { 0x11, 0x22, 0x33, 0x44, 0x55 };
+
+        mock_pageErase();
+        wearleveling_state_typeDef wearlevelingState;
+        const wearleveling_handle_typeDef handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        wearleveling_v2_save(handle, dummy_data);
+
+        const wearleveling_view_typeDef view = wearleveling_v2_view(handle);
+        ASSERT_EQ(NULL, view.pData);
+        ASSERT_EQ(0, view.lengthInByte);
+        ASSERT_EQ(0, wearleveling_v2_isViewValid(handle, &view));
+    }
+
+    TEST_F(wearlevelingLibraryTest, scheduler_1)
+    {
+        /* three stores on one device, 7 buckets per page; the third is ping-pong with its spare at 3072 */
+        wearleveling_params_typeDef params[3] = 
+        {
+            { 64, 6, mock_regionReadTwoByte<0>,    mock_regionWriteTwoByte<0>,    mock_regionPageErase<0, 64> },
+            { 64, 6, mock_regionReadTwoByte<1024>, mock_regionWriteTwoByte<1024>, mock_regionPageErase<1024, 64> },
+            { 64, 6, mock_regionReadTwoByte<2048>, mock_regionWriteTwoByte<2048>, mock_regionPageErase<2048, 64> },
+        };
+
+        wearleveling_sector_params_typeDef sectorParams = 
+        {
+            .spareSectorAddr = 1024,
+            .sectorErase = mock_regionSectorErase<2048, 64>,
+        };
+
+        uint8_t scratch[16];
+        wearleveling_scheduler_params_typeDef schedulerParams = 
+        {
+            .fillThresholdInPercent = 50,
+            .minEraseInterval = 100,
+            .pScratch = scratch,
+            .scratchSizeInByte = sizeof(scratch),
+        };
+
+        mock_pageErase();
+        wearleveling_scheduler_entry_typeDef entries[3];
+        wearleveling_scheduler_state_typeDef schedulerState;
+        const wearleveling_scheduler_handle_typeDef scheduler = wearleveling_scheduler_construct(&schedulerState, &schedulerParams, entries, 3);
+
+        wearleveling_state_typeDef wearlevelingState[3];
+        wearleveling_handle_typeDef handle[3];
+        handle[0] = wearleveling_v2_construct(&wearlevelingState[0], &params[0]);
+        handle[1] = wearleveling_v2_construct(&wearlevelingState[1], &params[1]);
+        handle[2] = wearleveling_v2_constructPingPong(&wearlevelingState[2], &params[2], &sectorParams);
+        for(uint16_t i = 0; i < 3; i++)
+        {
+            ASSERT_EQ(7, handle[i]->numOfBuckets);
+            ASSERT_EQ(1, wearleveling_scheduler_register(scheduler, handle[i]));
+        }
+
+        uint8_t dummy_data [6] = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+        uint8_t dummy_data_read [6] = { 0 };
+        const uint16_t NUM_OF_SAVES[3] = { 7, 4, 4 };
+        for(uint16_t i = 0; i < 3; i++)
+        {
+            for(uint16_t j = 0; j < NUM_OF_SAVES[i]; j++)
+            {
+                dummy_data[0] = (uint8_t)(i * 16 + j);
+                wearleveling_v2_save(handle[i], dummy_data);
+            }
+        }
+
+        /* bus busy, only queued; a single page is not rolled over before it is full */
+        ASSERT_EQ(0, wearleveling_scheduler_run(scheduler, 0, 0));
+        ASSERT_EQ(2, wearleveling_scheduler_getQueueDepth(scheduler));
+
+        /* fullest store goes first */
+        ASSERT_EQ(1, wearleveling_scheduler_run(scheduler, 10, 1));
+        ASSERT_EQ(1, wearleveling_scheduler_getQueueDepth(scheduler));
+        ASSERT_EQ(1, handle[0]->indexBucketWrite);
+        ASSERT_EQ(4, handle[1]->indexBucketWrite);
+        wearleveling_v2_read(handle[0], dummy_data_read);
+        ASSERT_EQ(6, dummy_data_read[0]);
+
+        /* rate limited, then the spare is found erased already */
+        ASSERT_EQ(0, wearleveling_scheduler_run(scheduler, 50, 1));
+        ASSERT_EQ(1, wearleveling_scheduler_run(scheduler, 200, 1));
+        ASSERT_EQ(WEARLEVELING_LIB_SPARE_ERASED, handle[2]->spareState);
+        ASSERT_EQ(0, wearleveling_scheduler_getQueueDepth(scheduler));
+        ASSERT_EQ(1, wearleveling_scheduler_getNumOfErases(scheduler));
+
+        /* a full ping-pong store is switched without an erase, the erase of the old sector comes later */
+        for(uint16_t j = 0; j < 3; j++) wearleveling_v2_save(handle[2], dummy_data);
+        ASSERT_EQ(1, wearleveling_scheduler_run(scheduler, 210, 1));
+        ASSERT_EQ(1, handle[2]->indexBucketWrite);
+        ASSERT_EQ(WEARLEVELING_LIB_SPARE_DIRTY, handle[2]->spareState);
+        ASSERT_EQ(1, wearleveling_scheduler_getNumOfErases(scheduler));
+
+        for(uint16_t j = 0; j < 3; j++) wearleveling_v2_save(handle[2], dummy_data);
+        ASSERT_EQ(1, wearleveling_scheduler_run(scheduler, 220, 1));
+        ASSERT_EQ(WEARLEVELING_LIB_SPARE_ERASED, handle[2]->spareState);
+        ASSERT_EQ(2, wearleveling_scheduler_getNumOfErases(scheduler));
+        ASSERT_EQ(0U, wearleveling_v2_getNumOfForegroundErases(handle[2]));
+        wearleveling_v2_read(handle[2], dummy_data_read);
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+        ASSERT_EQ(0, wearleveling_scheduler_getQueueDepth(scheduler));
+        ASSERT_EQ(2, wearleveling_scheduler_getMaxQueueDepth(scheduler));
+        ASSERT_EQ(200, wearleveling_scheduler_getWorstCaseWait(scheduler));
+
+        /* a store rolled over by its own save leaves the queue */
+        for(uint16_t j = 0; j < 3; j++) wearleveling_v2_save(handle[1], dummy_data);
+        ASSERT_EQ(0, wearleveling_scheduler_run(scheduler, 400, 0));
+        ASSERT_EQ(1, wearleveling_scheduler_getQueueDepth(scheduler));
+        wearleveling_v2_save(handle[1], dummy_data);
+        ASSERT_EQ(0, wearleveling_scheduler_run(scheduler, 500, 1));
+        ASSERT_EQ(0, wearleveling_scheduler_getQueueDepth(scheduler));
+
+        /* full with a dirty spare: erase in one slice, switch in the next, the wait counts from the first enqueue */
+        for(uint16_t j = 0; (j < 20) && ((handle[2]->indexBucketWrite < 7) || (handle[2]->spareState != WEARLEVELING_LIB_SPARE_DIRTY)); j++)
+        {
+            wearleveling_v2_save(handle[2], dummy_data);
+        }
+        ASSERT_EQ(7, handle[2]->indexBucketWrite);
+        ASSERT_EQ(0U, wearleveling_v2_getNumOfForegroundErases(handle[2]));
+        ASSERT_EQ(0, wearleveling_scheduler_run(scheduler, 1000, 0));
+        ASSERT_EQ(1, wearleveling_scheduler_run(scheduler, 1010, 1));
+        ASSERT_EQ(WEARLEVELING_LIB_SPARE_ERASED, handle[2]->spareState);
+        ASSERT_EQ(1, wearleveling_scheduler_getQueueDepth(scheduler));
+        ASSERT_EQ(0, wearleveling_scheduler_run(scheduler, 1050, 1));
+        ASSERT_EQ(1, wearleveling_scheduler_run(scheduler, 1300, 1));
+        ASSERT_EQ(1, handle[2]->indexBucketWrite);
+        ASSERT_EQ(0, wearleveling_scheduler_getQueueDepth(scheduler));
+        ASSERT_EQ(300, wearleveling_scheduler_getWorstCaseWait(scheduler));
+    }
+
+    TEST_F(wearlevelingLibraryTest, ping_pong_1_background_compaction)
+    {
+        /* common data, 7 buckets per sector */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 6,
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        wearleveling_sector_params_typeDef sectorParams = 
+        {
+            .spareSectorAddr = 1024,
+            .sectorErase = mock_sectorErase64,
+        };
+
+        uint8_t dummy_data [6] = { 0 };
+        uint8_t dummy_data_read [6] = { 0 };
+
+        mock_pageErase();
+        wearleveling_state_typeDef wearlevelingState;
+        wearleveling_handle_typeDef handle = wearleveling_v2_constructPingPong(&wearlevelingState, &params, &sectorParams);
+        ASSERT_EQ(7, handle->numOfBuckets);
+        ASSERT_EQ(0x34, page[0]);
+        ASSERT_EQ(0x12, page[1]);
+        ASSERT_EQ(0x00, page[2]);
+        ASSERT_EQ(0x00, page[3]);
+
+        for(uint16_t i = 0; i < 200; i++)
+        {
+            dummy_data[0] = (uint8_t)i;
+            dummy_data[5] = (uint8_t)(i >> 8);
+            ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data));
+
+            /* idle time, small steps until there is nothing left to do */
+            while (wearleveling_v2_compactStep(handle, 2));
+
+            wearleveling_v2_read(handle, dummy_data_read);
+            ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+            handle = wearleveling_v2_constructPingPong(&wearlevelingState, &params, &sectorParams);
+            wearleveling_v2_read(handle, dummy_data_read);
+            ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+        }
+
+        /* 200 saves, the first sector switch after 7 and one every 6 saves after that */
+        ASSERT_EQ((200 - 7) / 6 + 1, handle->sequence);
+        ASSERT_EQ(0, wearleveling_v2_getNumOfForegroundErases(handle));
+    }
+
+    TEST_F(wearlevelingLibraryTest, ping_pong_2_save_during_compaction)
+    {
+        /* common data, 7 buckets per sector */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 7,
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        wearleveling_sector_params_typeDef sectorParams = 
+        {
+            .spareSectorAddr = 1024,
+            .sectorErase = mock_sectorErase64,
+        };
+
+        uint8_t dummy_data [7] = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77 };
+        uint8_t dummy_data_read [7] = { 0 };
+
+        mock_pageErase();
+        wearleveling_state_typeDef wearlevelingState;
+        wearleveling_handle_typeDef handle = wearleveling_v2_constructPingPong(&wearlevelingState, &params, &sectorParams);
+        for(uint16_t i = 0; i < 7; i++) wearleveling_v2_save(handle, dummy_data);
+
+        /* blank check of the spare, sequence number, then one half word of the copy */
+        while (handle->spareState != 2) wearleveling_v2_compactStep(handle, 8);
+        ASSERT_EQ(1, wearleveling_v2_compactStep(handle, 1));
+        ASSERT_EQ(1, wearleveling_v2_compactStep(handle, 1));
+        ASSERT_EQ(0x11, page[1024 + 4]);
+        ASSERT_EQ(0xFF, page[1024 + 6]);
+
+        /* the save lands in bucket 1 of the spare and commits the switch, nothing is erased */
+        dummy_data[6] = 0xAB;
+        ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data));
+        ASSERT_EQ(1024, handle->baseAddr);
+        ASSERT_EQ(1, handle->indexBucketRead);
+        ASSERT_EQ(0, wearleveling_v2_getNumOfForegroundErases(handle));
+        ASSERT_EQ(0x00, page[1024 + 4 + 7]);
+
+        wearleveling_v2_read(handle, dummy_data_read);
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+        /* both sectors are formated until the old one is erased, the newer one wins */
+        handle = wearleveling_v2_constructPingPong(&wearlevelingState, &params, &sectorParams);
+        ASSERT_EQ(1024, handle->baseAddr);
+        ASSERT_EQ(2, handle->indexBucketWrite);
+        wearleveling_v2_read(handle, dummy_data_read);
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+        /* the torn copy in bucket 0 is sealed as discarded, the history holds the fresh record only */
+        uint8_t history [2 * 7] = { 0 };
+        ASSERT_EQ(1U, wearleveling_v2_exportHistory(handle, history, 2));
+        ASSERT_EQ(0, memcmp(dummy_data, history, sizeof(dummy_data)));
+
+        wearleveling_iter_typeDef iter = wearleveling_v2_iterBegin(handle);
+        uint16_t indexBucket = 0xFFFF;
+        ASSERT_EQ(1, wearleveling_v2_iterNext(handle, &iter, &indexBucket, dummy_data_read));
+        ASSERT_EQ(1U, indexBucket);
+        ASSERT_EQ(0, wearleveling_v2_iterNext(handle, &iter, &indexBucket, dummy_data_read));
+
+        ASSERT_EQ(1, wearleveling_v2_compactStep(handle, 1));
+        ASSERT_EQ(0xFF, page[0]);
+        ASSERT_EQ(0, wearleveling_v2_compactStep(handle, 1));
+    }
+
+    TEST_F(wearlevelingLibraryTest, ping_pong_3_foreground_erase)
+    {
+        /* common data */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 6,
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        wearleveling_sector_params_typeDef sectorParams = 
+        {
+            .spareSectorAddr = 1024,
+            .sectorErase = mock_sectorErase64,
+        };
+
+        uint8_t dummy_data [6] = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+
+        /* no idle time at all, the save that finds both sectors used has to erase */
+        mock_pageErase();
+        wearleveling_state_typeDef wearlevelingState;
+        const wearleveling_handle_typeDef handle = wearleveling_v2_constructPingPong(&wearlevelingState, &params, &sectorParams);
+        for(uint16_t i = 0; i < 7 + 1 + 6 + 1; i++) wearleveling_v2_save(handle, dummy_data);
+        ASSERT_EQ(2, handle->sequence);
+        ASSERT_EQ(2, wearleveling_v2_getNumOfForegroundErases(handle));
+    }
+
+    TEST_F(wearlevelingLibraryTest, bitmap_1)
+    {
+        /* common data */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 1024,
+            .dataSizeInByte = 6,
+            .readTwoByte = mock_countingReadTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        wearleveling_config_typeDef config = 
+        {
+            .pSectorParam = NULL,
+            .useAllocationBitmap = 1,
+        };
+
+        uint8_t dummy_data [6] = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+        uint8_t dummy_data_read [6] = { 0 };
+
+        /* 2 + 16 + 125 * 8 = 1018 bytes */
+        mock_pageErase();
+        wearleveling_state_typeDef wearlevelingState;
+        wearleveling_handle_typeDef handle = wearleveling_v2_constructWithConfig(&wearlevelingState, &params, &config);
+        ASSERT_EQ(125, handle->numOfBuckets);
+        ASSERT_EQ(16, handle->bitmapSizeInByte);
+
+        for(uint16_t i = 0; i < 20; i++)
+        {
+            dummy_data[0] = (uint8_t)i;
+            wearleveling_v2_save(handle, dummy_data);
+        }
+
+        ASSERT_EQ(0x00, page[2]);
+        ASSERT_EQ(0x00, page[3]);
+        ASSERT_EQ(0xF0, page[4]);
+        ASSERT_EQ(0xFF, page[5]);
+        ASSERT_EQ(0xFF, page[6]);
+        ASSERT_EQ(0x13, page[2 + 16 + 19 * 8]);
+
+        /* formated flag, two bitmap half words, the dirty flag of the frontier bucket, its three data half words and the newest flag */
+        mock_numOfReads = 0;
+        handle = wearleveling_v2_constructWithConfig(&wearlevelingState, &params, &config);
+        ASSERT_EQ(8, mock_numOfReads);
+        ASSERT_EQ(20, handle->indexBucketWrite);
+        ASSERT_EQ(19, handle->indexBucketRead);
+        wearleveling_v2_read(handle, dummy_data_read);
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+        /* power lost before the bitmap write of the last save */
+        page[4] = 0xF8;
+        handle = wearleveling_v2_constructWithConfig(&wearlevelingState, &params, &config);
+        ASSERT_EQ(20, handle->indexBucketWrite);
+    }
+
+    TEST_F(wearlevelingLibraryTest, bitmap_2_roll_over)
+    {
+        /* common data */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 128,
+            .dataSizeInByte = 5,
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        wearleveling_sector_params_typeDef sectorParams = 
+        {
+            .spareSectorAddr = 1024,
+            .sectorErase = mock_sectorErase128,
+        };
+
+        wearleveling_config_typeDef configs[2] = 
+        {
+            { NULL, 1 },
+            { &sectorParams, 1 },
+        };
+
+        uint8_t dummy_data [5] = { 0 };
+        uint8_t dummy_data_read [5] = { 0 };
+
+        for(uint16_t c = 0; c < 2; c++)
+        {
+            mock_pageErase();
+            wearleveling_state_typeDef wearlevelingState;
+            wearleveling_handle_typeDef handle = wearleveling_v2_constructWithConfig(&wearlevelingState, &params, &configs[c]);
+            ASSERT_EQ(20, handle->numOfBuckets);
+
+            for(uint16_t i = 0; i < 300; i++)
+            {
+                fillRandomData(dummy_data, sizeof(dummy_data) - 1);
+                ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data));
+                if (i % 3) while (wearleveling_v2_compactStep(handle, 4));
+
+                const uint16_t INDEX_BUCKET_WRITE = handle->indexBucketWrite;
+                handle = wearleveling_v2_constructWithConfig(&wearlevelingState, &params, &configs[c]);
+                ASSERT_EQ(INDEX_BUCKET_WRITE, handle->indexBucketWrite);
+                wearleveling_v2_read(handle, dummy_data_read);
+                ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+            }
+        }
+    }
+    TEST_F(wearlevelingLibraryTest, async_1)
+    {
+        /* async saves leave the same page behind as sync saves */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 5,
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        uint8_t dummy_data [25][5] = { { 0 } };
+        uint8_t dummy_data_read [5] = { 0 };
+        uint8_t asyncBuffer [6] = { 0 };
+        static uint8_t expectedPage [64];
+
+        mock_pageErase();
+        wearleveling_state_typeDef wearlevelingState;
+        wearleveling_handle_typeDef handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        ASSERT_EQ(1, wearleveling_v2_setAsyncDriver(handle, &mock_asyncDriver, asyncBuffer));
+
+        for(uint16_t i = 0; i < 25; i++)
+        {
+            fillRandomData(dummy_data[i], sizeof(dummy_data[i]) - 1);
+            const uint16_t INDEX_BUCKET_READ = handle->indexBucketRead;
+
+            ASSERT_EQ(1, wearleveling_v2_saveAsync(handle, dummy_data[i], NULL, NULL));
+            ASSERT_EQ(1, wearleveling_v2_isBusy(handle));
+            ASSERT_EQ(0, wearleveling_v2_saveAsync(handle, dummy_data[i], NULL, NULL));
+            ASSERT_EQ(((i % 10) == 0) && (i > 0) ? 0 : INDEX_BUCKET_READ, handle->indexBucketRead);
+            ASSERT_EQ(0, wearleveling_v2_save(handle, dummy_data[i]));
+            ASSERT_EQ(0, wearleveling_v2_read(handle, dummy_data_read));
+
+            /* three transfers on a roll over: erase, formated flag, record */
+            const uint32_t NUM_OF_TRANSFERS = mock_drainAsyncQueue();
+            ASSERT_EQ(((i % 10) == 0) && (i > 0) ? 3U : 1U, NUM_OF_TRANSFERS);
+            ASSERT_EQ(0, wearleveling_v2_isBusy(handle));
+            ASSERT_EQ(1, wearleveling_v2_getAsyncResult(handle));
+
+            ASSERT_EQ(1, wearleveling_v2_readAsync(handle, dummy_data_read, NULL, NULL));
+            mock_drainAsyncQueue();
+            ASSERT_EQ(0, memcmp(dummy_data[i], dummy_data_read, sizeof(dummy_data_read)));
+        }
+
+        memcpy(expectedPage, page, sizeof(expectedPage));
+        const uint16_t INDEX_BUCKET_WRITE = handle->indexBucketWrite;
+        handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        ASSERT_EQ(INDEX_BUCKET_WRITE, handle->indexBucketWrite);
+
+        mock_pageErase();
+        handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        for(uint16_t i = 0; i < 25; i++)
+        {
+            wearleveling_v2_save(handle, dummy_data[i]);
+        }
+        ASSERT_EQ(0, memcmp(expectedPage, page, sizeof(expectedPage)));
+
+        /* a roll over that fails after its erase: views are stale from the submit on, the store comes back empty */
+        mock_pageErase();
+        mock_asyncQueue.clear();
+        mock_asyncRegions.clear();
+        handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        ASSERT_EQ(1, wearleveling_v2_setAsyncDriver(handle, &mock_asyncDriver, asyncBuffer));
+        wearleveling_v2_setMappedBase(handle, page);
+        for(uint16_t i = 0; i < 10; i++)
+        {
+            ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data[i]));
+        }
+        const wearleveling_view_typeDef VIEW = wearleveling_v2_view(handle);
+        ASSERT_EQ(1, wearleveling_v2_isViewValid(handle, &VIEW));
+        ASSERT_EQ(1, wearleveling_v2_saveAsync(handle, dummy_data[10], NULL, NULL));
+        ASSERT_EQ(0, wearleveling_v2_isViewValid(handle, &VIEW));
+        ASSERT_EQ(1, mock_runAsyncTransfer());
+        const mock_asyncTransfer_typeDef FAILED_TRANSFER = mock_asyncQueue.front();
+        mock_asyncQueue.pop_front();
+        FAILED_TRANSFER.done(FAILED_TRANSFER.pContext, 0);
+        ASSERT_EQ(0, wearleveling_v2_getAsyncResult(handle));
+        ASSERT_EQ(0, wearleveling_v2_read(handle, dummy_data_read));
+        ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data[11]));
+        handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        ASSERT_EQ(1, handle->indexBucketWrite);
+        ASSERT_EQ(1, wearleveling_v2_read(handle, dummy_data_read));
+        ASSERT_EQ(0, memcmp(dummy_data[11], dummy_data_read, sizeof(dummy_data_read)));
+    }
+
+    TEST_F(wearlevelingLibraryTest, async_2_bitmap)
+    {
+        /* common data */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 128,
+            .dataSizeInByte = 5,
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        wearleveling_config_typeDef config = { NULL, 1 };
+        uint8_t dummy_data [5] = { 0 };
+        uint8_t dummy_data_read [5] = { 0 };
+        uint8_t asyncBuffer [6] = { 0 };
+        uint8_t isDone = 0;
+
+        mock_pageErase();
+        wearleveling_state_typeDef wearlevelingState;
+        wearleveling_handle_typeDef handle = wearleveling_v2_constructWithConfig(&wearlevelingState, &params, &config);
+        ASSERT_EQ(1, wearleveling_v2_setAsyncDriver(handle, &mock_asyncDriver, asyncBuffer));
+
+        for(uint16_t i = 0; i < 50; i++)
+        {
+            fillRandomData(dummy_data, sizeof(dummy_data) - 1);
+            isDone = 0;
+            ASSERT_EQ(1, wearleveling_v2_saveAsync(handle, dummy_data,
+                [](void * pContext, uint8_t isSuccess) { *(uint8_t *)pContext = isSuccess; }, &isDone));
+            mock_drainAsyncQueue();
+            ASSERT_EQ(1, isDone);
+
+            const uint16_t INDEX_BUCKET_WRITE = handle->indexBucketWrite;
+            handle = wearleveling_v2_constructWithConfig(&wearlevelingState, &params, &config);
+            ASSERT_EQ(INDEX_BUCKET_WRITE, handle->indexBucketWrite);
+            wearleveling_v2_read(handle, dummy_data_read);
+            ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+            ASSERT_EQ(1, wearleveling_v2_setAsyncDriver(handle, &mock_asyncDriver, asyncBuffer));
+        }
+    }
+    TEST_F(wearlevelingLibraryTest, coro_1)
+    {
+        /* 1024 stores of 32 bytes, all driven by coroutines on this thread */
+        const uint32_t NUM_OF_STORES = PAGE_SIZE_32K / 32;
+        static wearleveling_state_typeDef states[PAGE_SIZE_32K / 32];
+        std::vector<std::unique_ptr<wearlevelingLibrary::AsyncWearLeveled<uint32_t>>> stores;
+        uint32_t numOfMatches = 0;
+
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 32,
+            .dataSizeInByte = sizeof(uint32_t),
+            .readTwoByte = mock_selectedReadTwoByte,
+            .writeTwoByte = mock_selectedWriteTwoByte,
+            .pageErase = mock_selectedPageErase,
+        };
+
+        mock_pageErase();
+        mock_asyncRegions.clear();
+        for(uint32_t i = 0; i < NUM_OF_STORES; i++)
+        {
+            mock_selectedBase = i * 32;
+            wearleveling_handle_typeDef handle = wearleveling_v2_construct(&states[i], &params);
+            mock_asyncRegions[handle] = std::make_pair(i * 32, 32U);
+            stores.push_back(std::make_unique<wearlevelingLibrary::AsyncWearLeveled<uint32_t>>(handle, mock_asyncDriver));
+            ASSERT_TRUE(stores.back()->isValid());
+        }
+
+        /* every coroutine parks on its first transfer, nothing has reached the flash yet */
+        for(uint32_t i = 0; i < NUM_OF_STORES; i++)
+        {
+            mock_runStore(*stores[i], i * 1000, &numOfMatches);
+        }
+        ASSERT_EQ(NUM_OF_STORES, mock_asyncQueue.size());
+        ASSERT_EQ(0U, numOfMatches);
+
+        mock_drainAsyncQueue();
+        ASSERT_EQ(NUM_OF_STORES * 20, numOfMatches);
+
+        for(uint32_t i = 0; i < NUM_OF_STORES; i++)
+        {
+            uint32_t value = 0;
+            mock_selectedBase = i * 32;
+            wearleveling_handle_typeDef handle = wearleveling_v2_construct(&states[i], &params);
+            wearleveling_v2_read(handle, (uint8_t *)&value);
+            ASSERT_EQ(i * 1000 + 19, value);
+        }
+        mock_asyncRegions.clear();
+    }
+    TEST_F(wearlevelingLibraryTest, file_1)
+    {
+        char path[] = "/tmp/wearleveling_file_XXXXXX";
+        const int FD = mkstemp(path);
+        ASSERT_GE(FD, 0);
+        close(FD);
+
+        /* two 4 KiB erase units, one ping-pong store across both */
+        const wearleveling_file_params_typeDef FILE_PARAMS = { 8192, 4096, 0 };
+        ASSERT_EQ(1, wearleveling_file_open(&testFile, path, &FILE_PARAMS));
+        ASSERT_EQ(0xFFFF, wearleveling_file_readTwoByte(&testFile, 8190));
+
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 4096,
+            .dataSizeInByte = 13,
+            .readTwoByte = testFile_readTwoByte,
+            .writeTwoByte = testFile_writeTwoByte,
+            .pageErase = testFile_pageErase,
+        };
+
+        wearleveling_sector_params_typeDef sectorParams = 
+        {
+            .spareSectorAddr = 4096,
+            .sectorErase = testFile_sectorErase,
+        };
+
+        uint8_t dummy_data [13] = { 0 };
+        uint8_t dummy_data_read [13] = { 0 };
+
+        wearleveling_state_typeDef wearlevelingState;
+        wearleveling_handle_typeDef handle = wearleveling_v2_constructPingPong(&wearlevelingState, &params, &sectorParams);
+        ASSERT_NE((wearleveling_handle_typeDef)NULL, handle);
+        for(uint16_t i = 0; i < 1000; i++)
+        {
+            fillRandomData(dummy_data, sizeof(dummy_data) - 1);
+            ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data));
+        }
+        ASSERT_EQ(0U, testFile.numOfRejectedWrites);
+
+        /* the same content after the file is opened again */
+        wearleveling_file_close(&testFile);
+        ASSERT_EQ(1, wearleveling_file_open(&testFile, path, &FILE_PARAMS));
+        handle = wearleveling_v2_constructPingPong(&wearlevelingState, &params, &sectorParams);
+        wearleveling_v2_read(handle, dummy_data_read);
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+        /* the view reads straight from the mapping */
+        wearleveling_v2_setMappedBase(handle, testFile.pMapped);
+        const wearleveling_view_typeDef view = wearleveling_v2_view(handle);
+        ASSERT_EQ(0, memcmp(dummy_data, view.pData, sizeof(dummy_data)));
+
+        wearleveling_file_close(&testFile);
+        unlink(path);
+    }
+
+    TEST_F(wearlevelingLibraryTest, file_2_nor_rules)
+    {
+        char path[] = "/tmp/wearleveling_file_XXXXXX";
+        const int FD = mkstemp(path);
+        ASSERT_GE(FD, 0);
+        close(FD);
+
+        const wearleveling_file_params_typeDef FILE_PARAMS = { 8192, 4096, 1 };
+        ASSERT_EQ(1, wearleveling_file_open(&testFile, path, &FILE_PARAMS));
+
+        /* bits go from 1 to 0 only */
+        ASSERT_EQ(1, wearleveling_file_writeTwoByte(&testFile, 4100, 0xF0F0));
+        ASSERT_EQ(1, wearleveling_file_writeTwoByte(&testFile, 4100, 0xF000));
+        ASSERT_EQ(0, wearleveling_file_writeTwoByte(&testFile, 4100, 0xF00F));
+        ASSERT_EQ(0xF000, wearleveling_file_readTwoByte(&testFile, 4100));
+        ASSERT_EQ(1U, testFile.numOfRejectedWrites);
+        ASSERT_EQ(0, wearleveling_file_writeTwoByte(&testFile, 4101, 0x0000));
+        ASSERT_EQ(0, wearleveling_file_writeTwoByte(&testFile, 8192, 0x0000));
+
+        /* an erase only touches its own unit */
+        ASSERT_EQ(1, wearleveling_file_writeTwoByte(&testFile, 0, 0x0000));
+        ASSERT_EQ(0, wearleveling_file_sectorErase(&testFile, 100));
+        ASSERT_EQ(1, wearleveling_file_sectorErase(&testFile, 4096));
+        ASSERT_EQ(0xFFFF, wearleveling_file_readTwoByte(&testFile, 4100));
+        ASSERT_EQ(0x0000, wearleveling_file_readTwoByte(&testFile, 0));
+        ASSERT_EQ(1, wearleveling_file_pageErase(&testFile));
+        ASSERT_EQ(0xFFFF, wearleveling_file_readTwoByte(&testFile, 0));
+
+        wearleveling_file_close(&testFile);
+        unlink(path);
+    }
+    TEST_F(wearlevelingLibraryTest, read_cache_1)
+    {
+        /* common data */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 5,
+            .readTwoByte = mock_countingReadTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_interruptedPageErase,
+        };
+
+        uint8_t dummy_data [5] = { 0 };
+        uint8_t dummy_data_previous [5] = { 0 };
+        uint8_t dummy_data_read [5] = { 0 };
+        uint8_t cache [2 * 5] = { 0 };
+
+        mock_pageErase();
+        mock_interruptingHandle = NULL;
+        wearleveling_state_typeDef wearlevelingState;
+        wearleveling_handle_typeDef handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        fillRandomData(dummy_data, sizeof(dummy_data) - 1);
+        wearleveling_v2_save(handle, dummy_data);
+
+        /* the cache is filled from flash */
+        handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        ASSERT_EQ(1, wearleveling_v2_setReadCache(handle, cache));
+        mock_numOfReads = 0;
+        wearleveling_v2_read(handle, dummy_data_read);
+        ASSERT_EQ(0U, mock_numOfReads);
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+        /* a read during the roll over erase gets the previous record without touching flash */
+        mock_interruptingHandle = handle;
+        for(uint16_t i = 0; i < 30; i++)
+        {
+            memcpy(dummy_data_previous, dummy_data, sizeof(dummy_data));
+            fillRandomData(dummy_data, sizeof(dummy_data) - 1);
+            memset(mock_interruptingRead, 0, sizeof(mock_interruptingRead));
+            ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data));
+
+            if (handle->indexBucketWrite == 1)
+            {
+                ASSERT_EQ(0, memcmp(dummy_data_previous, mock_interruptingRead, sizeof(dummy_data)));
+                ASSERT_EQ(0U, mock_numOfInterruptingReads);
+            }
+            wearleveling_v2_read(handle, dummy_data_read);
+            ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+        }
+        mock_interruptingHandle = NULL;
+
+        /* what is on flash agrees with the cache */
+        handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        wearleveling_v2_read(handle, dummy_data_read);
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+        /* an async roll over: every step of it, the read gets the previous record from RAM */
+        uint8_t asyncBuffer [6] = { 0 };
+        mock_asyncQueue.clear();
+        mock_asyncRegions.clear();
+        ASSERT_EQ(1, wearleveling_v2_setReadCache(handle, cache));
+        ASSERT_EQ(1, wearleveling_v2_setAsyncDriver(handle, &mock_asyncDriver, asyncBuffer));
+        uint32_t numOfBusyReads = 0;
+        for(uint16_t i = 0; i < 30; i++)
+        {
+            memcpy(dummy_data_previous, dummy_data, sizeof(dummy_data));
+            fillRandomData(dummy_data, sizeof(dummy_data) - 1);
+            ASSERT_EQ(1, wearleveling_v2_saveAsync(handle, dummy_data, NULL, NULL));
+            do
+            {
+                if (wearleveling_v2_isBusy(handle) == 0) break;
+                mock_numOfReads = 0;
+                ASSERT_EQ(1, wearleveling_v2_read(handle, dummy_data_read));
+                ASSERT_EQ(0, memcmp(dummy_data_previous, dummy_data_read, sizeof(dummy_data)));
+                ASSERT_EQ(0U, mock_numOfReads);
+                numOfBusyReads++;
+            } while (mock_runAsyncTransfer());
+            ASSERT_EQ(0, wearleveling_v2_isBusy(handle));
+            ASSERT_EQ(1, wearleveling_v2_read(handle, dummy_data_read));
+            ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+        }
+        /* a program per save, an erase and a format more for each of the 3 roll overs */
+        ASSERT_EQ(30U + (3U * 2U), numOfBusyReads);
+
+        /* without a RAM copy there is nothing to answer with while busy */
+        handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        ASSERT_EQ(1, wearleveling_v2_setAsyncDriver(handle, &mock_asyncDriver, asyncBuffer));
+        ASSERT_EQ(1, wearleveling_v2_saveAsync(handle, dummy_data, NULL, NULL));
+        ASSERT_EQ(0, wearleveling_v2_read(handle, dummy_data_read));
+        mock_drainAsyncQueue();
+        ASSERT_EQ(1, wearleveling_v2_read(handle, dummy_data_read));
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+    }
+    TEST_F(wearlevelingLibraryTest, history_1)
+    {
+        /* common data */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 5,
+            .readTwoByte = mock_countingReadTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        uint8_t dummy_data [14][5] = { { 0 } };
+        uint8_t dummy_data_read [5] = { 0 };
+        uint8_t exported [10 * 5] = { 0 };
+        uint16_t indexBucket = 0;
+
+        mock_pageErase();
+        wearleveling_state_typeDef wearlevelingState;
+        wearleveling_handle_typeDef handle = wearleveling_v2_construct(&wearlevelingState, &params);
+
+        /* nothing saved, nothing to walk */
+        wearleveling_iter_typeDef iter = wearleveling_v2_iterBegin(handle);
+        ASSERT_EQ(0, wearleveling_v2_iterNext(handle, &iter, &indexBucket, dummy_data_read));
+
+        for(uint16_t i = 0; i < 7; i++)
+        {
+            fillRandomData(dummy_data[i], sizeof(dummy_data[i]) - 1);
+            ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data[i]));
+        }
+
+        /* newest first, down to bucket 0 */
+        handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        iter = wearleveling_v2_iterBegin(handle);
+        for(uint16_t i = 0; i < 7; i++)
+        {
+            ASSERT_EQ(1, wearleveling_v2_iterNext(handle, &iter, &indexBucket, dummy_data_read));
+            ASSERT_EQ(6 - i, indexBucket);
+            ASSERT_EQ(0, memcmp(dummy_data[6 - i], dummy_data_read, sizeof(dummy_data_read)));
+        }
+        ASSERT_EQ(0, wearleveling_v2_iterNext(handle, &iter, &indexBucket, dummy_data_read));
+
+        /* mapped flash is copied without a single read callback */
+        wearleveling_v2_setMappedBase(handle, page);
+        mock_numOfReads = 0;
+        ASSERT_EQ(7, wearleveling_v2_exportHistory(handle, exported, 10));
+        ASSERT_EQ(0U, mock_numOfReads);
+        for(uint16_t i = 0; i < 7; i++)
+        {
+            ASSERT_EQ(0, memcmp(dummy_data[6 - i], &exported[i * 5], sizeof(dummy_data_read)));
+        }
+        ASSERT_EQ(3, wearleveling_v2_exportHistory(handle, exported, 3));
+
+        /* not mapped, one burst for each record and one for its flag */
+        wearleveling_v2_setMappedBase(handle, NULL);
+        wearleveling_v2_setReadBytes(handle, mock_readBytes);
+        mock_numOfReads = 0;
+        mock_numOfBursts = 0;
+        memset(exported, 0, sizeof(exported));
+        ASSERT_EQ(7, wearleveling_v2_exportHistory(handle, exported, 10));
+        ASSERT_EQ(0U, mock_numOfReads);
+        ASSERT_EQ(14U, mock_numOfBursts);
+        for(uint16_t i = 0; i < 7; i++)
+        {
+            ASSERT_EQ(0, memcmp(dummy_data[6 - i], &exported[i * 5], sizeof(dummy_data_read)));
+        }
+        wearleveling_v2_setReadBytes(handle, NULL);
+
+        /* a save ends a walk in progress */
+        iter = wearleveling_v2_iterBegin(handle);
+        ASSERT_EQ(1, wearleveling_v2_iterNext(handle, &iter, &indexBucket, dummy_data_read));
+        ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data[6]));
+        ASSERT_EQ(0, wearleveling_v2_iterNext(handle, &iter, &indexBucket, dummy_data_read));
+
+        /* after the roll over only the records since the erase are left */
+        for(uint16_t i = 7; i < 14; i++)
+        {
+            fillRandomData(dummy_data[i], sizeof(dummy_data[i]) - 1);
+            ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data[i]));
+        }
+        const uint16_t NUM_OF_LEFT = handle->indexBucketRead + 1;
+        ASSERT_LT(NUM_OF_LEFT, 7);
+        ASSERT_EQ(NUM_OF_LEFT, wearleveling_v2_exportHistory(handle, exported, 10));
+        for(uint16_t i = 0; i < NUM_OF_LEFT; i++)
+        {
+            ASSERT_EQ(0, memcmp(dummy_data[13 - i], &exported[i * 5], sizeof(dummy_data_read)));
+        }
+    }
+    TEST_F(wearlevelingLibraryTest, torn_bucket_1)
+    {
+        /* common data, 6 byte buckets after the 2 byte header */
+        wearleveling_params_typeDef params =
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 5,
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_pageErase,
+        };
+
+        uint8_t dummy_data [4][5] = { { 0 } };
+        uint8_t dummy_data_read [5] = { 0 };
+        uint8_t exported [4 * 5] = { 0 };
+
+        mock_pageErase();
+        wearleveling_state_typeDef wearlevelingState;
+        wearleveling_handle_typeDef handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        for(uint16_t i = 0; i < 3; i++)
+        {
+            fillRandomData(dummy_data[i], sizeof(dummy_data[i]) - 1);
+            ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data[i]));
+        }
+
+        /* power went after the first half word of bucket 3, its dirty flag is still empty */
+        mock_writeTwoByte(2 + (3 * 6), 0x1200);
+        handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        ASSERT_EQ(3, handle->indexBucketWrite);
+        ASSERT_EQ(1, handle->isFrontierTorn);
+        ASSERT_EQ(1, wearleveling_v2_read(handle, dummy_data_read));
+        ASSERT_EQ(0, memcmp(dummy_data[2], dummy_data_read, sizeof(dummy_data_read)));
+
+        /* the next save discards it instead of programming over it */
+        fillRandomData(dummy_data[3], sizeof(dummy_data[3]) - 1);
+        ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data[3]));
+        ASSERT_EQ(0x00, page[2 + (3 * 6) + 5]);
+        handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        ASSERT_EQ(5, handle->indexBucketWrite);
+        ASSERT_EQ(0, handle->isFrontierTorn);
+        ASSERT_EQ(1, wearleveling_v2_read(handle, dummy_data_read));
+        ASSERT_EQ(0, memcmp(dummy_data[3], dummy_data_read, sizeof(dummy_data_read)));
+        ASSERT_EQ(4, wearleveling_v2_exportHistory(handle, exported, 4));
+        ASSERT_EQ(0, memcmp(dummy_data[3], &exported[0], sizeof(dummy_data_read)));
+        ASSERT_EQ(0, memcmp(dummy_data[2], &exported[5], sizeof(dummy_data_read)));
+
+        /* the last data byte and the flag share a half word, a torn flag is used but not a record */
+        mock_writeTwoByte(2 + (5 * 6) + 4, 0x77FF);
+        handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        ASSERT_EQ(6, handle->indexBucketWrite);
+        ASSERT_EQ(4, handle->indexBucketRead);
+        ASSERT_EQ(1, wearleveling_v2_read(handle, dummy_data_read));
+        ASSERT_EQ(0, memcmp(dummy_data[3], dummy_data_read, sizeof(dummy_data_read)));
+        ASSERT_EQ(4, wearleveling_v2_exportHistory(handle, exported, 4));
+    }
+    TEST_F(wearlevelingLibraryTest, blob_1)
+    {
+        /* four 256 byte sectors from 4096, 244 bytes of payload each */
+        const wearleveling_blob_params_typeDef params =
+        {
+            .baseAddr = 4096,
+            .sectorSizeInByte = 256,
+            .numOfSectors = 4,
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .sectorErase = mock_regionSectorErase<0, 256>,
+        };
+
+        static uint8_t blob_data [600];
+        static uint8_t blob_read [600];
+        memset(page + 4096, 0xFF, 4 * 256);
+        fillRandomData(blob_data, sizeof(blob_data) - 1);
+
+        wearleveling_blob_state_typeDef blobState;
+        wearleveling_blob_handle_typeDef blob = wearleveling_blob_construct(&blobState, &params);
+        ASSERT_NE(nullptr, blob);
+        ASSERT_EQ(0, wearleveling_blob_readBegin(blob));
+        ASSERT_EQ(4U * 244U, wearleveling_blob_getMaxSize(blob));
+
+        /* odd chunks, three sectors */
+        ASSERT_EQ(1, wearleveling_blob_writeBegin(blob));
+        for(uint16_t i = 0; i < 501; i += 7)
+        {
+            const uint16_t LENGTH = (uint16_t)std::min(7, 501 - i);
+            ASSERT_EQ(1, wearleveling_blob_writeChunk(blob, &blob_data[i], LENGTH));
+        }
+        ASSERT_EQ(1, wearleveling_blob_writeCommit(blob));
+        ASSERT_EQ(244U, wearleveling_blob_getMaxSize(blob));
+
+        blob = wearleveling_blob_construct(&blobState, &params);
+        ASSERT_EQ(501U, wearleveling_blob_getSize(blob));
+        ASSERT_EQ(1, wearleveling_blob_readBegin(blob));
+        uint32_t numOfRead = 0;
+        uint16_t length = 0;
+        while ((length = wearleveling_blob_readChunk(blob, &blob_read[numOfRead], 13)) != 0)
+        {
+            numOfRead += length;
+        }
+        ASSERT_EQ(501U, numOfRead);
+        ASSERT_EQ(0, memcmp(blob_data, blob_read, 501));
+
+        /* the sectors of the committed blob are never written over */
+        ASSERT_EQ(1, wearleveling_blob_writeBegin(blob));
+        ASSERT_EQ(0, wearleveling_blob_writeChunk(blob, blob_data, 245));
+
+        /* power lost before the commit, the previous blob is still there */
+        ASSERT_EQ(1, wearleveling_blob_writeBegin(blob));
+        ASSERT_EQ(1, wearleveling_blob_writeChunk(blob, &blob_data[100], 200));
+        blob = wearleveling_blob_construct(&blobState, &params);
+        ASSERT_EQ(501U, wearleveling_blob_getSize(blob));
+
+        /* committed, it wraps around and the first blob is gone */
+        ASSERT_EQ(1, wearleveling_blob_writeBegin(blob));
+        ASSERT_EQ(1, wearleveling_blob_writeChunk(blob, &blob_data[100], 200));
+        ASSERT_EQ(1, wearleveling_blob_writeCommit(blob));
+        ASSERT_EQ(1, wearleveling_blob_writeBegin(blob));
+        ASSERT_EQ(1, wearleveling_blob_writeChunk(blob, &blob_data[1], 488));
+        ASSERT_EQ(1, wearleveling_blob_writeCommit(blob));
+
+        blob = wearleveling_blob_construct(&blobState, &params);
+        ASSERT_EQ(488U, wearleveling_blob_getSize(blob));
+        ASSERT_EQ(1, wearleveling_blob_readBegin(blob));
+        ASSERT_EQ(488, wearleveling_blob_readChunk(blob, blob_read, sizeof(blob_read)));
+        ASSERT_EQ(0, memcmp(&blob_data[1], blob_read, 488));
+
+        /* an empty blob is a blob too */
+        ASSERT_EQ(1, wearleveling_blob_writeBegin(blob));
+        ASSERT_EQ(1, wearleveling_blob_writeCommit(blob));
+        blob = wearleveling_blob_construct(&blobState, &params);
+        ASSERT_EQ(1, wearleveling_blob_readBegin(blob));
+        ASSERT_EQ(0U, wearleveling_blob_getSize(blob));
+        ASSERT_EQ(0, wearleveling_blob_readChunk(blob, blob_read, sizeof(blob_read)));
+    }
+    TEST_F(wearlevelingLibraryTest, stripe_1)
+    {
+        /* two devices, 128 byte pages at 0 and 1024, 6 byte records */
+        wearleveling_params_typeDef paramsA = 
+        {
+            .pageCapacityInByte = 128,
+            .dataSizeInByte = 2 + 6,
+            .readTwoByte = mock_regionReadTwoByte<0>,
+            .writeTwoByte = mock_regionWriteTwoByte<0>,
+            .pageErase = mock_regionPageErase<0, 128>,
+        };
+        wearleveling_params_typeDef paramsB = 
+        {
+            .pageCapacityInByte = 128,
+            .dataSizeInByte = 2 + 6,
+            .readTwoByte = mock_regionReadTwoByte<1024>,
+            .writeTwoByte = mock_regionWriteTwoByte<1024>,
+            .pageErase = mock_regionPageErase<1024, 128>,
+        };
+
+        uint8_t dummy_data [6] = { 0 };
+        uint8_t dummy_data_previous [6] = { 0 };
+        uint8_t dummy_data_read [6] = { 0 };
+        uint8_t scratch [8] = { 0 };
+        uint8_t asyncBufferA [10] = { 0 };
+        uint8_t asyncBufferB [10] = { 0 };
+        uint8_t isDone [2] = { 0 };
+        wearleveling_stripe_slot_typeDef slots [2];
+
+        mock_pageErase();
+        mock_asyncQueue.clear();
+        mock_asyncRegions.clear();
+        wearleveling_state_typeDef stateA;
+        wearleveling_state_typeDef stateB;
+        wearleveling_handle_typeDef handles [2] =
+        {
+            wearleveling_v2_construct(&stateA, &paramsA),
+            wearleveling_v2_construct(&stateB, &paramsB),
+        };
+        const wearleveling_stripe_params_typeDef stripeParams = { handles, 2, scratch, slots };
+        wearleveling_stripe_state_typeDef stripeState;
+        wearleveling_stripe_handle_typeDef stripe = wearleveling_stripe_construct(&stripeState, &stripeParams);
+        ASSERT_NE(nullptr, stripe);
+        ASSERT_EQ(0, wearleveling_stripe_read(stripe, dummy_data_read));
+        ASSERT_EQ(2U * handles[0]->numOfBuckets, wearleveling_stripe_getEraseWriteCycleMultiplier(stripe));
+
+        /* round robin, every device sees half of the saves and erases */
+        for(uint16_t i = 0; i < 50; i++)
+        {
+            fillRandomData(dummy_data, sizeof(dummy_data) - 1);
+            ASSERT_EQ(1, wearleveling_stripe_save(stripe, dummy_data));
+        }
+        ASSERT_EQ(25U, handles[0]->generation);
+        ASSERT_EQ(25U, handles[1]->generation);
+        ASSERT_EQ(handles[0]->numOfErases, handles[1]->numOfErases);
+
+        handles[0] = wearleveling_v2_construct(&stateA, &paramsA);
+        handles[1] = wearleveling_v2_construct(&stateB, &paramsB);
+        stripe = wearleveling_stripe_construct(&stripeState, &stripeParams);
+        ASSERT_EQ(1, wearleveling_stripe_read(stripe, dummy_data_read));
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+        /* both devices program at the same time, the later one finishes first */
+        ASSERT_EQ(1, wearleveling_v2_setAsyncDriver(handles[0], &mock_asyncDriver, asyncBufferA));
+        ASSERT_EQ(1, wearleveling_v2_setAsyncDriver(handles[1], &mock_asyncDriver, asyncBufferB));
+        mock_asyncRegions[handles[0]] = { 0, 128 };
+        mock_asyncRegions[handles[1]] = { 1024, 128 };
+        auto onDone = [](void * pContext, uint8_t isSuccess) { *(uint8_t *)pContext = isSuccess; };
+        uint32_t numOfOverlaps = 0;
+        uint32_t numOfWaits = 0;
+        for(uint16_t i = 0; i < 30; i++)
+        {
+            fillRandomData(dummy_data_previous, sizeof(dummy_data_previous) - 1);
+            fillRandomData(dummy_data, sizeof(dummy_data) - 1);
+            isDone[0] = 0;
+            isDone[1] = 0;
+            ASSERT_EQ(1, wearleveling_stripe_saveAsync(stripe, dummy_data_previous, onDone, &isDone[0]));
+            if (wearleveling_stripe_saveAsync(stripe, dummy_data, onDone, &isDone[1]) == 0)
+            {
+                /* the erase would take the newest record, wait for the other device */
+                ASSERT_EQ(0, wearleveling_v2_getNumOfFreeBuckets(handles[stripe->indexNext]));
+                mock_drainAsyncQueue();
+                ASSERT_EQ(1, wearleveling_stripe_saveAsync(stripe, dummy_data, onDone, &isDone[1]));
+                numOfWaits++;
+            }
+            else
+            {
+                /* both devices busy */
+                ASSERT_EQ(0, wearleveling_stripe_saveAsync(stripe, dummy_data, onDone, &isDone[1]));
+                numOfOverlaps++;
+            }
+            ASSERT_EQ(1, wearleveling_stripe_isBusy(stripe));
+
+            std::reverse(mock_asyncQueue.begin(), mock_asyncQueue.end());
+            mock_drainAsyncQueue();
+            ASSERT_EQ(1, isDone[0]);
+            ASSERT_EQ(1, isDone[1]);
+            ASSERT_EQ(1, wearleveling_stripe_read(stripe, dummy_data_read));
+            ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+        }
+        ASSERT_GT(numOfOverlaps, numOfWaits);
+        ASSERT_GT(numOfWaits, 0U);
+
+        /* the newest member full and the other one's save failed: nothing in flight, the erase may go ahead */
+        while (wearleveling_v2_getNumOfFreeBuckets(handles[stripe->indexNewest]) != 0)
+        {
+            ASSERT_EQ(1, wearleveling_stripe_save(stripe, dummy_data));
+        }
+        isDone[0] = 1;
+        ASSERT_EQ(1, wearleveling_stripe_saveAsync(stripe, dummy_data_previous, onDone, &isDone[0]));
+        const mock_asyncTransfer_typeDef FAILED_TRANSFER = mock_asyncQueue.front();
+        mock_asyncQueue.pop_front();
+        FAILED_TRANSFER.done(FAILED_TRANSFER.pContext, 0);
+        ASSERT_EQ(0, isDone[0]);
+        ASSERT_EQ(0, wearleveling_stripe_isBusy(stripe));
+        ASSERT_EQ(stripe->indexNewest, stripe->indexNext);
+        fillRandomData(dummy_data, sizeof(dummy_data) - 1);
+        ASSERT_EQ(1, wearleveling_stripe_saveAsync(stripe, dummy_data, onDone, &isDone[1]));
+        mock_drainAsyncQueue();
+        ASSERT_EQ(1, wearleveling_stripe_read(stripe, dummy_data_read));
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+
+        /* lazily constructed members are mounted by the stripe */
+        handles[0] = wearleveling_v2_constructLazy(&stateA, &paramsA, NULL);
+        handles[1] = wearleveling_v2_constructLazy(&stateB, &paramsB, NULL);
+        stripe = wearleveling_stripe_construct(&stripeState, &stripeParams);
+        ASSERT_EQ(1, wearleveling_stripe_read(stripe, dummy_data_read));
+        ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+    }
+    TEST_F(wearlevelingLibraryTest, lifetime_1)
+    {
+        /* store in the first 64 bytes, its erase counter at 1024 */
+        wearleveling_params_typeDef params = 
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 5,
+            .readTwoByte = mock_readTwoByte,
+            .writeTwoByte = mock_writeTwoByte,
+            .pageErase = mock_regionPageErase<0, 64>,
+        };
+
+        wearleveling_params_typeDef counterParams = 
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 0,
+            .readTwoByte = mock_regionReadTwoByte<1024>,
+            .writeTwoByte = mock_regionWriteTwoByte<1024>,
+            .pageErase = mock_regionPageErase<1024, 64>,
+        };
+
+        uint8_t dummy_data [5] = { 0 };
+
+        mock_pageErase();
+        mock_timeInSecond = 1000;
+        wearleveling_state_typeDef wearlevelingState;
+        wearleveling_counter_state_typeDef counterState;
+        wearleveling_lifetime_state_typeDef lifetimeState;
+        wearleveling_handle_typeDef handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        wearleveling_counter_handle_typeDef counter = wearleveling_counter_construct(&counterState, &counterParams);
+
+        wearleveling_lifetime_params_typeDef lifetimeParams = 
+        {
+            .ratedCycles = 100000,
+            .getTimeInSecond = mock_getTimeInSecond,
+            .smoothingShift = 3,
+            .eraseCounter = counter,
+            .initialEraseCount = 0,
+        };
+        wearleveling_lifetime_handle_typeDef lifetime = wearleveling_lifetime_construct(&lifetimeState, handle, &lifetimeParams);
+
+        /* nothing measured yet: unknown life, write amplification from the geometry (64 / (10 * 5)) */
+        ASSERT_EQ(0xFFFFFFFFU, wearleveling_lifetime_getRemainingLifeInSecond(lifetime));
+        ASSERT_EQ(128U, wearleveling_lifetime_getWriteAmplificationInPercent(lifetime));
+
+        /* 10 saves per second, one erase per second */
+        for(uint16_t second = 0; second < 100; second++)
+        {
+            for(uint16_t i = 0; i < 10; i++)
+            {
+                wearleveling_v2_save(handle, dummy_data);
+            }
+            mock_timeInSecond++;
+            ASSERT_EQ(1, wearleveling_lifetime_update(lifetime));
+        }
+
+        /* the format done by the store's construct is counted too */
+        ASSERT_EQ(100U, wearleveling_v2_getNumOfErases(handle));
+        ASSERT_EQ(100U, wearleveling_lifetime_getEraseCount(lifetime));
+        ASSERT_EQ(10000U, wearleveling_lifetime_getSaveRateInMilliPerSecond(lifetime));
+        ASSERT_NEAR(127, wearleveling_lifetime_getWriteAmplificationInPercent(lifetime), 1);
+        ASSERT_NEAR(100000 - 100, wearleveling_lifetime_getRemainingLifeInSecond(lifetime), 1100);
+
+        /* the erase count survives a reset, the rate starts over */
+        handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        counter = wearleveling_counter_construct(&counterState, &counterParams);
+        lifetimeParams.eraseCounter = counter;
+        lifetime = wearleveling_lifetime_construct(&lifetimeState, handle, &lifetimeParams);
+        ASSERT_EQ(100U, wearleveling_lifetime_getEraseCount(lifetime));
+        ASSERT_EQ(0U, wearleveling_lifetime_getSaveRateInMilliPerSecond(lifetime));
+        mock_timeInSecond++;
+        ASSERT_EQ(1, wearleveling_lifetime_update(lifetime));
+        ASSERT_EQ(100U, wearleveling_lifetime_getEraseCount(lifetime));
+
+        /* a ping-pong store: background compaction commits are not saves */
+        wearleveling_sector_params_typeDef sectorParams = 
+        {
+            .spareSectorAddr = 64,
+            .sectorErase = mock_regionSectorErase<2048, 64>,
+        };
+        wearleveling_params_typeDef pingPongParams = 
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 5,
+            .readTwoByte = mock_regionReadTwoByte<2048>,
+            .writeTwoByte = mock_regionWriteTwoByte<2048>,
+            .pageErase = mock_regionPageErase<2048, 64>,
+        };
+        wearleveling_state_typeDef pingPongState;
+        wearleveling_handle_typeDef pingPong = wearleveling_v2_constructPingPong(&pingPongState, &pingPongParams, &sectorParams);
+        lifetimeParams.eraseCounter = NULL;
+        lifetime = wearleveling_lifetime_construct(&lifetimeState, pingPong, &lifetimeParams);
+        for(uint16_t second = 0; second < 20; second++)
+        {
+            for(uint16_t i = 0; i < 10; i++)
+            {
+                ASSERT_EQ(1, wearleveling_v2_save(pingPong, dummy_data));
+                while (wearleveling_v2_compactStep(pingPong, 64) != 0) {}
+            }
+            mock_timeInSecond++;
+            ASSERT_EQ(1, wearleveling_lifetime_update(lifetime));
+        }
+        ASSERT_EQ(10000U, wearleveling_lifetime_getSaveRateInMilliPerSecond(lifetime));
+
+        /* worn out */
+        lifetimeParams.eraseCounter = NULL;
+        lifetimeParams.initialEraseCount = 100000;
+        lifetime = wearleveling_lifetime_construct(&lifetimeState, handle, &lifetimeParams);
+        ASSERT_EQ(0U, wearleveling_lifetime_getRemainingLifeInSecond(lifetime));
+    }
+    TEST_F(wearlevelingLibraryTest, txn_1)
+    {
+        /* calibration at 0, its version at 1024, both single pages; journal as ping-pong at 2048/2112 */
+        wearleveling_params_typeDef params[2] = 
+        {
+            { 64, 5, mock_regionReadTwoByte<0>,    mock_regionWriteTwoByte<0>,    mock_regionPageErase<0, 64> },
+            { 64, 2, mock_regionReadTwoByte<1024>, mock_regionWriteTwoByte<1024>, mock_regionPageErase<1024, 64> },
+        };
+
+        wearleveling_params_typeDef journalParams = 
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 2 + (2 * 2),
+            .readTwoByte = mock_regionReadTwoByte<2048>,
+            .writeTwoByte = mock_regionWriteTwoByte<2048>,
+            .pageErase = mock_regionPageErase<2048, 64>,
+        };
+
+        wearleveling_sector_params_typeDef journalSectorParams = 
+        {
+            .spareSectorAddr = 64,
+            .sectorErase = mock_regionSectorErase<2048, 64>,
+        };
+
+        wearleveling_state_typeDef states[3];
+        wearleveling_handle_typeDef handles[2];
+        uint8_t journalRecord[6];
+        uint8_t scratch[5];
+        uint8_t calibration[5] = { 0 };
+        uint8_t version[2] = { 0 };
+        uint8_t committedCalibration[5] = { 0 };
+        uint8_t committedVersion[2] = { 0 };
+        uint8_t dataRead[5] = { 0 };
+        wearleveling_txn_state_typeDef txnState;
+
+        mock_pageErase();
+        wearleveling_txn_params_typeDef txnParams = 
+        {
+            .journal = NULL,
+            .pHandles = handles,
+            .numOfHandles = 2,
+            .pJournalRecord = journalRecord,
+            .pScratch = scratch,
+        };
+
+        auto mount = [&]()
+        {
+            handles[0] = wearleveling_v2_construct(&states[0], &params[0]);
+            handles[1] = wearleveling_v2_construct(&states[1], &params[1]);
+            txnParams.journal = wearleveling_v2_constructPingPong(&states[2], &journalParams, &journalSectorParams);
+            return wearleveling_txn_construct(&txnState, &txnParams);
+        };
+
+        /* provisioning, outside any transaction */
+        wearleveling_txn_handle_typeDef txn = mount();
+        ASSERT_NE((wearleveling_txn_handle_typeDef)NULL, txn);
+        wearleveling_v2_save(handles[0], committedCalibration);
+        wearleveling_v2_save(handles[1], committedVersion);
+
+        for(uint16_t i = 0; i < 300; i++)
+        {
+            ASSERT_EQ(1, wearleveling_txn_begin(txn));
+            fillRandomData(calibration, sizeof(calibration) - 1);
+            version[0] = (uint8_t)i;
+            version[1] = (uint8_t)(i >> 8);
+            ASSERT_EQ(1, wearleveling_txn_save(txn, handles[0], calibration));
+            ASSERT_EQ(1, wearleveling_txn_save(txn, handles[1], version));
+
+            const uint16_t OUTCOME = rand() % 3;
+            if (OUTCOME == 0)
+            {
+                /* reset before commit */
+                txn = mount();
+                ASSERT_LE(1, wearleveling_txn_getNumOfRolledBack(txn));
+            }
+            else if (OUTCOME == 1)
+            {
+                ASSERT_EQ(1, wearleveling_txn_abort(txn));
+            }
+            else
+            {
+                const uint16_t TRANSACTION_ID = wearleveling_txn_getTransactionId(txn);
+                ASSERT_EQ(1, wearleveling_txn_commit(txn));
+                ASSERT_EQ(TRANSACTION_ID + 1, wearleveling_txn_getTransactionId(txn));
+                memcpy(committedCalibration, calibration, sizeof(calibration));
+                memcpy(committedVersion, version, sizeof(version));
+                if (rand() % 2) txn = mount();
+            }
+
+            wearleveling_v2_read(handles[0], dataRead);
+            ASSERT_EQ(0, memcmp(committedCalibration, dataRead, sizeof(committedCalibration)));
+            wearleveling_v2_read(handles[1], dataRead);
+            ASSERT_EQ(0, memcmp(committedVersion, dataRead, sizeof(committedVersion)));
+        }
+
+        /* only participants, only inside a transaction */
+        ASSERT_EQ(0, wearleveling_txn_save(txn, handles[0], calibration));
+        ASSERT_EQ(1, wearleveling_txn_begin(txn));
+        ASSERT_EQ(0, wearleveling_txn_begin(txn));
+        ASSERT_EQ(0, wearleveling_txn_save(txn, txnParams.journal, calibration));
+        ASSERT_EQ(1, wearleveling_txn_abort(txn));
+    }
+    TEST_F(wearlevelingLibraryTest, txn_2_lazy_and_compaction)
+    {
+        /* a ping-pong participant at 4096/4160, a single page one at 1024, the journal at 2048/2112, all lazy */
+        wearleveling_params_typeDef params[2] = 
+        {
+            { 64, 5, mock_regionReadTwoByte<4096>, mock_regionWriteTwoByte<4096>, mock_regionPageErase<4096, 64> },
+            { 64, 2, mock_regionReadTwoByte<1024>, mock_regionWriteTwoByte<1024>, mock_regionPageErase<1024, 64> },
+        };
+        wearleveling_params_typeDef journalParams = { 64, 2 + (2 * 2), mock_regionReadTwoByte<2048>, mock_regionWriteTwoByte<2048>, mock_regionPageErase<2048, 64> };
+        wearleveling_sector_params_typeDef sectorParams = { 64, mock_regionSectorErase<4096, 64> };
+        wearleveling_sector_params_typeDef journalSectorParams = { 64, mock_regionSectorErase<2048, 64> };
+        const wearleveling_config_typeDef pingPongConfig = { &sectorParams, 0 };
+        const wearleveling_config_typeDef journalConfig = { &journalSectorParams, 0 };
+
+        wearleveling_state_typeDef states[3];
+        wearleveling_handle_typeDef handles[2];
+        uint8_t journalRecord[6];
+        uint8_t scratch[5];
+        uint8_t calibration[5] = { 0 };
+        uint8_t version[2] = { 0 };
+        uint8_t committedCalibration[5] = { 0 };
+        uint8_t committedVersion[2] = { 0 };
+        uint8_t dataRead[5] = { 0 };
+        wearleveling_txn_state_typeDef txnState;
+
+        mock_pageErase();
+        wearleveling_txn_params_typeDef txnParams = 
+        {
+            .journal = NULL,
+            .pHandles = handles,
+            .numOfHandles = 2,
+            .pJournalRecord = journalRecord,
+            .pScratch = scratch,
+        };
+
+        auto mount = [&]()
+        {
+            handles[0] = wearleveling_v2_constructLazy(&states[0], &params[0], &pingPongConfig);
+            handles[1] = wearleveling_v2_constructLazy(&states[1], &params[1], NULL);
+            txnParams.journal = wearleveling_v2_constructLazy(&states[2], &journalParams, &journalConfig);
+            return wearleveling_txn_construct(&txnState, &txnParams);
+        };
+
+        wearleveling_txn_handle_typeDef txn = mount();
+        ASSERT_NE((wearleveling_txn_handle_typeDef)NULL, txn);
+        ASSERT_EQ(1, wearleveling_v2_save(handles[0], committedCalibration));
+        ASSERT_EQ(1, wearleveling_v2_save(handles[1], committedVersion));
+
+        uint16_t numOfSwitches = 0;
+        for(uint16_t i = 0; i < 100; i++)
+        {
+            ASSERT_EQ(1, wearleveling_txn_begin(txn));
+            fillRandomData(calibration, sizeof(calibration) - 1);
+            version[0] = (uint8_t)i;
+            ASSERT_EQ(1, wearleveling_txn_save(txn, handles[0], calibration));
+            ASSERT_EQ(1, wearleveling_txn_save(txn, handles[1], version));
+            ASSERT_EQ(1, wearleveling_txn_commit(txn));
+            memcpy(committedCalibration, calibration, sizeof(calibration));
+            memcpy(committedVersion, version, sizeof(version));
+
+            /* idle time between transactions, the participant switches sectors on its own */
+            const uint16_t SEQUENCE = handles[0]->sequence;
+            while (wearleveling_v2_compactStep(handles[0], 64) != 0) {}
+            if (handles[0]->sequence != SEQUENCE) numOfSwitches++;
+
+            /* staged, then a reset: the lazily mounted participants fall back to the commit */
+            ASSERT_EQ(1, wearleveling_txn_begin(txn));
+            fillRandomData(calibration, sizeof(calibration) - 1);
+            ASSERT_EQ(1, wearleveling_txn_save(txn, handles[0], calibration));
+            ASSERT_EQ(1, wearleveling_txn_save(txn, handles[1], version));
+            txn = mount();
+            ASSERT_NE((wearleveling_txn_handle_typeDef)NULL, txn);
+
+            ASSERT_EQ(1, wearleveling_v2_read(handles[0], dataRead));
+            ASSERT_EQ(0, memcmp(committedCalibration, dataRead, sizeof(committedCalibration)));
+            ASSERT_EQ(1, wearleveling_v2_read(handles[1], dataRead));
+            ASSERT_EQ(0, memcmp(committedVersion, dataRead, sizeof(committedVersion)));
+        }
+        ASSERT_GT(numOfSwitches, 0);
+    }
 }
 
 
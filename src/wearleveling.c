@@ -3,29 +3,91 @@
 #include <stdio.h>
 #include "wearleveling.h"
 
+/* flash access, through the params callbacks or a backend bound at compile time */
+#ifdef WEARLEVELING_BACKEND_HEADER
+#include WEARLEVELING_BACKEND_HEADER
+#define WEARLEVELING_LIB_READ_TWO_BYTE(pParams, addr)          ((void)(pParams), WEARLEVELING_BACKEND_READ_TWO_BYTE(addr))
+#define WEARLEVELING_LIB_WRITE_TWO_BYTE(pParams, addr, data)   ((void)(pParams), WEARLEVELING_BACKEND_WRITE_TWO_BYTE(addr, data))
+#define WEARLEVELING_LIB_PAGE_ERASE(pParams)                   ((void)(pParams), WEARLEVELING_BACKEND_PAGE_ERASE())
+#else
+#define WEARLEVELING_LIB_READ_TWO_BYTE(pParams, addr)          ((pParams)->readTwoByte(addr))
+#define WEARLEVELING_LIB_WRITE_TWO_BYTE(pParams, addr, data)   ((pParams)->writeTwoByte(addr, data))
+#define WEARLEVELING_LIB_PAGE_ERASE(pParams)                   ((pParams)->pageErase())
+#endif
+
 #define WEARLEVELING_LIB_VER_MAJOR      (0U)
 #define WEARLEVELING_LIB_VER_MINOR      (1U)
 #define WEARLEVELING_LIB_VER_PATCH      (1U)
 
-#define WEARLEVELING_LIB_FORMATED_FLAG  ((uint16_t)0x1234)
-#define WEARLEVELING_LIB_DIRTY_FLAG     ((uint8_t)0x55)
-#define WEARLEVELING_LIB_EMPTY_FLAG     ((uint8_t)0xFF)
+#define WEARLEVELING_LIB_HEADER_SIZE            ((uint16_t)sizeof(WEARLEVELING_LIB_FORMATED_FLAG))
+#define WEARLEVELING_LIB_PING_PONG_HEADER_SIZE  ((uint16_t)(sizeof(WEARLEVELING_LIB_FORMATED_FLAG) + sizeof(uint16_t)))
+#define WEARLEVELING_LIB_SEQUENCE_OFFSET        ((uint32_t)sizeof(WEARLEVELING_LIB_FORMATED_FLAG))
+#define WEARLEVELING_LIB_GEOMETRY_SIZE          ((uint16_t)6)
+#define WEARLEVELING_LIB_LAYOUT_VERSION         ((uint8_t)1)
+#define WEARLEVELING_LIB_LAYOUT_HAS_BITMAP      ((uint16_t)0x0100)
+#define WEARLEVELING_LIB_ERASED_TWO_BYTE        ((uint16_t)0xFFFF)
+
+/* step of the asynchronous operation in flight */
+#define WEARLEVELING_LIB_ASYNC_IDLE             ((uint8_t)0)
+#define WEARLEVELING_LIB_ASYNC_ERASING          ((uint8_t)1)
+#define WEARLEVELING_LIB_ASYNC_FORMATTING       ((uint8_t)2)
+#define WEARLEVELING_LIB_ASYNC_PROGRAMMING      ((uint8_t)3)
+#define WEARLEVELING_LIB_ASYNC_MARKING          ((uint8_t)4)
+#define WEARLEVELING_LIB_ASYNC_READING          ((uint8_t)5)
+
+/* lazy mount states, a handle constructed the usual way is mounted on return */
+#define WEARLEVELING_LIB_MOUNT_DONE             ((uint8_t)0)
+#define WEARLEVELING_LIB_MOUNT_HEADER           ((uint8_t)1)
+#define WEARLEVELING_LIB_MOUNT_SCANNING         ((uint8_t)2)
+#define WEARLEVELING_LIB_MOUNT_BITMAP           ((uint8_t)3)
+#define WEARLEVELING_LIB_MOUNT_FORMAT           ((uint8_t)4)
+#define WEARLEVELING_LIB_MOUNT_GEOMETRY         ((uint8_t)5)
+#define WEARLEVELING_LIB_MOUNT_FRONTIER         ((uint8_t)6)
+#define WEARLEVELING_LIB_MOUNT_ALL              ((uint16_t)0xFFFF)
 
 static uint8_t wearleveling_v2_saveDataToAddress(wearleveling_state_typeDef * const pState, const uint32_t addr, uint8_t * const pData);
 static uint16_t wearleveling_v2_calculateBucketSize(wearleveling_params_typeDef * const pParam);
-static uint16_t wearleveling_v2_calculateNumOfBuckets(wearleveling_params_typeDef * const pParam);
-static uint32_t wearleveling_v2_calculateAddressFromBucketIndex(const uint16_t index, const uint16_t bucketSize);
+static uint16_t wearleveling_v2_calculateNumOfBuckets(wearleveling_params_typeDef * const pParam, const uint16_t headerSizeInByte);
+static uint32_t wearleveling_v2_calculateAddressFromBucketIndex(wearleveling_state_typeDef * const pState, const uint16_t index);
 static uint16_t wearleveling_v2_findBucketIndexRead(wearleveling_state_typeDef * const pState);
 static uint16_t wearleveling_v2_findBucketIndexWrite(wearleveling_state_typeDef * const pState);
 static uint16_t wearleveling_v2_getTwoByte(uint16_t index, uint8_t * const pData);
 static uint16_t wearleveling_v2_assembleLastTwoByte(wearleveling_state_typeDef * const pState, uint8_t * const pData);
 static uint8_t wearleveling_v2_getLastbyte(wearleveling_state_typeDef * const pState, uint8_t * const pData);
 static uint8_t wearleveling_v2_isFull(wearleveling_state_typeDef * const pState);
-static uint8_t wearleveling_v2_isFormated(wearleveling_params_typeDef * const pParam);
+static uint8_t wearleveling_v2_isFormated(wearleveling_state_typeDef * const pState);
 static uint8_t wearleveling_v2_isEvenNumber(uint16_t number);
 static void wearleveling_v2_resetIndex(wearleveling_state_typeDef * const pState);
-static void wearleveling_v2_formatPage(wearleveling_params_typeDef * const pParam);
+static void wearleveling_v2_formatPage(wearleveling_state_typeDef * const pState);
 static void wearleveling_v2_updateBuckietIndexReadWrite(wearleveling_state_typeDef * const pState);
+static uint8_t wearleveling_v2_mountPingPong(wearleveling_state_typeDef * const pState);
+static uint8_t wearleveling_v2_formatBlank(wearleveling_state_typeDef * const pState);
+static uint8_t wearleveling_v2_ensureMounted(wearleveling_state_typeDef * const pState);
+static void wearleveling_v2_calculateBitmapGeometry(wearleveling_state_typeDef * const pState);
+static uint16_t wearleveling_v2_findBucketIndexWriteFromBitmap(wearleveling_state_typeDef * const pState);
+static uint8_t wearleveling_v2_readDirtyFlag(wearleveling_state_typeDef * const pState, const uint16_t index);
+static uint8_t wearleveling_v2_isBucketUsed(wearleveling_state_typeDef * const pState, const uint16_t index);
+static uint8_t wearleveling_v2_markBucketUsed(wearleveling_state_typeDef * const pState, const uint32_t sectorAddr, const uint16_t index);
+static uint8_t wearleveling_v2_isBucketRecord(wearleveling_state_typeDef * const pState, const uint16_t index);
+static uint8_t wearleveling_v2_discardBucket(wearleveling_state_typeDef * const pState, const uint32_t sectorAddr, const uint16_t index);
+static uint16_t wearleveling_v2_countTrailingZeros(uint16_t twoByte);
+static void wearleveling_v2_readBucket(wearleveling_state_typeDef * const pState, const uint16_t index, uint8_t * const pData);
+static void wearleveling_v2_updateReadCache(wearleveling_state_typeDef * const pState, const uint8_t * const pData);
+static void wearleveling_v2_onAsyncDone(void * pContext, uint8_t isSuccess);
+static uint8_t wearleveling_v2_submitAsyncStep(wearleveling_state_typeDef * const pState);
+static void wearleveling_v2_finishAsync(wearleveling_state_typeDef * const pState, const uint8_t isSuccess);
+static uint32_t wearleveling_v2_calculateAddressInSector(wearleveling_state_typeDef * const pState, const uint32_t sectorAddr, const uint16_t index);
+static uint8_t wearleveling_v2_saveToSpareSector(wearleveling_state_typeDef * const pState, uint8_t * const pData);
+static uint8_t wearleveling_v2_commitSpareSector(wearleveling_state_typeDef * const pState, const uint16_t numOfUsedBuckets);
+static uint8_t wearleveling_v2_checkSpareErased(wearleveling_state_typeDef * const pState, const uint16_t maxTwoBytes);
+static uint8_t wearleveling_v2_copyToSpareSector(wearleveling_state_typeDef * const pState, const uint16_t maxTwoBytes);
+static wearleveling_handle_typeDef wearleveling_v2_setUp(wearleveling_state_typeDef * const pState, wearleveling_params_typeDef * const pParam, const wearleveling_config_typeDef * const pConfig, const uint8_t hasGeometryHeader);
+static uint16_t wearleveling_v2_getFormatedFlag(wearleveling_state_typeDef * const pState);
+static uint8_t wearleveling_v2_isFormatedFlag(wearleveling_state_typeDef * const pState, const uint16_t flag);
+static uint8_t wearleveling_v2_adoptGeometry(wearleveling_state_typeDef * const pState);
+static uint8_t wearleveling_v2_writeGeometry(wearleveling_state_typeDef * const pState, const uint32_t sectorAddr);
+static uint8_t wearleveling_v2_writeSpareHeader(wearleveling_state_typeDef * const pState);
+static uint8_t wearleveling_v2_migrateGeometry(wearleveling_state_typeDef * const pState, uint8_t * const pScratch);
 
 //
 // V1 interface
@@ -83,29 +145,294 @@ uint32_t wearleveling_v2_getVersionNumber(void)
 
 wearleveling_handle_typeDef 
 wearleveling_v2_construct(wearleveling_state_typeDef * const pState, wearleveling_params_typeDef * const pParam)
+{
+    return wearleveling_v2_constructWithConfig(pState, pParam, NULL);
+}
+
+wearleveling_handle_typeDef
+wearleveling_v2_constructPingPong(wearleveling_state_typeDef * const pState, wearleveling_params_typeDef * const pParam, wearleveling_sector_params_typeDef * const pSectorParam)
+{
+    if (pSectorParam == NULL) return NULL;
+
+    wearleveling_config_typeDef config = { 0 };
+    config.pSectorParam = pSectorParam;
+    return wearleveling_v2_constructWithConfig(pState, pParam, &config);
+}
+
+wearleveling_handle_typeDef
+wearleveling_v2_constructWithConfig(wearleveling_state_typeDef * const pState, wearleveling_params_typeDef * const pParam, const wearleveling_config_typeDef * const pConfig)
+{
+    if (wearleveling_v2_constructLazy(pState, pParam, pConfig) == NULL) return NULL;
+    if (wearleveling_v2_ensureMounted(pState) == 0) return NULL;
+
+    return (wearleveling_handle_typeDef)pState;
+}
+
+wearleveling_handle_typeDef
+wearleveling_v2_constructWithGeometry(wearleveling_state_typeDef * const pState, wearleveling_params_typeDef * const pParam, const wearleveling_config_typeDef * const pConfig, uint8_t * const pScratch)
+{
+    if (pScratch == NULL) return NULL;
+    if (wearleveling_v2_setUp(pState, pParam, pConfig, 1) == NULL) return NULL;
+    if (wearleveling_v2_migrateGeometry(pState, pScratch) == 0) return NULL;
+    if (wearleveling_v2_ensureMounted(pState) == 0) return NULL;
+
+    return (wearleveling_handle_typeDef)pState;
+}
+
+wearleveling_handle_typeDef
+wearleveling_v2_constructLazy(wearleveling_state_typeDef * const pState, wearleveling_params_typeDef * const pParam, const wearleveling_config_typeDef * const pConfig)
+{
+    return wearleveling_v2_setUp(pState, pParam, pConfig, 0);
+}
+
+static wearleveling_handle_typeDef
+wearleveling_v2_setUp(wearleveling_state_typeDef * const pState, wearleveling_params_typeDef * const pParam, const wearleveling_config_typeDef * const pConfig, const uint8_t hasGeometryHeader)
 {
     if ((pState == NULL) || (pParam == NULL)) return NULL;
 
+    const uint8_t IS_PING_PONG = ((pConfig != NULL) && (pConfig->pSectorParam != NULL)) ? 1 : 0;
+    if (IS_PING_PONG && (pConfig->pSectorParam->sectorErase == NULL)) return NULL;
+
     memset((void *)pState, 0, sizeof(wearleveling_state_typeDef));
     pState->params = *pParam;
     //pState->params.pageCapacityInByte = pState->params.pageCapacityInByte % 2 ? pState->params.pageCapacityInByte - 1 : pState->params.pageCapacityInByte;
+    pState->headerSizeInByte = IS_PING_PONG ? WEARLEVELING_LIB_PING_PONG_HEADER_SIZE : WEARLEVELING_LIB_HEADER_SIZE;
+    if (hasGeometryHeader)
+    {
+        pState->headerSizeInByte += WEARLEVELING_LIB_GEOMETRY_SIZE;
+        pState->hasGeometryHeader = 1;
+    }
     pState->bucketSize = wearleveling_v2_calculateBucketSize(pParam);
-    pState->numOfBuckets = wearleveling_v2_calculateNumOfBuckets(pParam);
+    pState->numOfBuckets = wearleveling_v2_calculateNumOfBuckets(pParam, pState->headerSizeInByte);
 
-    if (wearleveling_v2_isFormated(pParam))
+    if ((pConfig != NULL) && pConfig->useAllocationBitmap)
     {
-        pState->indexBucketWrite = wearleveling_v2_findBucketIndexWrite(pState);
-        pState->indexBucketRead = wearleveling_v2_findBucketIndexRead(pState);
+        wearleveling_v2_calculateBitmapGeometry(pState);
     }
-    else
+
+    if (IS_PING_PONG)
     {
-        wearleveling_v2_formatPage(pParam);
-        wearleveling_v2_resetIndex(pState);
+        pState->sectorParams = *pConfig->pSectorParam;
+        pState->isPingPong = 1;
     }
 
+    pState->mountState = WEARLEVELING_LIB_MOUNT_HEADER;
     return (wearleveling_handle_typeDef)pState;
 }
 
+uint8_t wearleveling_v2_mountStep(wearleveling_handle_typeDef handle, const uint16_t maxReads)
+{
+    if (handle == NULL) return 0;
+    if (handle->mountState == WEARLEVELING_LIB_MOUNT_DONE) return 1;
+    if (maxReads == 0) return 0;
+
+    /* a blank page is formated in a step of its own, the only one that erases and the only one without reads */
+    if (handle->mountState == WEARLEVELING_LIB_MOUNT_FORMAT)
+    {
+        if (wearleveling_v2_formatBlank(handle) == 0) return 0;
+        wearleveling_v2_resetIndex(handle);
+        handle->mountState = WEARLEVELING_LIB_MOUNT_DONE;
+        return 1;
+    }
+
+    uint16_t numOfReadsLeft = maxReads;
+
+    if (handle->mountState == WEARLEVELING_LIB_MOUNT_HEADER)
+    {
+        if (handle->isPingPong)
+        {
+            /* formated flag and sequence of both sectors, not split */
+            if (numOfReadsLeft < 4) return 0;
+            numOfReadsLeft -= 4;
+            if (wearleveling_v2_mountPingPong(handle) == 0)
+            {
+                handle->mountState = WEARLEVELING_LIB_MOUNT_FORMAT;
+                return 0;
+            }
+        }
+        else
+        {
+            numOfReadsLeft--;
+            if (wearleveling_v2_isFormated(handle) == 0)
+            {
+                handle->mountState = WEARLEVELING_LIB_MOUNT_FORMAT;
+                return 0;
+            }
+        }
+
+        handle->mountCursor = 0;
+        handle->mountState = handle->isGeometryOnFlash ? WEARLEVELING_LIB_MOUNT_GEOMETRY :
+            handle->bitmapSizeInByte ? WEARLEVELING_LIB_MOUNT_BITMAP : WEARLEVELING_LIB_MOUNT_SCANNING;
+    }
+
+    if (handle->mountState == WEARLEVELING_LIB_MOUNT_GEOMETRY)
+    {
+        /* layout, record size and page size, not split; a page of another geometry is neither used nor formated */
+        if (numOfReadsLeft < 3) return 0;
+        numOfReadsLeft -= 3;
+        if (wearleveling_v2_adoptGeometry(handle) == 0) return 0;
+        handle->mountState = handle->bitmapSizeInByte ? WEARLEVELING_LIB_MOUNT_BITMAP : WEARLEVELING_LIB_MOUNT_SCANNING;
+    }
+
+    if (handle->mountState == WEARLEVELING_LIB_MOUNT_BITMAP)
+    {
+        /* bits are cleared from the lowest one up, one half word of the bitmap per read */
+        const uint32_t BITMAP_ADDR = handle->baseAddr + handle->headerSizeInByte;
+        const uint16_t NUM_OF_TWO_BYTES = handle->bitmapSizeInByte >> 1;
+        uint16_t index = handle->numOfBuckets;
+
+        while (handle->mountCursor < NUM_OF_TWO_BYTES)
+        {
+            if (numOfReadsLeft == 0) return 0;
+            numOfReadsLeft--;
+            const uint16_t TWO_BYTE = WEARLEVELING_LIB_READ_TWO_BYTE(&handle->params, BITMAP_ADDR + ((uint32_t)handle->mountCursor * 2));
+            if (TWO_BYTE != 0)
+            {
+                index = (uint16_t)((handle->mountCursor * 16U) + wearleveling_v2_countTrailingZeros(TWO_BYTE));
+                break;
+            }
+            handle->mountCursor++;
+        }
+
+        /* the bitmap is written after the bucket, the scan below checks the buckets past it */
+        handle->mountCursor = index > handle->numOfBuckets ? handle->numOfBuckets : index;
+        handle->mountState = WEARLEVELING_LIB_MOUNT_SCANNING;
+    }
+
+    if (handle->mountState == WEARLEVELING_LIB_MOUNT_SCANNING)
+    {
+        /* the first bucket still empty is the frontier, the scan picks up where the last slice stopped */
+        while (handle->mountCursor < handle->numOfBuckets)
+        {
+            if (numOfReadsLeft == 0) return 0;
+            numOfReadsLeft--;
+            if (wearleveling_v2_isBucketUsed(handle, handle->mountCursor) == 0) break;
+            handle->mountCursor++;
+        }
+
+        handle->indexBucketWrite = handle->mountCursor;
+        handle->indexBucketRead = wearleveling_v2_findBucketIndexRead(handle);
+        handle->isFrontierTorn = 0;
+        handle->mountCursor = 0;
+        handle->mountState = WEARLEVELING_LIB_MOUNT_FRONTIER;
+    }
+
+    /* an empty flag only says the save did not finish, the data half words of a cut save are not erased any more;
+       an even record has nothing but padding next to the flag */
+    const uint16_t NUM_OF_DATA_TWO_BYTES = wearleveling_v2_isEvenNumber(handle->params.dataSizeInByte) ? (handle->bucketSize >> 1) - 1 : (handle->bucketSize >> 1);
+    const uint16_t NUM_OF_TWO_BYTES = handle->indexBucketWrite < handle->numOfBuckets ? NUM_OF_DATA_TWO_BYTES : 0;
+    const uint32_t FRONTIER_ADDR = wearleveling_v2_calculateAddressFromBucketIndex(handle, handle->indexBucketWrite);
+    while (handle->mountCursor < NUM_OF_TWO_BYTES)
+    {
+        if (numOfReadsLeft == 0) return 0;
+        numOfReadsLeft--;
+        if (WEARLEVELING_LIB_READ_TWO_BYTE(&handle->params, FRONTIER_ADDR + ((uint32_t)handle->mountCursor * 2)) != 0xFFFF)
+        {
+            handle->isFrontierTorn = 1;
+            break;
+        }
+        handle->mountCursor++;
+    }
+    handle->mountCursor = NUM_OF_TWO_BYTES;
+
+    /* the newest bucket used may hold a torn flag or a discarded copy, the record is further down */
+    while ((handle->indexBucketWrite > 0) && (handle->indexBucketRead > 0))
+    {
+        if (numOfReadsLeft == 0) return 0;
+        numOfReadsLeft--;
+        if (wearleveling_v2_isBucketRecord(handle, handle->indexBucketRead)) break;
+        handle->indexBucketRead--;
+    }
+
+    handle->mountState = WEARLEVELING_LIB_MOUNT_DONE;
+    return 1;
+}
+
+uint8_t wearleveling_v2_isMounted(wearleveling_handle_typeDef handle)
+{
+    if (handle == NULL) return 0;
+    return handle->mountState == WEARLEVELING_LIB_MOUNT_DONE ? 1 : 0;
+}
+
+uint8_t wearleveling_v2_mount(wearleveling_handle_typeDef handle)
+{
+    if (handle == NULL) return 0;
+    return wearleveling_v2_ensureMounted(handle);
+}
+
+static uint8_t wearleveling_v2_mountPingPong(wearleveling_state_typeDef * const pState)
+{
+    if (pState == NULL) return 0;
+
+    const uint32_t ADDR_A = 0x00;
+    const uint32_t ADDR_B = pState->sectorParams.spareSectorAddr;
+    const uint16_t FLAG_A = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, ADDR_A);
+    const uint16_t FLAG_B = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, ADDR_B);
+    const uint8_t IS_FORMATED_A = wearleveling_v2_isFormatedFlag(pState, FLAG_A);
+    const uint8_t IS_FORMATED_B = wearleveling_v2_isFormatedFlag(pState, FLAG_B);
+    const uint16_t SEQUENCE_A = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, ADDR_A + WEARLEVELING_LIB_SEQUENCE_OFFSET);
+    const uint16_t SEQUENCE_B = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, ADDR_B + WEARLEVELING_LIB_SEQUENCE_OFFSET);
+
+    if (IS_FORMATED_A && IS_FORMATED_B)
+    {
+        /* power went after a switch was committed but before the old sector was erased */
+        const uint8_t IS_B_NEWER = (int16_t)(SEQUENCE_B - SEQUENCE_A) > 0 ? 1 : 0;
+        pState->baseAddr = IS_B_NEWER ? ADDR_B : ADDR_A;
+        pState->spareAddr = IS_B_NEWER ? ADDR_A : ADDR_B;
+        pState->sequence = IS_B_NEWER ? SEQUENCE_B : SEQUENCE_A;
+        pState->spareState = WEARLEVELING_LIB_SPARE_DIRTY;
+    }
+    else if (IS_FORMATED_A || IS_FORMATED_B)
+    {
+        pState->baseAddr = IS_FORMATED_B ? ADDR_B : ADDR_A;
+        pState->spareAddr = IS_FORMATED_B ? ADDR_A : ADDR_B;
+        pState->sequence = IS_FORMATED_B ? SEQUENCE_B : SEQUENCE_A;
+        pState->spareState = WEARLEVELING_LIB_SPARE_UNKNOWN;
+    }
+    else
+    {
+        /* neither sector formated, left to wearleveling_v2_formatBlank() */
+        return 0;
+    }
+
+    const uint16_t FLAG = pState->baseAddr == ADDR_B ? FLAG_B : FLAG_A;
+    pState->isGeometryOnFlash = ((pState->hasGeometryHeader == 0) && (FLAG == WEARLEVELING_LIB_GEOMETRY_FLAG)) ? 1 : 0;
+    return 1;
+}
+
+static uint8_t wearleveling_v2_formatBlank(wearleveling_state_typeDef * const pState)
+{
+    if (pState == NULL) return 0;
+
+    if (pState->isPingPong == 0)
+    {
+        wearleveling_v2_formatPage(pState);
+        pState->numOfErases++;
+        return 1;
+    }
+
+    const uint32_t ADDR_A = 0x00;
+    if (pState->sectorParams.sectorErase(ADDR_A) == 0) return 0;
+    pState->numOfErases++;
+    if (WEARLEVELING_LIB_WRITE_TWO_BYTE(&pState->params, ADDR_A + WEARLEVELING_LIB_SEQUENCE_OFFSET, 0) == 0) return 0;
+    if (wearleveling_v2_writeGeometry(pState, ADDR_A) == 0) return 0;
+    if (WEARLEVELING_LIB_WRITE_TWO_BYTE(&pState->params, ADDR_A, wearleveling_v2_getFormatedFlag(pState)) == 0) return 0;
+    pState->baseAddr = ADDR_A;
+    pState->spareAddr = pState->sectorParams.spareSectorAddr;
+    pState->sequence = 0;
+    pState->spareState = WEARLEVELING_LIB_SPARE_UNKNOWN;
+
+    return 1;
+}
+
+static uint8_t wearleveling_v2_ensureMounted(wearleveling_state_typeDef * const pState)
+{
+    /* enough reads for the header and every bucket, a blank page takes a second step for its format */
+    if (wearleveling_v2_mountStep(pState, WEARLEVELING_LIB_MOUNT_ALL)) return 1;
+    if ((pState == NULL) || (pState->mountState != WEARLEVELING_LIB_MOUNT_FORMAT)) return 0;
+    return wearleveling_v2_mountStep(pState, WEARLEVELING_LIB_MOUNT_ALL);
+}
+
 static uint8_t wearleveling_v2_saveDataToAddress(wearleveling_state_typeDef * const pState, const uint32_t addr, uint8_t * const pData)
 {
     if (pState == NULL) return 0;
@@ -119,12 +446,12 @@ static uint8_t wearleveling_v2_saveDataToAddress(wearleveling_state_typeDef * co
     {
         offset = i * 2;
         tmpTwoBytes = wearleveling_v2_getTwoByte(i, pData);
-        if (pState->params.writeTwoByte(addr + offset, tmpTwoBytes) == 0) return 0;
+        if (WEARLEVELING_LIB_WRITE_TWO_BYTE(&pState->params, addr + offset, tmpTwoBytes) == 0) return 0;
     }
 
     offset = numOfCopy * 2;
     tmpTwoBytes = wearleveling_v2_assembleLastTwoByte(pState, pData);
-    if (pState->params.writeTwoByte(addr + offset, tmpTwoBytes) == 0) return 0;
+    if (WEARLEVELING_LIB_WRITE_TWO_BYTE(&pState->params, addr + offset, tmpTwoBytes) == 0) return 0;
 
     return 1;
 }
@@ -138,44 +465,336 @@ uint8_t wearleveling_v2_save(wearleveling_handle_typeDef handle, uint8_t * const
 {
     if (handle == NULL) return 0;
     if (pData == NULL) return 0;
+    if (handle->asyncState != WEARLEVELING_LIB_ASYNC_IDLE) return 0;
+    if (wearleveling_v2_ensureMounted(handle) == 0) return 0;
+
+    /* never program over a cut save, the AND of both records would read back as neither */
+    if (handle->isFrontierTorn)
+    {
+        if (wearleveling_v2_discardBucket(handle, handle->baseAddr, handle->indexBucketWrite) == 0) return 0;
+        handle->indexBucketWrite++;
+        handle->isFrontierTorn = 0;
+    }
 
     if (wearleveling_v2_isFull(handle))
     {
-        wearleveling_v2_formatPage(&handle->params);
+        if (handle->isPingPong)
+        {
+            if (wearleveling_v2_saveToSpareSector(handle, pData) == 0) return 0;
+            wearleveling_v2_updateReadCache(handle, pData);
+            handle->numOfSaves++;
+            return 1;
+        }
+
+        wearleveling_v2_formatPage(handle);
         wearleveling_v2_resetIndex(handle);
+        handle->numOfErases++;
     }
 
-    const uint32_t ADDRESS = wearleveling_v2_calculateAddressFromBucketIndex(handle->indexBucketWrite, handle->bucketSize);
+    const uint16_t INDEX = handle->indexBucketWrite;
+    const uint32_t ADDRESS = wearleveling_v2_calculateAddressFromBucketIndex(handle, INDEX);
     wearleveling_v2_updateBuckietIndexReadWrite(handle);
-    return wearleveling_v2_saveDataToAddress(handle, ADDRESS, pData);
+    handle->generation++;
+    if (wearleveling_v2_saveDataToAddress(handle, ADDRESS, pData) == 0) return 0;
+    if (wearleveling_v2_markBucketUsed(handle, handle->baseAddr, INDEX) == 0) return 0;
+
+    /* readers stay on the RAM copy of the previous record until this one is on flash */
+    wearleveling_v2_updateReadCache(handle, pData);
+    handle->numOfSaves++;
+    return 1;
 }
 
 uint8_t wearleveling_v2_read(wearleveling_handle_typeDef handle, uint8_t * const pData)
 {
     if ((pData == NULL) || (handle == NULL)) return 0;
 
-    const uint32_t ADDR_TO_READ = wearleveling_v2_calculateAddressFromBucketIndex(handle->indexBucketRead, handle->bucketSize);
-    const uint16_t NUM_OF_READ = handle->params.dataSizeInByte >> 1;
-    uint16_t tmpTwoByte = 0;
+    /* the RAM copy is served all through an async save, only the flash is off limits while busy */
+    if (handle->isReadCacheValid)
+    {
+        memcpy(pData, handle->pReadCache + ((uint32_t)handle->readCacheSlot * handle->params.dataSizeInByte), handle->params.dataSizeInByte);
+        return 1;
+    }
 
-    for(uint16_t i = 0; i < NUM_OF_READ; i++)
+    if (handle->asyncState != WEARLEVELING_LIB_ASYNC_IDLE) return 0;
+    if (wearleveling_v2_ensureMounted(handle) == 0) return 0;
+    if (handle->indexBucketWrite == 0) return 0;
+
+    /* the mount walks back past buckets that are not records, but not below bucket 0 */
+    if ((handle->indexBucketRead == 0) && (wearleveling_v2_isBucketRecord(handle, 0) == 0)) return 0;
+
+    wearleveling_v2_readBucket(handle, handle->indexBucketRead, pData);
+    return 1;
+}
+
+uint16_t wearleveling_v2_getNumOfFreeBuckets(wearleveling_handle_typeDef handle)
+{
+    if (handle == NULL) return 0;
+    if (wearleveling_v2_ensureMounted(handle) == 0) return 0;
+    return wearleveling_v2_isFull(handle) ? 0 : handle->numOfBuckets - handle->indexBucketWrite;
+}
+
+uint8_t wearleveling_v2_rollOver(wearleveling_handle_typeDef handle, uint8_t * const pScratch)
+{
+    if ((handle == NULL) || (pScratch == NULL)) return 0;
+    if (wearleveling_v2_ensureMounted(handle) == 0) return 0;
+
+    /* nothing saved yet, the page is already as empty as it gets */
+    if (handle->indexBucketWrite == 0) return 1;
+
+    if (wearleveling_v2_read(handle, pScratch) == 0) return 0;
+    if (handle->isPingPong) return wearleveling_v2_saveToSpareSector(handle, pScratch);
+
+    wearleveling_v2_formatPage(handle);
+    wearleveling_v2_resetIndex(handle);
+    handle->numOfErases++;
+    return wearleveling_v2_save(handle, pScratch);
+}
+
+uint8_t wearleveling_v2_compactStep(wearleveling_handle_typeDef handle, const uint16_t maxTwoBytes)
+{
+    if (handle == NULL) return 0;
+    if ((handle->isPingPong == 0) || (maxTwoBytes == 0)) return 0;
+    if (wearleveling_v2_ensureMounted(handle) == 0) return 0;
+
+    /* every call does at most one erase, or reads/programs at most maxTwoBytes half words */
+    switch (handle->spareState)
     {
-        tmpTwoByte = handle->params.readTwoByte(ADDR_TO_READ + (i * 2));
-        uint16_t index = i * 2;
-        pData[index] = (uint8_t)(tmpTwoByte);
-        pData[index + 1] = (uint8_t)(tmpTwoByte >> 8);
+        case WEARLEVELING_LIB_SPARE_UNKNOWN:
+            return wearleveling_v2_checkSpareErased(handle, maxTwoBytes);
+
+        case WEARLEVELING_LIB_SPARE_DIRTY:
+            if (handle->sectorParams.sectorErase(handle->spareAddr) == 0) return 0;
+            handle->numOfErases++;
+            handle->spareState = WEARLEVELING_LIB_SPARE_ERASED;
+            return 1;
+
+        case WEARLEVELING_LIB_SPARE_ERASED:
+            if (wearleveling_v2_isFull(handle) == 0) return 0;
+            if (wearleveling_v2_writeSpareHeader(handle) == 0) return 0;
+            handle->compactionCursor = 0;
+            handle->spareState = WEARLEVELING_LIB_SPARE_COPYING;
+            return 1;
+
+        case WEARLEVELING_LIB_SPARE_COPYING:
+            return wearleveling_v2_copyToSpareSector(handle, maxTwoBytes);
+
+        case WEARLEVELING_LIB_SPARE_COPIED:
+            return wearleveling_v2_commitSpareSector(handle, 1);
+
+        default:
+            return 0;
     }
+}
 
-    tmpTwoByte = handle->params.readTwoByte(ADDR_TO_READ + (NUM_OF_READ * 2));
+uint32_t wearleveling_v2_getNumOfForegroundErases(wearleveling_handle_typeDef handle)
+{
+    return handle == NULL ? 0 : handle->numOfForegroundErases;
+}
+
+uint32_t wearleveling_v2_getNumOfErases(wearleveling_handle_typeDef handle)
+{
+    return handle == NULL ? 0 : handle->numOfErases;
+}
+
+uint32_t wearleveling_v2_getNumOfSaves(wearleveling_handle_typeDef handle)
+{
+    return handle == NULL ? 0 : handle->numOfSaves;
+}
 
-    if (wearleveling_v2_isEvenNumber(internalState.params.dataSizeInByte) == 0)
+uint8_t wearleveling_v2_setAsyncDriver(wearleveling_handle_typeDef handle, const wearleveling_async_driver_typeDef * const pDriver, uint8_t * const pBuffer)
+{
+    if ((handle == NULL) || (pDriver == NULL) || (pBuffer == NULL)) return 0;
+    if ((pDriver->submitProgram == NULL) || (pDriver->submitRead == NULL) || (pDriver->submitErase == NULL)) return 0;
+
+    /* the roll over of a ping-pong store is still synchronous, so is writing a geometry header */
+    if (handle->isPingPong || handle->hasGeometryHeader) return 0;
+
+    handle->pAsyncDriver = pDriver;
+    handle->pAsyncBuffer = pBuffer;
+    handle->asyncState = WEARLEVELING_LIB_ASYNC_IDLE;
+    return 1;
+}
+
+uint8_t wearleveling_v2_saveAsync(wearleveling_handle_typeDef handle, const uint8_t * const pData, wearleveling_done_callback_typeDef done, void * pContext)
+{
+    if ((handle == NULL) || (pData == NULL)) return 0;
+    if (handle->pAsyncDriver == NULL) return 0;
+    if (handle->asyncState != WEARLEVELING_LIB_ASYNC_IDLE) return 0;
+    if (wearleveling_v2_ensureMounted(handle) == 0) return 0;
+
+    /* the mount may have found a geometry page, whose header the async format does not write */
+    if (handle->hasGeometryHeader) return 0;
+
+    /* whole bucket in one contiguous buffer, pData is free again as soon as this returns */
+    memset(handle->pAsyncBuffer, WEARLEVELING_LIB_EMPTY_FLAG, handle->bucketSize);
+    memcpy(handle->pAsyncBuffer, pData, handle->params.dataSizeInByte);
+    handle->pAsyncBuffer[handle->params.dataSizeInByte] = WEARLEVELING_LIB_DIRTY_FLAG;
+
+    handle->asyncDone = done;
+    handle->pAsyncContext = pContext;
+    handle->asyncIndexBucketWrite = handle->indexBucketWrite;
+    handle->asyncState = WEARLEVELING_LIB_ASYNC_PROGRAMMING;
+
+    /* a torn frontier would need a synchronous program to discard it, the roll over erases it instead */
+    if (wearleveling_v2_isFull(handle) || handle->isFrontierTorn)
     {
-        pData[NUM_OF_READ * 2] = (uint8_t)tmpTwoByte;
+        handle->asyncIndexBucketWrite = 0;
+        handle->asyncState = WEARLEVELING_LIB_ASYNC_ERASING;
+
+        /* the page goes away under the newest record: views of it are stale from here on */
+        handle->generation++;
+        wearleveling_v2_resetIndex(handle);
+    }
+
+    if (wearleveling_v2_submitAsyncStep(handle) == 0)
+    {
+        if (handle->asyncState == WEARLEVELING_LIB_ASYNC_ERASING) handle->mountState = WEARLEVELING_LIB_MOUNT_HEADER;
+        handle->asyncState = WEARLEVELING_LIB_ASYNC_IDLE;
+        return 0;
     }
 
     return 1;
 }
 
+uint8_t wearleveling_v2_readAsync(wearleveling_handle_typeDef handle, uint8_t * const pData, wearleveling_done_callback_typeDef done, void * pContext)
+{
+    if ((handle == NULL) || (pData == NULL)) return 0;
+    if (handle->pAsyncDriver == NULL) return 0;
+    if (handle->asyncState != WEARLEVELING_LIB_ASYNC_IDLE) return 0;
+    if (wearleveling_v2_ensureMounted(handle) == 0) return 0;
+
+    handle->asyncDone = done;
+    handle->pAsyncContext = pContext;
+    handle->asyncState = WEARLEVELING_LIB_ASYNC_READING;
+
+    const uint32_t ADDR_TO_READ = wearleveling_v2_calculateAddressFromBucketIndex(handle, handle->indexBucketRead);
+    if (handle->pAsyncDriver->submitRead(ADDR_TO_READ, pData, handle->params.dataSizeInByte, wearleveling_v2_onAsyncDone, handle) == 0)
+    {
+        handle->asyncState = WEARLEVELING_LIB_ASYNC_IDLE;
+        return 0;
+    }
+
+    return 1;
+}
+
+uint8_t wearleveling_v2_isBusy(wearleveling_handle_typeDef handle)
+{
+    if (handle == NULL) return 0;
+    return handle->asyncState != WEARLEVELING_LIB_ASYNC_IDLE ? 1 : 0;
+}
+
+uint8_t wearleveling_v2_getAsyncResult(wearleveling_handle_typeDef handle)
+{
+    return handle == NULL ? 0 : handle->asyncResult;
+}
+
+uint8_t wearleveling_v2_setReadCache(wearleveling_handle_typeDef handle, uint8_t * const pCache)
+{
+    if ((handle == NULL) || (pCache == NULL)) return 0;
+    if (wearleveling_v2_ensureMounted(handle) == 0) return 0;
+
+    handle->isReadCacheValid = 0;
+    handle->readCacheSlot = 0;
+    handle->pReadCache = pCache;
+
+    /* an empty page has no record to keep */
+    if (handle->indexBucketWrite == 0) return 1;
+
+    if (wearleveling_v2_read(handle, pCache) == 0) return 0;
+    handle->isReadCacheValid = 1;
+    return 1;
+}
+
+void wearleveling_v2_setMappedBase(wearleveling_handle_typeDef handle, const uint8_t * const pMappedBase)
+{
+    if (handle == NULL) return;
+    handle->pMappedBase = pMappedBase;
+}
+
+void wearleveling_v2_setReadBytes(wearleveling_handle_typeDef handle, uint8_t (*readBytes) (uint32_t addr, uint8_t * pBuf, uint16_t len))
+{
+    if (handle == NULL) return;
+    handle->readBytes = readBytes;
+}
+
+wearleveling_view_typeDef wearleveling_v2_view(wearleveling_handle_typeDef handle)
+{
+    wearleveling_view_typeDef view = { NULL, 0, 0 };
+
+    if (handle == NULL) return view;
+    if (wearleveling_v2_ensureMounted(handle) == 0) return view;
+
+    view.generation = handle->generation;
+    if ((handle->pMappedBase == NULL) || (handle->indexBucketWrite == 0)) return view;
+
+    const uint32_t ADDR_TO_READ = wearleveling_v2_calculateAddressFromBucketIndex(handle, handle->indexBucketRead);
+    view.pData = handle->pMappedBase + ADDR_TO_READ;
+    view.lengthInByte = handle->params.dataSizeInByte;
+
+    return view;
+}
+
+uint8_t wearleveling_v2_isViewValid(wearleveling_handle_typeDef handle, const wearleveling_view_typeDef * const pView)
+{
+    if ((handle == NULL) || (pView == NULL)) return 0;
+    if (pView->pData == NULL) return 0;
+    return pView->generation == handle->generation ? 1 : 0;
+}
+
+wearleveling_iter_typeDef wearleveling_v2_iterBegin(wearleveling_handle_typeDef handle)
+{
+    wearleveling_iter_typeDef iter = { 0, 0, 0 };
+
+    if (handle == NULL) return iter;
+    if ((wearleveling_v2_ensureMounted(handle) == 0) || (handle->indexBucketWrite == 0)) return iter;
+
+    /* buckets past indexBucketRead are not part of the history, e.g. rolled back by a transaction */
+    iter.indexBucket = handle->indexBucketRead;
+    iter.numOfLeft = handle->indexBucketRead + 1;
+    iter.generation = handle->generation;
+    return iter;
+}
+
+uint8_t wearleveling_v2_iterNext(wearleveling_handle_typeDef handle, wearleveling_iter_typeDef * const pIter, uint16_t * const pIndexBucket, uint8_t * const pData)
+{
+    if ((handle == NULL) || (pIter == NULL) || (pData == NULL)) return 0;
+    if (pIter->numOfLeft == 0) return 0;
+
+    /* a roll over may have moved every bucket */
+    if (pIter->generation != handle->generation) return 0;
+
+    /* a discarded bucket or a torn flag is used, but it is not a record */
+    while (wearleveling_v2_isBucketRecord(handle, pIter->indexBucket) == 0)
+    {
+        pIter->numOfLeft--;
+        if ((pIter->numOfLeft == 0) || (pIter->indexBucket == 0)) return 0;
+        pIter->indexBucket--;
+    }
+
+    wearleveling_v2_readBucket(handle, pIter->indexBucket, pData);
+    if (pIndexBucket != NULL) *pIndexBucket = pIter->indexBucket;
+
+    pIter->numOfLeft--;
+    if (pIter->indexBucket > 0) pIter->indexBucket--;
+    return 1;
+}
+
+uint16_t wearleveling_v2_exportHistory(wearleveling_handle_typeDef handle, uint8_t * const pBuffer, const uint16_t maxNumOfRecords)
+{
+    if ((handle == NULL) || (pBuffer == NULL)) return 0;
+
+    /* records back to back, newest first */
+    wearleveling_iter_typeDef iter = wearleveling_v2_iterBegin(handle);
+    uint16_t numOfRecords = 0;
+    while ((numOfRecords < maxNumOfRecords) &&
+        wearleveling_v2_iterNext(handle, &iter, NULL, pBuffer + ((uint32_t)numOfRecords * handle->params.dataSizeInByte)))
+    {
+        numOfRecords++;
+    }
+
+    return numOfRecords;
+}
+
 static uint16_t wearleveling_v2_calculateBucketSize(wearleveling_params_typeDef * const pParam)
 {
     if (pParam == NULL) return 0;
@@ -183,16 +802,20 @@ static uint16_t wearleveling_v2_calculateBucketSize(wearleveling_params_typeDef
     return size_dataPlusDirtyMark_inBytes % 2 ? size_dataPlusDirtyMark_inBytes + 1 : size_dataPlusDirtyMark_inBytes;
 }
 
-static uint16_t wearleveling_v2_calculateNumOfBuckets(wearleveling_params_typeDef * const pParam)
+static uint16_t wearleveling_v2_calculateNumOfBuckets(wearleveling_params_typeDef * const pParam, const uint16_t headerSizeInByte)
 {
-    uint16_t capacityMinusFormatedString = pParam->pageCapacityInByte - sizeof(WEARLEVELING_LIB_FORMATED_FLAG);
-    return capacityMinusFormatedString / wearleveling_v2_calculateBucketSize(pParam);
+    uint16_t capacityMinusHeader = pParam->pageCapacityInByte - headerSizeInByte;
+    return capacityMinusHeader / wearleveling_v2_calculateBucketSize(pParam);
 }
 
-static uint32_t wearleveling_v2_calculateAddressFromBucketIndex(const uint16_t index, const uint16_t bucketSize)
+static uint32_t wearleveling_v2_calculateAddressFromBucketIndex(wearleveling_state_typeDef * const pState, const uint16_t index)
 {
-    const uint32_t FORMATED_FLAG_OFFSET = sizeof(WEARLEVELING_LIB_FORMATED_FLAG);
-    return (FORMATED_FLAG_OFFSET + (index * bucketSize));
+    return wearleveling_v2_calculateAddressInSector(pState, pState->baseAddr, index);
+}
+
+static uint32_t wearleveling_v2_calculateAddressInSector(wearleveling_state_typeDef * const pState, const uint32_t sectorAddr, const uint16_t index)
+{
+    return (sectorAddr + pState->headerSizeInByte + pState->bitmapSizeInByte + ((uint32_t)index * pState->bucketSize));
 }
 
 static uint16_t wearleveling_v2_findBucketIndexRead(wearleveling_state_typeDef * const pState)
@@ -206,21 +829,18 @@ static uint16_t wearleveling_v2_findBucketIndexRead(wearleveling_state_typeDef *
 static uint16_t wearleveling_v2_findBucketIndexWrite(wearleveling_state_typeDef * const pState)
 {
     if (pState == NULL) return 0;
+    if (pState->bitmapSizeInByte) return wearleveling_v2_findBucketIndexWriteFromBitmap(pState);
 
     for(uint16_t i = 0; i < pState->numOfBuckets; i++)
     {
-        const uint32_t ADDRESS_OF_NEXT_BUCKET = wearleveling_v2_calculateAddressFromBucketIndex(i + 1, pState->bucketSize);
-        const uint16_t LAST_TWO_BYTES = pState->params.readTwoByte(ADDRESS_OF_NEXT_BUCKET - 2);
-
-        const uint8_t dirtyFlag = wearleveling_v2_isEvenNumber(pState->params.dataSizeInByte) ? (uint8_t)(LAST_TWO_BYTES) : (uint8_t)(LAST_TWO_BYTES >> 8);
-
-        if ((dirtyFlag != WEARLEVELING_LIB_DIRTY_FLAG) && (dirtyFlag == WEARLEVELING_LIB_EMPTY_FLAG))
+        if (wearleveling_v2_isBucketUsed(pState, i) == 0)
         {
             return i;
         }
     }
 
-    return 0;
+    /* every bucket is used, the next save rolls over */
+    return pState->numOfBuckets;
 }
 
 static uint16_t wearleveling_v2_getTwoByte(uint16_t index, uint8_t * const pData)
@@ -262,11 +882,12 @@ static uint8_t wearleveling_v2_isFull(wearleveling_state_typeDef * const pState)
     return pState->indexBucketWrite >= pState->numOfBuckets ? 1 : 0;
 }
 
-static uint8_t wearleveling_v2_isFormated(wearleveling_params_typeDef * const pParam)
+static uint8_t wearleveling_v2_isFormated(wearleveling_state_typeDef * const pState)
 {
-    if (pParam == NULL) return 0;
-    uint16_t formatedFlag = pParam->readTwoByte(0x00);
-    return formatedFlag == WEARLEVELING_LIB_FORMATED_FLAG ? 1 : 0;
+    if (pState == NULL) return 0;
+    uint16_t formatedFlag = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, 0x00);
+    pState->isGeometryOnFlash = ((pState->hasGeometryHeader == 0) && (formatedFlag == WEARLEVELING_LIB_GEOMETRY_FLAG)) ? 1 : 0;
+    return wearleveling_v2_isFormatedFlag(pState, formatedFlag);
 }
 
 static uint8_t wearleveling_v2_isEvenNumber(uint16_t number)
@@ -279,13 +900,15 @@ static void wearleveling_v2_resetIndex(wearleveling_state_typeDef * const pState
     if (pState == NULL) return;
     pState->indexBucketRead = 0;
     pState->indexBucketWrite = 0;
+    pState->isFrontierTorn = 0;
 }
 
-static void wearleveling_v2_formatPage(wearleveling_params_typeDef * const pParam)
+static void wearleveling_v2_formatPage(wearleveling_state_typeDef * const pState)
 {
-    if (pParam == NULL) return;
-    pParam->pageErase();
-    pParam->writeTwoByte(0x00, WEARLEVELING_LIB_FORMATED_FLAG);
+    if (pState == NULL) return;
+    WEARLEVELING_LIB_PAGE_ERASE(&pState->params);
+    wearleveling_v2_writeGeometry(pState, 0x00);
+    WEARLEVELING_LIB_WRITE_TWO_BYTE(&pState->params, 0x00, wearleveling_v2_getFormatedFlag(pState));
 }
 
 static void wearleveling_v2_updateBuckietIndexReadWrite(wearleveling_state_typeDef * const pState)
@@ -298,4 +921,528 @@ static void wearleveling_v2_updateBuckietIndexReadWrite(wearleveling_state_typeD
 wearleveling_state_typeDef * debug_wearleveling_getInternalState(void)
 {
     return &internalState;
-}
\ No newline at end of file
+}
+
+static uint8_t wearleveling_v2_saveToSpareSector(wearleveling_state_typeDef * const pState, uint8_t * const pData)
+{
+    if (pState == NULL) return 0;
+    if (pData == NULL) return 0;
+
+    uint16_t indexInSpare = 0;
+
+    if ((pState->spareState == WEARLEVELING_LIB_SPARE_UNKNOWN) || (pState->spareState == WEARLEVELING_LIB_SPARE_DIRTY))
+    {
+        /* background compaction did not get to the spare sector in time, the save pays for the erase */
+        if (pState->sectorParams.sectorErase(pState->spareAddr) == 0) return 0;
+        pState->numOfForegroundErases++;
+        pState->numOfErases++;
+        pState->spareState = WEARLEVELING_LIB_SPARE_ERASED;
+    }
+
+    if (pState->spareState == WEARLEVELING_LIB_SPARE_ERASED)
+    {
+        if (wearleveling_v2_writeSpareHeader(pState) == 0) return 0;
+    }
+    else
+    {
+        /* bucket 0 holds an older copy, a half finished one is sealed as discarded so the history skips it */
+        if (pState->spareState == WEARLEVELING_LIB_SPARE_COPYING)
+        {
+            if (wearleveling_v2_discardBucket(pState, pState->spareAddr, 0) == 0) return 0;
+        }
+        indexInSpare = 1;
+    }
+
+    const uint32_t ADDRESS = wearleveling_v2_calculateAddressInSector(pState, pState->spareAddr, indexInSpare);
+    if (wearleveling_v2_saveDataToAddress(pState, ADDRESS, pData) == 0) return 0;
+    if (wearleveling_v2_markBucketUsed(pState, pState->spareAddr, indexInSpare) == 0) return 0;
+
+    return wearleveling_v2_commitSpareSector(pState, indexInSpare + 1);
+}
+
+static uint8_t wearleveling_v2_commitSpareSector(wearleveling_state_typeDef * const pState, const uint16_t numOfUsedBuckets)
+{
+    if (pState == NULL) return 0;
+
+    /* the formated flag is the single write that makes the spare sector the active one */
+    if (WEARLEVELING_LIB_WRITE_TWO_BYTE(&pState->params, pState->spareAddr, wearleveling_v2_getFormatedFlag(pState)) == 0) return 0;
+
+    const uint32_t OLD_SECTOR_ADDR = pState->baseAddr;
+    pState->baseAddr = pState->spareAddr;
+    pState->spareAddr = OLD_SECTOR_ADDR;
+    pState->sequence++;
+    pState->spareState = WEARLEVELING_LIB_SPARE_DIRTY;
+    pState->compactionCursor = 0;
+    pState->indexBucketWrite = numOfUsedBuckets;
+    pState->indexBucketRead = wearleveling_v2_findBucketIndexRead(pState);
+    pState->generation++;
+
+    return 1;
+}
+
+static uint8_t wearleveling_v2_checkSpareErased(wearleveling_state_typeDef * const pState, const uint16_t maxTwoBytes)
+{
+    if (pState == NULL) return 0;
+
+    const uint16_t NUM_OF_TWO_BYTES = pState->params.pageCapacityInByte >> 1;
+
+    for(uint16_t i = 0; (i < maxTwoBytes) && (pState->compactionCursor < NUM_OF_TWO_BYTES); i++)
+    {
+        const uint32_t ADDRESS = pState->spareAddr + ((uint32_t)pState->compactionCursor * 2);
+        if (WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, ADDRESS) != WEARLEVELING_LIB_ERASED_TWO_BYTE)
+        {
+            pState->spareState = WEARLEVELING_LIB_SPARE_DIRTY;
+            pState->compactionCursor = 0;
+            return 1;
+        }
+        pState->compactionCursor++;
+    }
+
+    if (pState->compactionCursor >= NUM_OF_TWO_BYTES)
+    {
+        pState->spareState = WEARLEVELING_LIB_SPARE_ERASED;
+        pState->compactionCursor = 0;
+    }
+
+    return 1;
+}
+
+static uint8_t wearleveling_v2_copyToSpareSector(wearleveling_state_typeDef * const pState, const uint16_t maxTwoBytes)
+{
+    if (pState == NULL) return 0;
+
+    /* raw copy of the newest bucket, the half word holding the dirty flag is the last one written */
+    const uint16_t NUM_OF_TWO_BYTES = pState->bucketSize >> 1;
+    const uint32_t SOURCE = wearleveling_v2_calculateAddressFromBucketIndex(pState, pState->indexBucketRead);
+    const uint32_t DESTINATION = wearleveling_v2_calculateAddressInSector(pState, pState->spareAddr, 0);
+
+    for(uint16_t i = 0; (i < maxTwoBytes) && (pState->compactionCursor < NUM_OF_TWO_BYTES); i++)
+    {
+        const uint32_t OFFSET = (uint32_t)pState->compactionCursor * 2;
+        if (WEARLEVELING_LIB_WRITE_TWO_BYTE(&pState->params, DESTINATION + OFFSET, WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, SOURCE + OFFSET)) == 0) return 0;
+        pState->compactionCursor++;
+    }
+
+    if (pState->compactionCursor >= NUM_OF_TWO_BYTES)
+    {
+        if (wearleveling_v2_markBucketUsed(pState, pState->spareAddr, 0) == 0) return 0;
+        pState->spareState = WEARLEVELING_LIB_SPARE_COPIED;
+        pState->compactionCursor = 0;
+    }
+
+    return 1;
+}
+
+static void wearleveling_v2_calculateBitmapGeometry(wearleveling_state_typeDef * const pState)
+{
+    if (pState == NULL) return;
+
+    /* the bitmap takes room from the buckets, give up buckets until both fit */
+    uint16_t numOfBuckets = pState->numOfBuckets;
+    while (numOfBuckets > 0)
+    {
+        const uint32_t BITMAP_SIZE = (((uint32_t)numOfBuckets + 15) >> 4) * 2;
+        const uint32_t USED = pState->headerSizeInByte + BITMAP_SIZE + ((uint32_t)numOfBuckets * pState->bucketSize);
+        if (USED <= pState->params.pageCapacityInByte) break;
+        numOfBuckets--;
+    }
+
+    pState->numOfBuckets = numOfBuckets;
+    pState->bitmapSizeInByte = (uint16_t)((((uint32_t)numOfBuckets + 15) >> 4) * 2);
+}
+
+static uint16_t wearleveling_v2_findBucketIndexWriteFromBitmap(wearleveling_state_typeDef * const pState)
+{
+    if (pState == NULL) return 0;
+
+    /* bits are cleared from the lowest one up, count them in one sequential pass */
+    const uint32_t BITMAP_ADDR = pState->baseAddr + pState->headerSizeInByte;
+    const uint16_t NUM_OF_TWO_BYTES = pState->bitmapSizeInByte >> 1;
+    uint16_t index = 0;
+
+    for(uint16_t i = 0; i < NUM_OF_TWO_BYTES; i++)
+    {
+        const uint16_t TWO_BYTE = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, BITMAP_ADDR + ((uint32_t)i * 2));
+        if (TWO_BYTE != 0)
+        {
+            index += wearleveling_v2_countTrailingZeros(TWO_BYTE);
+            break;
+        }
+        index += 16;
+    }
+
+    if (index > pState->numOfBuckets) index = pState->numOfBuckets;
+
+    /* the bitmap is written after the bucket, power may have gone in between */
+    while ((index < pState->numOfBuckets) && wearleveling_v2_isBucketUsed(pState, index)) index++;
+
+    return index;
+}
+
+static uint8_t wearleveling_v2_readDirtyFlag(wearleveling_state_typeDef * const pState, const uint16_t index)
+{
+    const uint32_t ADDRESS_OF_NEXT_BUCKET = wearleveling_v2_calculateAddressFromBucketIndex(pState, index + 1);
+    const uint16_t LAST_TWO_BYTES = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, ADDRESS_OF_NEXT_BUCKET - 2);
+
+    return wearleveling_v2_isEvenNumber(pState->params.dataSizeInByte) ? (uint8_t)(LAST_TWO_BYTES) : (uint8_t)(LAST_TWO_BYTES >> 8);
+}
+
+static uint8_t wearleveling_v2_isBucketUsed(wearleveling_state_typeDef * const pState, const uint16_t index)
+{
+    if (pState == NULL) return 0;
+
+    return wearleveling_v2_readDirtyFlag(pState, index) == WEARLEVELING_LIB_EMPTY_FLAG ? 0 : 1;
+}
+
+static uint8_t wearleveling_v2_isBucketRecord(wearleveling_state_typeDef * const pState, const uint16_t index)
+{
+    if (pState == NULL) return 0;
+
+    /* only a complete dirty flag, not a discarded bucket nor a flag torn with the last data byte */
+    const uint32_t ADDR_OF_FLAG = wearleveling_v2_calculateAddressFromBucketIndex(pState, index) + pState->params.dataSizeInByte;
+    if (pState->pMappedBase != NULL) return pState->pMappedBase[ADDR_OF_FLAG] == WEARLEVELING_LIB_DIRTY_FLAG ? 1 : 0;
+
+    uint8_t flag = WEARLEVELING_LIB_EMPTY_FLAG;
+    if ((pState->readBytes != NULL) && pState->readBytes(ADDR_OF_FLAG, &flag, 1)) return flag == WEARLEVELING_LIB_DIRTY_FLAG ? 1 : 0;
+
+    return wearleveling_v2_readDirtyFlag(pState, index) == WEARLEVELING_LIB_DIRTY_FLAG ? 1 : 0;
+}
+
+static uint8_t wearleveling_v2_discardBucket(wearleveling_state_typeDef * const pState, const uint32_t sectorAddr, const uint16_t index)
+{
+    if (pState == NULL) return 0;
+
+    /* the flag half word is programmed last, so it is still empty in a torn bucket; the data byte next to it is left as it is */
+    const uint32_t LAST_TWO_BYTE_ADDR = wearleveling_v2_calculateAddressInSector(pState, sectorAddr, index + 1) - 2;
+    const uint16_t SEAL = wearleveling_v2_isEvenNumber(pState->params.dataSizeInByte) ?
+        (WEARLEVELING_LIB_EMPTY_FLAG << 8) + WEARLEVELING_LIB_DISCARDED_FLAG :
+        (WEARLEVELING_LIB_DISCARDED_FLAG << 8) + WEARLEVELING_LIB_EMPTY_FLAG;
+    if (WEARLEVELING_LIB_WRITE_TWO_BYTE(&pState->params, LAST_TWO_BYTE_ADDR, SEAL) == 0) return 0;
+    return wearleveling_v2_markBucketUsed(pState, sectorAddr, index);
+}
+
+static uint8_t wearleveling_v2_markBucketUsed(wearleveling_state_typeDef * const pState, const uint32_t sectorAddr, const uint16_t index)
+{
+    if (pState == NULL) return 0;
+    if (pState->bitmapSizeInByte == 0) return 1;
+
+    const uint32_t ADDRESS = sectorAddr + pState->headerSizeInByte + ((uint32_t)(index >> 4) * 2);
+    const uint16_t TWO_BYTE = (uint16_t)((uint32_t)WEARLEVELING_LIB_ERASED_TWO_BYTE << ((index & 0x0F) + 1));
+
+    return WEARLEVELING_LIB_WRITE_TWO_BYTE(&pState->params, ADDRESS, TWO_BYTE);
+}
+
+static uint16_t wearleveling_v2_countTrailingZeros(uint16_t twoByte)
+{
+    if (twoByte == 0) return 16;
+
+    uint16_t count = 0;
+    while ((twoByte & 0x01) == 0)
+    {
+        twoByte >>= 1;
+        count++;
+    }
+
+    return count;
+}
+
+static void wearleveling_v2_readBucket(wearleveling_state_typeDef * const pState, const uint16_t index, uint8_t * const pData)
+{
+    if ((pState == NULL) || (pData == NULL)) return;
+
+    const uint32_t ADDR_TO_READ = wearleveling_v2_calculateAddressFromBucketIndex(pState, index);
+
+    /* memory mapped flash, one copy instead of a callback per half word */
+    if (pState->pMappedBase != NULL)
+    {
+        memcpy(pData, pState->pMappedBase + ADDR_TO_READ, pState->params.dataSizeInByte);
+        return;
+    }
+
+    /* a burst read from the driver, one call per record */
+    if ((pState->readBytes != NULL) && pState->readBytes(ADDR_TO_READ, pData, pState->params.dataSizeInByte)) return;
+
+    const uint16_t NUM_OF_READ = pState->params.dataSizeInByte >> 1;
+    uint16_t tmpTwoByte = 0;
+
+    for(uint16_t i = 0; i < NUM_OF_READ; i++)
+    {
+        tmpTwoByte = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, ADDR_TO_READ + (i * 2));
+        uint16_t offset = i * 2;
+        pData[offset] = (uint8_t)(tmpTwoByte);
+        pData[offset + 1] = (uint8_t)(tmpTwoByte >> 8);
+    }
+
+    if (wearleveling_v2_isEvenNumber(pState->params.dataSizeInByte) == 0)
+    {
+        tmpTwoByte = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, ADDR_TO_READ + (NUM_OF_READ * 2));
+        pData[NUM_OF_READ * 2] = (uint8_t)tmpTwoByte;
+    }
+}
+
+static void wearleveling_v2_updateReadCache(wearleveling_state_typeDef * const pState, const uint8_t * const pData)
+{
+    if ((pState == NULL) || (pState->pReadCache == NULL)) return;
+
+    /* fill the idle slot first, a reader interrupting this still gets a whole record */
+    const uint8_t NEXT_SLOT = pState->readCacheSlot ^ 1;
+    memcpy(pState->pReadCache + ((uint32_t)NEXT_SLOT * pState->params.dataSizeInByte), pData, pState->params.dataSizeInByte);
+    pState->readCacheSlot = NEXT_SLOT;
+    pState->isReadCacheValid = 1;
+}
+
+static void wearleveling_v2_onAsyncDone(void * pContext, uint8_t isSuccess)
+{
+    wearleveling_state_typeDef * const pState = (wearleveling_state_typeDef *)pContext;
+    if (pState == NULL) return;
+
+    if (isSuccess == 0)
+    {
+        /* a roll over stopped half way, the page is mounted again from what is on flash */
+        if ((pState->asyncState == WEARLEVELING_LIB_ASYNC_ERASING) || (pState->asyncState == WEARLEVELING_LIB_ASYNC_FORMATTING))
+        {
+            pState->isReadCacheValid = 0;
+            pState->mountState = WEARLEVELING_LIB_MOUNT_HEADER;
+        }
+        wearleveling_v2_finishAsync(pState, 0);
+        return;
+    }
+
+    switch (pState->asyncState)
+    {
+        case WEARLEVELING_LIB_ASYNC_ERASING:
+            pState->numOfErases++;
+            pState->asyncState = WEARLEVELING_LIB_ASYNC_FORMATTING;
+            break;
+
+        case WEARLEVELING_LIB_ASYNC_FORMATTING:
+            pState->asyncState = WEARLEVELING_LIB_ASYNC_PROGRAMMING;
+            break;
+
+        case WEARLEVELING_LIB_ASYNC_PROGRAMMING:
+            /* the record is on flash, readers may see it from now on */
+            pState->indexBucketWrite = pState->asyncIndexBucketWrite;
+            wearleveling_v2_updateBuckietIndexReadWrite(pState);
+            pState->generation++;
+            pState->numOfSaves++;
+            wearleveling_v2_updateReadCache(pState, pState->pAsyncBuffer);
+            if (pState->bitmapSizeInByte == 0)
+            {
+                wearleveling_v2_finishAsync(pState, 1);
+                return;
+            }
+            pState->asyncState = WEARLEVELING_LIB_ASYNC_MARKING;
+            break;
+
+        case WEARLEVELING_LIB_ASYNC_MARKING:
+        case WEARLEVELING_LIB_ASYNC_READING:
+            wearleveling_v2_finishAsync(pState, 1);
+            return;
+
+        default:
+            return;
+    }
+
+    if (wearleveling_v2_submitAsyncStep(pState) == 0) wearleveling_v2_finishAsync(pState, 0);
+}
+
+static uint8_t wearleveling_v2_submitAsyncStep(wearleveling_state_typeDef * const pState)
+{
+    if (pState == NULL) return 0;
+
+    const wearleveling_async_driver_typeDef * const pDriver = pState->pAsyncDriver;
+    uint16_t twoByte = 0;
+    uint32_t address = 0;
+
+    switch (pState->asyncState)
+    {
+        case WEARLEVELING_LIB_ASYNC_ERASING:
+            return pDriver->submitErase(pState->baseAddr, wearleveling_v2_onAsyncDone, pState);
+
+        case WEARLEVELING_LIB_ASYNC_FORMATTING:
+            twoByte = WEARLEVELING_LIB_FORMATED_FLAG;
+            address = pState->baseAddr;
+            break;
+
+        case WEARLEVELING_LIB_ASYNC_PROGRAMMING:
+            address = wearleveling_v2_calculateAddressFromBucketIndex(pState, pState->asyncIndexBucketWrite);
+            return pDriver->submitProgram(address, pState->pAsyncBuffer, pState->bucketSize, wearleveling_v2_onAsyncDone, pState);
+
+        case WEARLEVELING_LIB_ASYNC_MARKING:
+            twoByte = (uint16_t)((uint32_t)WEARLEVELING_LIB_ERASED_TWO_BYTE << ((pState->indexBucketRead & 0x0F) + 1));
+            address = pState->baseAddr + pState->headerSizeInByte + ((uint32_t)(pState->indexBucketRead >> 4) * 2);
+            break;
+
+        default:
+            return 0;
+    }
+
+    /* flash byte order, same as readTwoByte/writeTwoByte */
+    pState->asyncTwoByte[0] = (uint8_t)twoByte;
+    pState->asyncTwoByte[1] = (uint8_t)(twoByte >> 8);
+    return pDriver->submitProgram(address, pState->asyncTwoByte, sizeof(pState->asyncTwoByte), wearleveling_v2_onAsyncDone, pState);
+}
+
+static void wearleveling_v2_finishAsync(wearleveling_state_typeDef * const pState, const uint8_t isSuccess)
+{
+    if (pState == NULL) return;
+
+    pState->asyncState = WEARLEVELING_LIB_ASYNC_IDLE;
+    pState->asyncResult = isSuccess;
+    if (pState->asyncDone != NULL) pState->asyncDone(pState->pAsyncContext, isSuccess);
+}
+
+static uint16_t wearleveling_v2_getFormatedFlag(wearleveling_state_typeDef * const pState)
+{
+    return pState->hasGeometryHeader ? WEARLEVELING_LIB_GEOMETRY_FLAG : WEARLEVELING_LIB_FORMATED_FLAG;
+}
+
+static uint8_t wearleveling_v2_isFormatedFlag(wearleveling_state_typeDef * const pState, const uint16_t flag)
+{
+    /* a plain handle also takes a geometry page, wearleveling_v2_adoptGeometry() checks it */
+    if (flag == wearleveling_v2_getFormatedFlag(pState)) return 1;
+    return ((pState->hasGeometryHeader == 0) && (flag == WEARLEVELING_LIB_GEOMETRY_FLAG)) ? 1 : 0;
+}
+
+static uint8_t wearleveling_v2_adoptGeometry(wearleveling_state_typeDef * const pState)
+{
+    if (pState == NULL) return 0;
+
+    const uint32_t ADDR = pState->baseAddr + (pState->isPingPong ? WEARLEVELING_LIB_PING_PONG_HEADER_SIZE : WEARLEVELING_LIB_HEADER_SIZE);
+    const uint16_t LAYOUT = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, ADDR);
+    const uint16_t DATA_SIZE = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, ADDR + 2);
+    const uint16_t PAGE_CAPACITY = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, ADDR + 4);
+    const uint8_t HAS_BITMAP = (LAYOUT & WEARLEVELING_LIB_LAYOUT_HAS_BITMAP) ? 1 : 0;
+
+    /* migrating is up to wearleveling_v2_constructWithGeometry(), a plain mount only takes its own geometry */
+    if ((uint8_t)LAYOUT != WEARLEVELING_LIB_LAYOUT_VERSION) return 0;
+    if (DATA_SIZE != pState->params.dataSizeInByte) return 0;
+    if (PAGE_CAPACITY != pState->params.pageCapacityInByte) return 0;
+    if (HAS_BITMAP != (pState->bitmapSizeInByte ? 1 : 0)) return 0;
+
+    /* from now on the handle keeps writing the geometry header */
+    pState->hasGeometryHeader = 1;
+    pState->isGeometryOnFlash = 0;
+    pState->headerSizeInByte += WEARLEVELING_LIB_GEOMETRY_SIZE;
+    pState->numOfBuckets = wearleveling_v2_calculateNumOfBuckets(&pState->params, pState->headerSizeInByte);
+    if (HAS_BITMAP) wearleveling_v2_calculateBitmapGeometry(pState);
+
+    return 1;
+}
+
+static uint8_t wearleveling_v2_writeGeometry(wearleveling_state_typeDef * const pState, const uint32_t sectorAddr)
+{
+    if (pState == NULL) return 0;
+    if (pState->hasGeometryHeader == 0) return 1;
+
+    /* right after the flag and sequence, programmed before the flag so a torn format is not trusted */
+    const uint32_t ADDR = sectorAddr + (pState->isPingPong ? WEARLEVELING_LIB_PING_PONG_HEADER_SIZE : WEARLEVELING_LIB_HEADER_SIZE);
+    const uint16_t LAYOUT = WEARLEVELING_LIB_LAYOUT_VERSION | (pState->bitmapSizeInByte ? WEARLEVELING_LIB_LAYOUT_HAS_BITMAP : 0);
+    if (WEARLEVELING_LIB_WRITE_TWO_BYTE(&pState->params, ADDR, LAYOUT) == 0) return 0;
+    if (WEARLEVELING_LIB_WRITE_TWO_BYTE(&pState->params, ADDR + 2, pState->params.dataSizeInByte) == 0) return 0;
+    return WEARLEVELING_LIB_WRITE_TWO_BYTE(&pState->params, ADDR + 4, pState->params.pageCapacityInByte);
+}
+
+static uint8_t wearleveling_v2_writeSpareHeader(wearleveling_state_typeDef * const pState)
+{
+    if (pState == NULL) return 0;
+    if (WEARLEVELING_LIB_WRITE_TWO_BYTE(&pState->params, pState->spareAddr + WEARLEVELING_LIB_SEQUENCE_OFFSET, (uint16_t)(pState->sequence + 1)) == 0) return 0;
+    return wearleveling_v2_writeGeometry(pState, pState->spareAddr);
+}
+
+static uint8_t wearleveling_v2_migrateGeometry(wearleveling_state_typeDef * const pState, uint8_t * const pScratch)
+{
+    if ((pState == NULL) || (pScratch == NULL)) return 0;
+
+    /* the sector the mount would pick, ping-pong compares the sequences */
+    uint32_t activeAddr = 0x00;
+    uint16_t flag = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, 0x00);
+    uint16_t sequence = 0;
+
+    if (pState->isPingPong)
+    {
+        const uint32_t ADDR_B = pState->sectorParams.spareSectorAddr;
+        const uint16_t FLAG_B = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, ADDR_B);
+        const uint8_t IS_FORMATED_A = (flag == WEARLEVELING_LIB_FORMATED_FLAG) || (flag == WEARLEVELING_LIB_GEOMETRY_FLAG) ? 1 : 0;
+        const uint8_t IS_FORMATED_B = (FLAG_B == WEARLEVELING_LIB_FORMATED_FLAG) || (FLAG_B == WEARLEVELING_LIB_GEOMETRY_FLAG) ? 1 : 0;
+        const uint16_t SEQUENCE_A = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, WEARLEVELING_LIB_SEQUENCE_OFFSET);
+        const uint16_t SEQUENCE_B = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, ADDR_B + WEARLEVELING_LIB_SEQUENCE_OFFSET);
+
+        sequence = SEQUENCE_A;
+        if (IS_FORMATED_B && ((IS_FORMATED_A == 0) || ((int16_t)(SEQUENCE_B - SEQUENCE_A) > 0)))
+        {
+            activeAddr = ADDR_B;
+            flag = FLAG_B;
+            sequence = SEQUENCE_B;
+        }
+    }
+
+    /* blank flash, the mount formats it with the new header */
+    if ((flag != WEARLEVELING_LIB_FORMATED_FLAG) && (flag != WEARLEVELING_LIB_GEOMETRY_FLAG)) return 1;
+
+    /* a page without a geometry header is taken to hold the record size of today */
+    wearleveling_params_typeDef oldParam = pState->params;
+    wearleveling_config_typeDef oldConfig = { 0 };
+    oldConfig.pSectorParam = pState->isPingPong ? &pState->sectorParams : NULL;
+    oldConfig.useAllocationBitmap = pState->bitmapSizeInByte ? 1 : 0;
+
+    if (flag == WEARLEVELING_LIB_GEOMETRY_FLAG)
+    {
+        const uint32_t ADDR = activeAddr + (pState->isPingPong ? WEARLEVELING_LIB_PING_PONG_HEADER_SIZE : WEARLEVELING_LIB_HEADER_SIZE);
+        const uint16_t LAYOUT = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, ADDR);
+        oldParam.dataSizeInByte = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, ADDR + 2);
+        oldParam.pageCapacityInByte = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, ADDR + 4);
+        oldConfig.useAllocationBitmap = (LAYOUT & WEARLEVELING_LIB_LAYOUT_HAS_BITMAP) ? 1 : 0;
+
+        /* a layout from newer firmware, or a header that is not one */
+        if ((uint8_t)LAYOUT != WEARLEVELING_LIB_LAYOUT_VERSION) return 0;
+        if ((oldParam.dataSizeInByte == 0) || (oldParam.dataSizeInByte >= oldParam.pageCapacityInByte)) return 0;
+
+        if ((oldParam.dataSizeInByte == pState->params.dataSizeInByte) &&
+            (oldParam.pageCapacityInByte == pState->params.pageCapacityInByte) &&
+            (oldConfig.useAllocationBitmap == (pState->bitmapSizeInByte ? 1 : 0))) return 1;
+    }
+
+    /* mount the old layout to find its newest record */
+    wearleveling_state_typeDef oldState;
+    if (wearleveling_v2_setUp(&oldState, &oldParam, &oldConfig, flag == WEARLEVELING_LIB_GEOMETRY_FLAG ? 1 : 0) == NULL) return 0;
+    oldState.baseAddr = activeAddr;
+    oldState.indexBucketWrite = wearleveling_v2_findBucketIndexWrite(&oldState);
+    oldState.indexBucketRead = wearleveling_v2_findBucketIndexRead(&oldState);
+
+    /* a longer record is padded with zeros, a shorter one keeps its head */
+    const uint8_t HAS_RECORD = oldState.indexBucketWrite > 0 ? 1 : 0;
+    const uint16_t NUM_OF_BYTES = oldParam.dataSizeInByte < pState->params.dataSizeInByte ? oldParam.dataSizeInByte : pState->params.dataSizeInByte;
+    const uint32_t SOURCE = wearleveling_v2_calculateAddressFromBucketIndex(&oldState, oldState.indexBucketRead);
+    memset(pScratch, 0, pState->params.dataSizeInByte);
+
+    for(uint16_t i = 0; HAS_RECORD && (i < NUM_OF_BYTES); i += 2)
+    {
+        const uint16_t TWO_BYTE = WEARLEVELING_LIB_READ_TWO_BYTE(&pState->params, SOURCE + i);
+        pScratch[i] = (uint8_t)TWO_BYTE;
+        if ((i + 1) < NUM_OF_BYTES) pScratch[i + 1] = (uint8_t)(TWO_BYTE >> 8);
+    }
+
+    pState->mountState = WEARLEVELING_LIB_MOUNT_DONE;
+
+    if (pState->isPingPong == 0)
+    {
+        /* one page, nowhere else to keep the record while it is erased */
+        wearleveling_v2_formatPage(pState);
+        wearleveling_v2_resetIndex(pState);
+        pState->numOfErases++;
+        return HAS_RECORD ? wearleveling_v2_save(pState, pScratch) : 1;
+    }
+
+    /* the old sector stays the active one until the new header is committed on the spare */
+    pState->baseAddr = activeAddr;
+    pState->spareAddr = activeAddr == 0x00 ? pState->sectorParams.spareSectorAddr : 0x00;
+    pState->sequence = sequence;
+    pState->spareState = WEARLEVELING_LIB_SPARE_UNKNOWN;
+    if (HAS_RECORD) return wearleveling_v2_saveToSpareSector(pState, pScratch);
+
+    if (pState->sectorParams.sectorErase(pState->spareAddr) == 0) return 0;
+    pState->numOfErases++;
+    if (wearleveling_v2_writeSpareHeader(pState) == 0) return 0;
+    return wearleveling_v2_commitSpareSector(pState, 0);
+}
@@ -6,6 +6,36 @@ extern "C" {
 
 #include <stdint.h>
 
+/* on-flash layout markers, shared with the C++ wrapper */
+#define WEARLEVELING_LIB_FORMATED_FLAG  ((uint16_t)0x1234)
+#define WEARLEVELING_LIB_GEOMETRY_FLAG  ((uint16_t)0x1235)
+#define WEARLEVELING_LIB_DIRTY_FLAG     ((uint8_t)0x55)
+#define WEARLEVELING_LIB_EMPTY_FLAG     ((uint8_t)0xFF)
+#define WEARLEVELING_LIB_DISCARDED_FLAG ((uint8_t)0x00)
+
+/* state of the spare sector, ping-pong mode only */
+#define WEARLEVELING_LIB_SPARE_UNKNOWN  ((uint8_t)0)
+#define WEARLEVELING_LIB_SPARE_DIRTY    ((uint8_t)1)
+#define WEARLEVELING_LIB_SPARE_ERASED   ((uint8_t)2)
+#define WEARLEVELING_LIB_SPARE_COPYING  ((uint8_t)3)
+#define WEARLEVELING_LIB_SPARE_COPIED   ((uint8_t)4)
+
+//
+// The flash callbacks are called through pointers by default. Building
+// wearleveling.c with -DWEARLEVELING_BACKEND_HEADER=\"my_flash.h\" binds
+// them at compile time instead: that header defines
+// WEARLEVELING_BACKEND_READ_TWO_BYTE(addr), WEARLEVELING_BACKEND_WRITE_TWO_BYTE(addr, data)
+// and WEARLEVELING_BACKEND_PAGE_ERASE(), usually as static inline functions,
+// and the three pointers below are then ignored. Every store in that build
+// shares the one backend; sectorErase of ping-pong mode stays a pointer.
+// Modules built on several stores can not tell them apart any more, so
+// set the define for the whole library: the stripe and txn modules then
+// refuse to compile, and a scheduler must serve that one store only.
+// Only wearleveling.c reads the define. The counter, blob, eeprom, file
+// and compact modules take their own params and call through those
+// pointers in any build, so each of them still needs real callbacks for
+// its own flash region (a lifetime erase counter, for one, is a counter).
+//
 typedef struct
 {
     uint16_t pageCapacityInByte;
@@ -15,6 +45,28 @@ typedef struct
     uint8_t (*pageErase) (void);
 }wearleveling_params_typeDef;
 
+typedef struct
+{
+    uint32_t spareSectorAddr;
+    uint8_t (*sectorErase) (uint32_t addr);
+}wearleveling_sector_params_typeDef;
+
+typedef struct
+{
+    wearleveling_sector_params_typeDef * pSectorParam;  /* NULL for a single page */
+    uint8_t useAllocationBitmap;                        /* one bit per bucket after the header, for a short mount */
+}wearleveling_config_typeDef;
+
+typedef void (*wearleveling_done_callback_typeDef) (void * pContext, uint8_t isSuccess);
+
+/* DMA/QSPI style driver, each call starts a transfer and reports completion through done */
+typedef struct
+{
+    uint8_t (*submitProgram) (uint32_t addr, const uint8_t * pBuf, uint16_t len, wearleveling_done_callback_typeDef done, void * pContext);
+    uint8_t (*submitRead) (uint32_t addr, uint8_t * pBuf, uint16_t len, wearleveling_done_callback_typeDef done, void * pContext);
+    uint8_t (*submitErase) (uint32_t addr, wearleveling_done_callback_typeDef done, void * pContext);
+}wearleveling_async_driver_typeDef;
+
 typedef struct
 {
     wearleveling_params_typeDef params;
@@ -22,6 +74,44 @@ typedef struct
     uint16_t indexBucketWrite;
     uint16_t bucketSize;
     uint16_t numOfBuckets;
+    uint32_t generation;
+    uint32_t numOfErases;               /* since construct, all sectors */
+    uint32_t numOfSaves;                /* since construct, records the caller saved */
+    const uint8_t * pMappedBase;
+    uint8_t (*readBytes) (uint32_t addr, uint8_t * pBuf, uint16_t len);
+    uint32_t baseAddr;
+    uint16_t headerSizeInByte;
+    uint16_t bitmapSizeInByte;
+    /* ping-pong mode only */
+    wearleveling_sector_params_typeDef sectorParams;
+    uint32_t spareAddr;
+    uint32_t numOfForegroundErases;
+    uint16_t sequence;
+    uint16_t compactionCursor;
+    uint8_t spareState;
+    uint8_t isPingPong;
+    /* asynchronous I/O only */
+    const wearleveling_async_driver_typeDef * pAsyncDriver;
+    uint8_t * pAsyncBuffer;
+    wearleveling_done_callback_typeDef asyncDone;
+    void * pAsyncContext;
+    uint16_t asyncIndexBucketWrite;
+    uint8_t asyncTwoByte[2];
+    uint8_t asyncState;
+    uint8_t asyncResult;
+    /* RAM copy of the newest record, two slots of dataSizeInByte */
+    uint8_t * pReadCache;
+    volatile uint8_t readCacheSlot;
+    uint8_t isReadCacheValid;
+    /* lazy mount only, how far the frontier search got */
+    uint16_t mountCursor;
+    uint8_t mountState;
+    /* the first empty bucket was partly programmed by a cut save, the next save discards it */
+    uint8_t isFrontierTorn;
+    /* layout version, record size and page size follow the flag (and sequence) */
+    uint8_t hasGeometryHeader;
+    /* a plain handle found a geometry page, checked against the params before it is used */
+    uint8_t isGeometryOnFlash;
 }wearleveling_state_typeDef;
 
 typedef struct 
@@ -31,14 +121,97 @@ typedef struct
     uint8_t (*read) (uint8_t * const pData);
 }wearleveling_typeDef;
 
+typedef struct
+{
+    const uint8_t * pData;
+    uint16_t lengthInByte;
+    uint32_t generation;
+}wearleveling_view_typeDef;
+
+/* walks the records still on flash, newest first; a save in between ends the walk */
+typedef struct
+{
+    uint16_t indexBucket;
+    uint16_t numOfLeft;
+    uint32_t generation;
+}wearleveling_iter_typeDef;
+
 typedef wearleveling_state_typeDef* wearleveling_handle_typeDef;
 
 /* new interface, starting from v0.1.x */
 wearleveling_handle_typeDef wearleveling_v2_construct(wearleveling_state_typeDef * const pState, wearleveling_params_typeDef * const pParam);
+wearleveling_handle_typeDef wearleveling_v2_constructWithConfig(wearleveling_state_typeDef * const pState, wearleveling_params_typeDef * const pParam, const wearleveling_config_typeDef * const pConfig);
+//
+// constructLazy touches no flash and returns at once; the frontier is
+// searched on the first call that needs it, or ahead of that in slices of
+// at most maxReads flash reads from wearleveling_v2_mountStep(), which
+// returns 1 once the handle is mounted. The bitmap is read one half word
+// per read, the two ping-pong headers take a step of 4 reads (less than
+// that does nothing). A page written by constructWithGeometry takes 3 more
+// reads in a step of their own. The data half words of the first empty
+// bucket and the dirty flag of the newest used one are read last, so a
+// save cut by a power loss is neither returned nor programmed over; the
+// next save marks such a bucket discarded (an async save rolls over
+// instead). A blank page is formated by a step of its own, with
+// no reads and one erase. wearleveling_v2_mount() does all the steps left
+// at once. Modules that look at the indexes directly (txn, stripe,
+// scheduler) want a mounted handle; txn and stripe mount theirs.
+//
+wearleveling_handle_typeDef wearleveling_v2_constructLazy(wearleveling_state_typeDef * const pState, wearleveling_params_typeDef * const pParam, const wearleveling_config_typeDef * const pConfig);
+uint8_t wearleveling_v2_mountStep(wearleveling_handle_typeDef handle, const uint16_t maxReads);
+uint8_t wearleveling_v2_isMounted(wearleveling_handle_typeDef handle);
+uint8_t wearleveling_v2_mount(wearleveling_handle_typeDef handle);
+//
+// constructWithGeometry records the layout version, dataSizeInByte and
+// pageCapacityInByte in the page header, flagged 0x1235 instead of 0x1234.
+// A plain page is taken to hold records of today's size. When the header
+// on flash does not match the params (or a plain page is found) the
+// newest record is copied once into the new layout, padded
+// with zeros or cut to the new size through pScratch (dataSizeInByte
+// bytes). Ping-pong writes it to the spare sector, so the old sector is
+// kept until the copy is committed; a single page is erased first.
+// Such handles take no async driver. A plain construct mounts such a page
+// when the recorded geometry matches its params and keeps the header; on
+// any other geometry it fails without erasing or writing the page.
+//
+wearleveling_handle_typeDef wearleveling_v2_constructWithGeometry(wearleveling_state_typeDef * const pState, wearleveling_params_typeDef * const pParam, const wearleveling_config_typeDef * const pConfig, uint8_t * const pScratch);
+wearleveling_handle_typeDef wearleveling_v2_constructPingPong(wearleveling_state_typeDef * const pState, wearleveling_params_typeDef * const pParam, wearleveling_sector_params_typeDef * const pSectorParam);
 uint8_t wearleveling_v2_save(wearleveling_handle_typeDef handle, uint8_t * const pData);
 uint8_t wearleveling_v2_read(wearleveling_handle_typeDef handle, uint8_t * const pData);
 uint16_t wearleveling_v2_getEraseWriteCycleMultiplier(wearleveling_handle_typeDef handle);
 uint32_t wearleveling_v2_getVersionNumber(void);
+uint16_t wearleveling_v2_getNumOfFreeBuckets(wearleveling_handle_typeDef handle);
+uint8_t wearleveling_v2_rollOver(wearleveling_handle_typeDef handle, uint8_t * const pScratch);
+uint8_t wearleveling_v2_compactStep(wearleveling_handle_typeDef handle, const uint16_t maxTwoBytes);
+uint32_t wearleveling_v2_getNumOfForegroundErases(wearleveling_handle_typeDef handle);
+uint32_t wearleveling_v2_getNumOfErases(wearleveling_handle_typeDef handle);
+uint32_t wearleveling_v2_getNumOfSaves(wearleveling_handle_typeDef handle);
+//
+// pBuffer holds a whole bucket, dataSizeInByte + 1 rounded up to even
+// bytes. While an async transfer is in flight (isBusy) the synchronous
+// save and roll over return 0 instead of racing it; read answers from the
+// read cache when one is set, and returns 0 otherwise.
+//
+uint8_t wearleveling_v2_setAsyncDriver(wearleveling_handle_typeDef handle, const wearleveling_async_driver_typeDef * const pDriver, uint8_t * const pBuffer);
+uint8_t wearleveling_v2_saveAsync(wearleveling_handle_typeDef handle, const uint8_t * const pData, wearleveling_done_callback_typeDef done, void * pContext);
+uint8_t wearleveling_v2_readAsync(wearleveling_handle_typeDef handle, uint8_t * const pData, wearleveling_done_callback_typeDef done, void * pContext);
+uint8_t wearleveling_v2_isBusy(wearleveling_handle_typeDef handle);
+uint8_t wearleveling_v2_getAsyncResult(wearleveling_handle_typeDef handle);
+uint8_t wearleveling_v2_setReadCache(wearleveling_handle_typeDef handle, uint8_t * const pCache);
+void wearleveling_v2_setMappedBase(wearleveling_handle_typeDef handle, const uint8_t * const pMappedBase);
+//
+// Flash that is not memory mapped can still be read in bursts: with
+// readBytes set, read, iterNext and exportHistory fetch a record with one
+// call instead of one readTwoByte per half word; the history checks the
+// dirty flag of each record with one more. A mapped base wins over it, a
+// readBytes that returns 0 falls back to readTwoByte.
+//
+void wearleveling_v2_setReadBytes(wearleveling_handle_typeDef handle, uint8_t (*readBytes) (uint32_t addr, uint8_t * pBuf, uint16_t len));
+wearleveling_view_typeDef wearleveling_v2_view(wearleveling_handle_typeDef handle);
+uint8_t wearleveling_v2_isViewValid(wearleveling_handle_typeDef handle, const wearleveling_view_typeDef * const pView);
+wearleveling_iter_typeDef wearleveling_v2_iterBegin(wearleveling_handle_typeDef handle);
+uint8_t wearleveling_v2_iterNext(wearleveling_handle_typeDef handle, wearleveling_iter_typeDef * const pIter, uint16_t * const pIndexBucket, uint8_t * const pData);
+uint16_t wearleveling_v2_exportHistory(wearleveling_handle_typeDef handle, uint8_t * const pBuffer, const uint16_t maxNumOfRecords);
 
 //
 // New interface should be use, this is for backward 
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <array>
+#include <bit>
+#include <type_traits>
+#include "wearleveling.h"
+
+namespace wearlevelingLibrary
+{
+    //
+    // Default backend, the three flash callbacks of the C interface. Any
+    // type with readTwoByte(addr), writeTwoByte(addr, data) and pageErase()
+    // can take its place; with static inline members the flash access is
+    // inlined into the loops below. A backend that also has
+    // writeUnit(addr, pUnit) programs ProgramUnit bytes per call; it is
+    // required for a ProgramUnit larger than two bytes.
+    //
+    struct CallbackBackend
+    {
+        uint16_t (*readTwoByte) (uint32_t addr);
+        uint8_t (*writeTwoByte) (uint32_t addr, uint16_t data);
+        uint8_t (*pageErase) (void);
+    };
+
+    //
+    // Typed front-end with the page geometry fixed at compile time. For
+    // ProgramUnit == 2 the on-flash layout is identical to the C v2 code,
+    // so a page written by one can be read by the other.
+    //
+    template <typename T, uint32_t PageBytes, uint32_t ProgramUnit = 2, typename Backend = CallbackBackend>
+    class WearLeveled
+    {
+        public:
+            static constexpr uint32_t HeaderSize = ProgramUnit;
+            static constexpr uint32_t DirtyFlagOffset = sizeof(T);
+            static constexpr uint32_t BucketSize = ((sizeof(T) + sizeof(WEARLEVELING_LIB_DIRTY_FLAG) + ProgramUnit - 1) / ProgramUnit) * ProgramUnit;
+            static constexpr uint32_t NumOfBuckets = (PageBytes - HeaderSize) / BucketSize;
+
+            static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+            static_assert((ProgramUnit >= 2) && ((ProgramUnit % 2) == 0), "ProgramUnit must be a multiple of two bytes");
+            static_assert(PageBytes >= (HeaderSize + BucketSize), "T does not fit into one page");
+            static_assert(NumOfBuckets <= UINT16_MAX, "too many buckets for a 16-bit index");
+
+            static constexpr bool HasWriteUnit = requires (Backend &b, uint32_t addr, const uint8_t *pUnit) { b.writeUnit(addr, pUnit); };
+
+            WearLeveled(uint16_t (*readTwoByte) (uint32_t addr), uint8_t (*writeTwoByte) (uint32_t addr, uint16_t data), uint8_t (*pageErase) (void))
+                : backend{ readTwoByte, writeTwoByte, pageErase }, indexBucketWrite(0)
+            {
+                mount();
+            }
+
+            explicit WearLeveled(const Backend &backend) : backend(backend), indexBucketWrite(0)
+            {
+                mount();
+            }
+
+            WearLeveled(void) requires (!std::is_same_v<Backend, CallbackBackend>) : backend(), indexBucketWrite(0)
+            {
+                mount();
+            }
+
+            bool save(const T &data)
+            {
+                if (indexBucketWrite >= NumOfBuckets)
+                {
+                    formatPage();
+                }
+
+                uint8_t image[BucketSize];
+                memset(image, WEARLEVELING_LIB_EMPTY_FLAG, BucketSize);
+                memcpy(image, &data, sizeof(T));
+                image[DirtyFlagOffset] = WEARLEVELING_LIB_DIRTY_FLAG;
+
+                const uint32_t ADDRESS = addressOfBucket(indexBucketWrite);
+                indexBucketWrite++;
+
+                /* the dirty flag is in the last unit, programmed after the data */
+                return program(ADDRESS, image, BucketSize);
+            }
+
+            T load(void) const
+            {
+                uint8_t image[BucketSize];
+                const uint32_t ADDRESS = addressOfBucket(indexBucketRead());
+
+                for(uint32_t i = 0; i < BucketSize; i += 2)
+                {
+                    const uint16_t TWO_BYTE = backend.readTwoByte(ADDRESS + i);
+                    image[i] = (uint8_t)TWO_BYTE;
+                    image[i + 1] = (uint8_t)(TWO_BYTE >> 8);
+                }
+
+                /* T only has to be trivially copyable, not default constructible */
+                std::array<uint8_t, sizeof(T)> bytes;
+                memcpy(bytes.data(), image, sizeof(T));
+                return std::bit_cast<T>(bytes);
+            }
+
+            uint16_t indexBucketRead(void) const
+            {
+                return indexBucketWrite == 0 ? 0 : (uint16_t)(indexBucketWrite - 1);
+            }
+
+            uint16_t getIndexBucketWrite(void) const
+            {
+                return indexBucketWrite;
+            }
+
+            static constexpr uint16_t getEraseWriteCycleMultiplier(void)
+            {
+                return (uint16_t)NumOfBuckets;
+            }
+
+        private:
+            [[no_unique_address]] Backend backend;
+            uint16_t indexBucketWrite;
+
+            static constexpr uint32_t addressOfBucket(const uint32_t index)
+            {
+                return HeaderSize + (index * BucketSize);
+            }
+
+            void mount(void)
+            {
+                if (backend.readTwoByte(0x00) == WEARLEVELING_LIB_FORMATED_FLAG)
+                {
+                    indexBucketWrite = findBucketIndexWrite();
+                }
+                else
+                {
+                    formatPage();
+                }
+            }
+
+            void formatPage(void)
+            {
+                uint8_t header[HeaderSize];
+                memset(header, WEARLEVELING_LIB_EMPTY_FLAG, HeaderSize);
+                header[0] = (uint8_t)WEARLEVELING_LIB_FORMATED_FLAG;
+                header[1] = (uint8_t)(WEARLEVELING_LIB_FORMATED_FLAG >> 8);
+
+                backend.pageErase();
+                program(0x00, header, HeaderSize);
+                indexBucketWrite = 0;
+            }
+
+            bool program(const uint32_t address, const uint8_t * const pImage, const uint32_t size)
+            {
+                if constexpr (HasWriteUnit)
+                {
+                    for(uint32_t i = 0; i < size; i += ProgramUnit)
+                    {
+                        if (backend.writeUnit(address + i, &pImage[i]) == 0) return false;
+                    }
+                }
+                else
+                {
+                    static_assert(ProgramUnit == 2, "a ProgramUnit larger than two bytes needs a backend with writeUnit(addr, pUnit)");
+                    for(uint32_t i = 0; i < size; i += 2)
+                    {
+                        const uint16_t TWO_BYTE = (uint16_t)(pImage[i] | (pImage[i + 1] << 8));
+                        if (backend.writeTwoByte(address + i, TWO_BYTE) == 0) return false;
+                    }
+                }
+
+                return true;
+            }
+
+            uint16_t findBucketIndexWrite(void) const
+            {
+                constexpr uint32_t FLAG_HALF_WORD_OFFSET = DirtyFlagOffset & ~(uint32_t)1;
+                constexpr uint32_t FLAG_SHIFT = (DirtyFlagOffset % 2) ? 8 : 0;
+
+                for(uint32_t i = 0; i < NumOfBuckets; i++)
+                {
+                    const uint16_t TWO_BYTE = backend.readTwoByte(addressOfBucket(i) + FLAG_HALF_WORD_OFFSET);
+                    if ((uint8_t)(TWO_BYTE >> FLAG_SHIFT) == WEARLEVELING_LIB_EMPTY_FLAG) return (uint16_t)i;
+                }
+
+                return (uint16_t)NumOfBuckets;
+            }
+    };
+}
@@ -0,0 +1,246 @@
+#include <string.h>
+#include "wearleveling_blob.h"
+
+#define WEARLEVELING_BLOB_FORMATED_FLAG         ((uint16_t)0x2468)
+#define WEARLEVELING_BLOB_COMMIT_FLAG           ((uint16_t)0xA55A)
+#define WEARLEVELING_BLOB_ADDR_FORMATED_FLAG    ((uint32_t)0x00)
+#define WEARLEVELING_BLOB_ADDR_BLOB_ID          ((uint32_t)0x02)
+#define WEARLEVELING_BLOB_ADDR_INDEX            ((uint32_t)0x04)
+#define WEARLEVELING_BLOB_ADDR_SIZE_LOW         ((uint32_t)0x06)
+#define WEARLEVELING_BLOB_ADDR_SIZE_HIGH        ((uint32_t)0x08)
+#define WEARLEVELING_BLOB_ADDR_COMMIT_FLAG      ((uint32_t)0x0A)
+#define WEARLEVELING_BLOB_HEADER_SIZE           ((uint32_t)0x0C)
+
+static uint32_t wearleveling_blob_calculateSectorAddr(wearleveling_blob_state_typeDef * const pState, const uint16_t sector);
+static uint32_t wearleveling_blob_calculateDataAddr(wearleveling_blob_state_typeDef * const pState, const uint16_t firstSector, const uint32_t offset);
+static uint16_t wearleveling_blob_calculateNumOfSectors(wearleveling_blob_state_typeDef * const pState, const uint32_t sizeInByte);
+static uint16_t wearleveling_blob_getWriteId(wearleveling_blob_state_typeDef * const pState);
+static uint8_t wearleveling_blob_openSector(wearleveling_blob_state_typeDef * const pState, const uint16_t indexInBlob);
+static uint8_t wearleveling_blob_programTwoByte(wearleveling_blob_state_typeDef * const pState, const uint32_t offset, const uint16_t twoByte);
+
+wearleveling_blob_handle_typeDef
+wearleveling_blob_construct(wearleveling_blob_state_typeDef * const pState, const wearleveling_blob_params_typeDef * const pParam)
+{
+    if ((pState == NULL) || (pParam == NULL)) return NULL;
+    if ((pParam->readTwoByte == NULL) || (pParam->writeTwoByte == NULL) || (pParam->sectorErase == NULL)) return NULL;
+    if (pParam->numOfSectors == 0) return NULL;
+    if ((pParam->sectorSizeInByte % 2) || (pParam->sectorSizeInByte <= WEARLEVELING_BLOB_HEADER_SIZE)) return NULL;
+
+    memset((void *)pState, 0, sizeof(wearleveling_blob_state_typeDef));
+    pState->params = *pParam;
+    pState->payloadSizeInByte = pParam->sectorSizeInByte - WEARLEVELING_BLOB_HEADER_SIZE;
+
+    /* the newest committed first sector wins, ids compare with wrap around */
+    for(uint16_t i = 0; i < pParam->numOfSectors; i++)
+    {
+        const uint32_t ADDR = wearleveling_blob_calculateSectorAddr(pState, i);
+        if (pParam->readTwoByte(ADDR + WEARLEVELING_BLOB_ADDR_FORMATED_FLAG) != WEARLEVELING_BLOB_FORMATED_FLAG) continue;
+        if (pParam->readTwoByte(ADDR + WEARLEVELING_BLOB_ADDR_INDEX) != 0) continue;
+        if (pParam->readTwoByte(ADDR + WEARLEVELING_BLOB_ADDR_COMMIT_FLAG) != WEARLEVELING_BLOB_COMMIT_FLAG) continue;
+
+        const uint16_t BLOB_ID = pParam->readTwoByte(ADDR + WEARLEVELING_BLOB_ADDR_BLOB_ID);
+        if (pState->hasBlob && ((int16_t)(BLOB_ID - pState->blobId) <= 0)) continue;
+
+        const uint16_t SIZE_LOW = pParam->readTwoByte(ADDR + WEARLEVELING_BLOB_ADDR_SIZE_LOW);
+        const uint16_t SIZE_HIGH = pParam->readTwoByte(ADDR + WEARLEVELING_BLOB_ADDR_SIZE_HIGH);
+        const uint32_t SIZE = ((uint32_t)SIZE_HIGH << 16) | SIZE_LOW;
+        if (SIZE > (pState->payloadSizeInByte * pParam->numOfSectors)) continue;
+
+        pState->blobId = BLOB_ID;
+        pState->firstSector = i;
+        pState->sizeInByte = SIZE;
+        pState->hasBlob = 1;
+    }
+
+    return (wearleveling_blob_handle_typeDef)pState;
+}
+
+uint32_t wearleveling_blob_getSize(wearleveling_blob_handle_typeDef blob)
+{
+    return blob == NULL ? 0 : blob->sizeInByte;
+}
+
+uint32_t wearleveling_blob_getMaxSize(wearleveling_blob_handle_typeDef blob)
+{
+    if (blob == NULL) return 0;
+
+    /* the committed blob stays readable until the new one is committed */
+    const uint16_t NUM_OF_USED = blob->hasBlob ? wearleveling_blob_calculateNumOfSectors(blob, blob->sizeInByte) : 0;
+    return blob->payloadSizeInByte * (uint32_t)(blob->params.numOfSectors - NUM_OF_USED);
+}
+
+uint8_t wearleveling_blob_writeBegin(wearleveling_blob_handle_typeDef blob)
+{
+    if (blob == NULL) return 0;
+
+    /* right after the committed blob, so the pool wears evenly */
+    blob->writeFirstSector = 0;
+    if (blob->hasBlob)
+    {
+        const uint16_t NUM_OF_USED = wearleveling_blob_calculateNumOfSectors(blob, blob->sizeInByte);
+        blob->writeFirstSector = (uint16_t)((blob->firstSector + NUM_OF_USED) % blob->params.numOfSectors);
+    }
+
+    blob->writeSizeInByte = 0;
+    blob->hasPendingByte = 0;
+    blob->isWriting = 1;
+    return 1;
+}
+
+uint8_t wearleveling_blob_writeChunk(wearleveling_blob_handle_typeDef blob, const uint8_t * const pData, const uint16_t lengthInByte)
+{
+    if ((blob == NULL) || (pData == NULL)) return 0;
+    if (blob->isWriting == 0) return 0;
+    if ((blob->writeSizeInByte + lengthInByte) > wearleveling_blob_getMaxSize(blob)) return 0;
+
+    for(uint16_t i = 0; i < lengthInByte; i++)
+    {
+        blob->writeSizeInByte++;
+
+        /* an odd byte waits in RAM for its partner */
+        if (blob->hasPendingByte == 0)
+        {
+            blob->pendingByte = pData[i];
+            blob->hasPendingByte = 1;
+            continue;
+        }
+
+        const uint16_t TWO_BYTE = (uint16_t)(blob->pendingByte | (pData[i] << 8));
+        blob->hasPendingByte = 0;
+        if (wearleveling_blob_programTwoByte(blob, blob->writeSizeInByte - 2, TWO_BYTE) == 0)
+        {
+            blob->isWriting = 0;
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+uint8_t wearleveling_blob_writeCommit(wearleveling_blob_handle_typeDef blob)
+{
+    if (blob == NULL) return 0;
+    if (blob->isWriting == 0) return 0;
+    blob->isWriting = 0;
+
+    if (blob->hasPendingByte)
+    {
+        if (wearleveling_blob_programTwoByte(blob, blob->writeSizeInByte - 1, (uint16_t)(0xFF00 | blob->pendingByte)) == 0) return 0;
+        blob->hasPendingByte = 0;
+    }
+
+    /* an empty blob still needs the sector holding its commit record */
+    if (blob->writeSizeInByte == 0)
+    {
+        if (wearleveling_blob_openSector(blob, 0) == 0) return 0;
+    }
+
+    const uint32_t ADDR = wearleveling_blob_calculateSectorAddr(blob, blob->writeFirstSector);
+    if (blob->params.writeTwoByte(ADDR + WEARLEVELING_BLOB_ADDR_SIZE_LOW, (uint16_t)blob->writeSizeInByte) == 0) return 0;
+    if (blob->params.writeTwoByte(ADDR + WEARLEVELING_BLOB_ADDR_SIZE_HIGH, (uint16_t)(blob->writeSizeInByte >> 16)) == 0) return 0;
+
+    /* the program that makes the new blob visible */
+    if (blob->params.writeTwoByte(ADDR + WEARLEVELING_BLOB_ADDR_COMMIT_FLAG, WEARLEVELING_BLOB_COMMIT_FLAG) == 0) return 0;
+
+    blob->blobId = wearleveling_blob_getWriteId(blob);
+    blob->firstSector = blob->writeFirstSector;
+    blob->sizeInByte = blob->writeSizeInByte;
+    blob->hasBlob = 1;
+    blob->readOffset = 0;
+    return 1;
+}
+
+uint8_t wearleveling_blob_writeAbort(wearleveling_blob_handle_typeDef blob)
+{
+    if (blob == NULL) return 0;
+    if (blob->isWriting == 0) return 0;
+
+    /* the sectors written so far are reused by the next write */
+    blob->isWriting = 0;
+    blob->hasPendingByte = 0;
+    return 1;
+}
+
+uint8_t wearleveling_blob_readBegin(wearleveling_blob_handle_typeDef blob)
+{
+    if (blob == NULL) return 0;
+    if (blob->hasBlob == 0) return 0;
+
+    blob->readOffset = 0;
+    return 1;
+}
+
+uint16_t wearleveling_blob_readChunk(wearleveling_blob_handle_typeDef blob, uint8_t * const pBuffer, const uint16_t lengthInByte)
+{
+    if ((blob == NULL) || (pBuffer == NULL)) return 0;
+    if (blob->hasBlob == 0) return 0;
+
+    uint16_t numOfRead = 0;
+    while ((numOfRead < lengthInByte) && (blob->readOffset < blob->sizeInByte))
+    {
+        /* payloads are even, a half word never crosses a sector */
+        const uint32_t ADDR = wearleveling_blob_calculateDataAddr(blob, blob->firstSector, blob->readOffset & ~(uint32_t)1);
+        const uint16_t TWO_BYTE = blob->params.readTwoByte(ADDR);
+
+        if (blob->readOffset % 2)
+        {
+            pBuffer[numOfRead++] = (uint8_t)(TWO_BYTE >> 8);
+            blob->readOffset++;
+            continue;
+        }
+
+        pBuffer[numOfRead++] = (uint8_t)TWO_BYTE;
+        blob->readOffset++;
+        if ((numOfRead < lengthInByte) && (blob->readOffset < blob->sizeInByte))
+        {
+            pBuffer[numOfRead++] = (uint8_t)(TWO_BYTE >> 8);
+            blob->readOffset++;
+        }
+    }
+
+    return numOfRead;
+}
+
+static uint32_t wearleveling_blob_calculateSectorAddr(wearleveling_blob_state_typeDef * const pState, const uint16_t sector)
+{
+    return pState->params.baseAddr + ((uint32_t)sector * pState->params.sectorSizeInByte);
+}
+
+static uint32_t wearleveling_blob_calculateDataAddr(wearleveling_blob_state_typeDef * const pState, const uint16_t firstSector, const uint32_t offset)
+{
+    const uint16_t SECTOR = (uint16_t)((firstSector + (offset / pState->payloadSizeInByte)) % pState->params.numOfSectors);
+    return wearleveling_blob_calculateSectorAddr(pState, SECTOR) + WEARLEVELING_BLOB_HEADER_SIZE + (offset % pState->payloadSizeInByte);
+}
+
+static uint16_t wearleveling_blob_calculateNumOfSectors(wearleveling_blob_state_typeDef * const pState, const uint32_t sizeInByte)
+{
+    if (sizeInByte == 0) return 1;
+    return (uint16_t)((sizeInByte + pState->payloadSizeInByte - 1) / pState->payloadSizeInByte);
+}
+
+static uint16_t wearleveling_blob_getWriteId(wearleveling_blob_state_typeDef * const pState)
+{
+    return (uint16_t)(pState->blobId + pState->hasBlob);
+}
+
+static uint8_t wearleveling_blob_openSector(wearleveling_blob_state_typeDef * const pState, const uint16_t indexInBlob)
+{
+    const uint16_t SECTOR = (uint16_t)((pState->writeFirstSector + indexInBlob) % pState->params.numOfSectors);
+    const uint32_t ADDR = wearleveling_blob_calculateSectorAddr(pState, SECTOR);
+
+    if (pState->params.sectorErase(ADDR) == 0) return 0;
+    if (pState->params.writeTwoByte(ADDR + WEARLEVELING_BLOB_ADDR_BLOB_ID, wearleveling_blob_getWriteId(pState)) == 0) return 0;
+    if (pState->params.writeTwoByte(ADDR + WEARLEVELING_BLOB_ADDR_INDEX, indexInBlob) == 0) return 0;
+
+    return pState->params.writeTwoByte(ADDR + WEARLEVELING_BLOB_ADDR_FORMATED_FLAG, WEARLEVELING_BLOB_FORMATED_FLAG);
+}
+
+static uint8_t wearleveling_blob_programTwoByte(wearleveling_blob_state_typeDef * const pState, const uint32_t offset, const uint16_t twoByte)
+{
+    if ((offset % pState->payloadSizeInByte) == 0)
+    {
+        if (wearleveling_blob_openSector(pState, (uint16_t)(offset / pState->payloadSizeInByte)) == 0) return 0;
+    }
+
+    return pState->params.writeTwoByte(wearleveling_blob_calculateDataAddr(pState, pState->writeFirstSector, offset), twoByte);
+}
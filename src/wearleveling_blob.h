@@ -0,0 +1,66 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "wearleveling.h"
+
+//
+// Payloads larger than a page (certificates, model weights, calibration
+// tables), written as a log of whole sectors around a pool. Every sector
+// of a blob carries a header, the first one also the commit record:
+//
+//   sector header: [formated flag][blob id][index in blob][size low][size high][commit flag]
+//
+// A new blob is streamed chunk by chunk into the sectors after the current
+// one and becomes visible with the commit flag, the last program of the
+// write; until then, and after a power loss, reads get the previous blob.
+// Reads are streamed the same way. RAM use does not depend on the blob
+// size, a blob may take every sector the current one does not.
+//
+typedef struct
+{
+    uint32_t baseAddr;
+    uint32_t sectorSizeInByte;                      /* even, larger than the header */
+    uint16_t numOfSectors;
+    uint16_t (*readTwoByte) (uint32_t addr);
+    uint8_t (*writeTwoByte) (uint32_t addr, uint16_t data);
+    uint8_t (*sectorErase) (uint32_t addr);
+}wearleveling_blob_params_typeDef;
+
+typedef struct
+{
+    wearleveling_blob_params_typeDef params;
+    uint32_t payloadSizeInByte;                     /* per sector */
+    /* newest committed blob */
+    uint32_t sizeInByte;
+    uint16_t blobId;
+    uint16_t firstSector;
+    uint8_t hasBlob;
+    /* streamed write */
+    uint32_t writeSizeInByte;
+    uint16_t writeFirstSector;
+    uint8_t pendingByte;
+    uint8_t hasPendingByte;
+    uint8_t isWriting;
+    /* streamed read */
+    uint32_t readOffset;
+}wearleveling_blob_state_typeDef;
+
+typedef wearleveling_blob_state_typeDef* wearleveling_blob_handle_typeDef;
+
+wearleveling_blob_handle_typeDef wearleveling_blob_construct(wearleveling_blob_state_typeDef * const pState, const wearleveling_blob_params_typeDef * const pParam);
+uint32_t wearleveling_blob_getSize(wearleveling_blob_handle_typeDef blob);
+uint32_t wearleveling_blob_getMaxSize(wearleveling_blob_handle_typeDef blob);
+uint8_t wearleveling_blob_writeBegin(wearleveling_blob_handle_typeDef blob);
+uint8_t wearleveling_blob_writeChunk(wearleveling_blob_handle_typeDef blob, const uint8_t * const pData, const uint16_t lengthInByte);
+uint8_t wearleveling_blob_writeCommit(wearleveling_blob_handle_typeDef blob);
+uint8_t wearleveling_blob_writeAbort(wearleveling_blob_handle_typeDef blob);
+uint8_t wearleveling_blob_readBegin(wearleveling_blob_handle_typeDef blob);
+uint16_t wearleveling_blob_readChunk(wearleveling_blob_handle_typeDef blob, uint8_t * const pBuffer, const uint16_t lengthInByte);
+
+#ifdef __cplusplus
+}
+#endif
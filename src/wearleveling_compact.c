@@ -0,0 +1,125 @@
+#include <string.h>
+#include "wearleveling_compact.h"
+
+#define WEARLEVELING_COMPACT_HEADER_SIZE        ((uint16_t)sizeof(WEARLEVELING_LIB_FORMATED_FLAG))
+
+static uint16_t wearleveling_compact_calculateBucketSize(const wearleveling_compact_device_typeDef * const pDevice);
+static uint32_t wearleveling_compact_calculatePageAddr(const wearleveling_compact_device_typeDef * const pDevice, const wearleveling_compact_state_typeDef * const pState);
+static uint32_t wearleveling_compact_calculateBucketAddr(const wearleveling_compact_device_typeDef * const pDevice, const wearleveling_compact_state_typeDef * const pState, const uint16_t index);
+static uint8_t wearleveling_compact_isBucketUsed(const wearleveling_compact_device_typeDef * const pDevice, const wearleveling_compact_state_typeDef * const pState, const uint16_t index);
+static uint8_t wearleveling_compact_formatPage(const wearleveling_compact_device_typeDef * const pDevice, wearleveling_compact_state_typeDef * const pState);
+
+uint8_t wearleveling_compact_construct(const wearleveling_compact_device_typeDef * const pDevice, wearleveling_compact_state_typeDef * const pState, const uint16_t indexPage)
+{
+    if ((pDevice == NULL) || (pState == NULL)) return 0;
+    if ((pDevice->readTwoByte == NULL) || (pDevice->writeTwoByte == NULL) || (pDevice->pageErase == NULL)) return 0;
+    if (pDevice->dataSizeInByte == 0) return 0;
+    if (wearleveling_compact_getNumOfBuckets(pDevice) == 0) return 0;
+
+    pState->indexPage = indexPage;
+    pState->indexBucketWrite = 0;
+
+    const uint32_t PAGE_ADDR = wearleveling_compact_calculatePageAddr(pDevice, pState);
+    if (pDevice->readTwoByte(PAGE_ADDR) != WEARLEVELING_LIB_FORMATED_FLAG) return wearleveling_compact_formatPage(pDevice, pState);
+
+    const uint16_t NUM_OF_BUCKETS = wearleveling_compact_getNumOfBuckets(pDevice);
+    while ((pState->indexBucketWrite < NUM_OF_BUCKETS) && wearleveling_compact_isBucketUsed(pDevice, pState, pState->indexBucketWrite))
+    {
+        pState->indexBucketWrite++;
+    }
+
+    return 1;
+}
+
+uint8_t wearleveling_compact_save(const wearleveling_compact_device_typeDef * const pDevice, wearleveling_compact_state_typeDef * const pState, const uint8_t * const pData)
+{
+    if ((pDevice == NULL) || (pState == NULL) || (pData == NULL)) return 0;
+
+    if (pState->indexBucketWrite >= wearleveling_compact_getNumOfBuckets(pDevice))
+    {
+        if (wearleveling_compact_formatPage(pDevice, pState) == 0) return 0;
+    }
+
+    const uint32_t ADDR = wearleveling_compact_calculateBucketAddr(pDevice, pState, pState->indexBucketWrite);
+    const uint16_t NUM_OF_TWO_BYTES = pDevice->dataSizeInByte >> 1;
+
+    for(uint16_t i = 0; i < NUM_OF_TWO_BYTES; i++)
+    {
+        const uint16_t TWO_BYTE = (uint16_t)(((uint16_t)pData[(i * 2) + 1] << 8) | pData[i * 2]);
+        if (pDevice->writeTwoByte(ADDR + ((uint32_t)i * 2), TWO_BYTE) == 0) return 0;
+    }
+
+    /* the dirty flag shares the last half word with an odd last byte */
+    const uint16_t LAST_TWO_BYTE = (pDevice->dataSizeInByte & 1U) ?
+        (uint16_t)((WEARLEVELING_LIB_DIRTY_FLAG << 8) | pData[pDevice->dataSizeInByte - 1]) :
+        (uint16_t)((WEARLEVELING_LIB_EMPTY_FLAG << 8) | WEARLEVELING_LIB_DIRTY_FLAG);
+    if (pDevice->writeTwoByte(ADDR + ((uint32_t)NUM_OF_TWO_BYTES * 2), LAST_TWO_BYTE) == 0) return 0;
+
+    pState->indexBucketWrite++;
+    return 1;
+}
+
+uint8_t wearleveling_compact_read(const wearleveling_compact_device_typeDef * const pDevice, const wearleveling_compact_state_typeDef * const pState, uint8_t * const pData)
+{
+    if ((pDevice == NULL) || (pState == NULL) || (pData == NULL)) return 0;
+    if (pState->indexBucketWrite == 0) return 0;
+
+    const uint32_t ADDR = wearleveling_compact_calculateBucketAddr(pDevice, pState, pState->indexBucketWrite - 1);
+    const uint16_t NUM_OF_TWO_BYTES = pDevice->dataSizeInByte >> 1;
+
+    for(uint16_t i = 0; i < NUM_OF_TWO_BYTES; i++)
+    {
+        const uint16_t TWO_BYTE = pDevice->readTwoByte(ADDR + ((uint32_t)i * 2));
+        pData[i * 2] = (uint8_t)TWO_BYTE;
+        pData[(i * 2) + 1] = (uint8_t)(TWO_BYTE >> 8);
+    }
+
+    if (pDevice->dataSizeInByte & 1U)
+    {
+        pData[pDevice->dataSizeInByte - 1] = (uint8_t)pDevice->readTwoByte(ADDR + ((uint32_t)NUM_OF_TWO_BYTES * 2));
+    }
+
+    return 1;
+}
+
+uint16_t wearleveling_compact_getNumOfBuckets(const wearleveling_compact_device_typeDef * const pDevice)
+{
+    if (pDevice == NULL) return 0;
+    if (pDevice->pageCapacityInByte <= WEARLEVELING_COMPACT_HEADER_SIZE) return 0;
+    return (uint16_t)((pDevice->pageCapacityInByte - WEARLEVELING_COMPACT_HEADER_SIZE) / wearleveling_compact_calculateBucketSize(pDevice));
+}
+
+static uint16_t wearleveling_compact_calculateBucketSize(const wearleveling_compact_device_typeDef * const pDevice)
+{
+    /* data and dirty flag, rounded up to whole half words */
+    return (uint16_t)((pDevice->dataSizeInByte + sizeof(WEARLEVELING_LIB_DIRTY_FLAG) + 1U) & ~1U);
+}
+
+static uint32_t wearleveling_compact_calculatePageAddr(const wearleveling_compact_device_typeDef * const pDevice, const wearleveling_compact_state_typeDef * const pState)
+{
+    return (uint32_t)pState->indexPage * pDevice->pageCapacityInByte;
+}
+
+static uint32_t wearleveling_compact_calculateBucketAddr(const wearleveling_compact_device_typeDef * const pDevice, const wearleveling_compact_state_typeDef * const pState, const uint16_t index)
+{
+    return wearleveling_compact_calculatePageAddr(pDevice, pState) + WEARLEVELING_COMPACT_HEADER_SIZE + ((uint32_t)index * wearleveling_compact_calculateBucketSize(pDevice));
+}
+
+static uint8_t wearleveling_compact_isBucketUsed(const wearleveling_compact_device_typeDef * const pDevice, const wearleveling_compact_state_typeDef * const pState, const uint16_t index)
+{
+    const uint32_t LAST_TWO_BYTE_ADDR = wearleveling_compact_calculateBucketAddr(pDevice, pState, index + 1) - 2;
+    const uint16_t LAST_TWO_BYTE = pDevice->readTwoByte(LAST_TWO_BYTE_ADDR);
+    const uint8_t DIRTY_FLAG = (pDevice->dataSizeInByte & 1U) ? (uint8_t)(LAST_TWO_BYTE >> 8) : (uint8_t)LAST_TWO_BYTE;
+
+    return DIRTY_FLAG == WEARLEVELING_LIB_EMPTY_FLAG ? 0 : 1;
+}
+
+static uint8_t wearleveling_compact_formatPage(const wearleveling_compact_device_typeDef * const pDevice, wearleveling_compact_state_typeDef * const pState)
+{
+    const uint32_t PAGE_ADDR = wearleveling_compact_calculatePageAddr(pDevice, pState);
+    if (pDevice->pageErase(PAGE_ADDR) == 0) return 0;
+    if (pDevice->writeTwoByte(PAGE_ADDR, WEARLEVELING_LIB_FORMATED_FLAG) == 0) return 0;
+
+    pState->indexBucketWrite = 0;
+    return 1;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "wearleveling.h"
+
+//
+// Many small stores for parts short of RAM. Callbacks and geometry are
+// the same for every store and live once in a const device object; a
+// store keeps only its page and write index, 4 bytes, and every call
+// takes the device next to it. Store n owns the page at
+// n * pageCapacityInByte, laid out like a single page v2 store:
+//
+//   page: [formated flag][bucket][bucket] ...
+//   bucket: [data][dirty flag](padding to even)
+//
+// The store keeps no read index, no counters and no read cache; the
+// newest record is the bucket before the write index.
+//
+typedef struct
+{
+    uint16_t pageCapacityInByte;
+    uint16_t dataSizeInByte;
+    uint16_t (*readTwoByte) (uint32_t addr);
+    uint8_t (*writeTwoByte) (uint32_t addr, uint16_t data);
+    uint8_t (*pageErase) (uint32_t addr);
+}wearleveling_compact_device_typeDef;
+
+typedef struct
+{
+    uint16_t indexPage;
+    uint16_t indexBucketWrite;
+}wearleveling_compact_state_typeDef;
+
+uint8_t wearleveling_compact_construct(const wearleveling_compact_device_typeDef * const pDevice, wearleveling_compact_state_typeDef * const pState, const uint16_t indexPage);
+uint8_t wearleveling_compact_save(const wearleveling_compact_device_typeDef * const pDevice, wearleveling_compact_state_typeDef * const pState, const uint8_t * const pData);
+uint8_t wearleveling_compact_read(const wearleveling_compact_device_typeDef * const pDevice, const wearleveling_compact_state_typeDef * const pState, uint8_t * const pData);
+uint16_t wearleveling_compact_getNumOfBuckets(const wearleveling_compact_device_typeDef * const pDevice);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <coroutine>
+#include <type_traits>
+#include "wearleveling.h"
+
+namespace wearlevelingLibrary
+{
+    //
+    // Awaitable front-end over the asynchronous v2 API. The coroutine is
+    // parked while the driver erases/programs and resumed from the driver
+    // completion, so the executor thread keeps running other work. Several
+    // coroutines may await the same store, their operations run in order.
+    // The store keeps the async buffer and must stay at a fixed address.
+    //
+    template <typename T>
+    class AsyncWearLeveled
+    {
+        public:
+            static constexpr uint32_t BucketSize = (sizeof(T) + sizeof(WEARLEVELING_LIB_DIRTY_FLAG) + 1) & ~(uint32_t)1;
+
+            static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+            class Operation
+            {
+                public:
+                    bool await_ready(void) const noexcept
+                    {
+                        return false;
+                    }
+
+                    bool await_suspend(std::coroutine_handle<> coroutine) noexcept
+                    {
+                        this->coroutine = coroutine;
+                        store.enqueue(this);
+                        if (isComplete) return false;
+                        isSuspended = true;
+                        return true;
+                    }
+
+                protected:
+                    friend class AsyncWearLeveled;
+
+                    Operation(AsyncWearLeveled &store, const bool isSave) : store(store), isSave(isSave) {}
+
+                    AsyncWearLeveled &store;
+                    const bool isSave;
+                    T data;
+                    std::coroutine_handle<> coroutine;
+                    Operation * pNext = nullptr;
+                    bool isComplete = false;
+                    bool isSuspended = false;
+                    bool isSuccess = false;
+            };
+
+            class SaveOperation : public Operation
+            {
+                public:
+                    SaveOperation(AsyncWearLeveled &store, const T &data) : Operation(store, true) { this->data = data; }
+                    bool await_resume(void) const noexcept { return this->isSuccess; }
+            };
+
+            class LoadOperation : public Operation
+            {
+                public:
+                    LoadOperation(AsyncWearLeveled &store) : Operation(store, false) {}
+                    T await_resume(void) const noexcept { return this->data; }
+            };
+
+            AsyncWearLeveled(wearleveling_handle_typeDef handle, const wearleveling_async_driver_typeDef &driver) : handle(handle)
+            {
+                isAttached = (handle != NULL) && (handle->params.dataSizeInByte == sizeof(T)) &&
+                    (wearleveling_v2_setAsyncDriver(handle, &driver, buffer) != 0);
+            }
+
+            AsyncWearLeveled(const AsyncWearLeveled &) = delete;
+            AsyncWearLeveled &operator=(const AsyncWearLeveled &) = delete;
+
+            bool isValid(void) const
+            {
+                return isAttached;
+            }
+
+            SaveOperation save(const T &data)
+            {
+                return SaveOperation(*this, data);
+            }
+
+            LoadOperation load(void)
+            {
+                return LoadOperation(*this);
+            }
+
+        private:
+            wearleveling_handle_typeDef handle;
+            uint8_t buffer[BucketSize];
+            bool isAttached = false;
+            Operation * pInFlight = nullptr;
+            Operation * pHead = nullptr;
+            Operation * pTail = nullptr;
+
+            void enqueue(Operation * const pOperation)
+            {
+                if (pTail == nullptr) pHead = pOperation;
+                else pTail->pNext = pOperation;
+                pTail = pOperation;
+
+                if (pInFlight == nullptr) startNext();
+            }
+
+            void startNext(void)
+            {
+                while ((pInFlight == nullptr) && (pHead != nullptr))
+                {
+                    Operation * const pOperation = pHead;
+                    pHead = pOperation->pNext;
+                    if (pHead == nullptr) pTail = nullptr;
+
+                    pInFlight = pOperation;
+                    uint8_t isStarted = 0;
+                    if (isAttached)
+                    {
+                        isStarted = pOperation->isSave ?
+                            wearleveling_v2_saveAsync(handle, (const uint8_t *)&pOperation->data, onDone, this) :
+                            wearleveling_v2_readAsync(handle, (uint8_t *)&pOperation->data, onDone, this);
+                    }
+                    if (isStarted == 0) complete(0);
+                }
+            }
+
+            void complete(const uint8_t isSuccess)
+            {
+                Operation * const pOperation = pInFlight;
+                pInFlight = nullptr;
+                pOperation->isSuccess = isSuccess != 0;
+                pOperation->isComplete = true;
+
+                /* queued work goes to the driver before the waiter runs again */
+                startNext();
+                if (pOperation->isSuspended) pOperation->coroutine.resume();
+            }
+
+            static void onDone(void * pContext, uint8_t isSuccess)
+            {
+                static_cast<AsyncWearLeveled *>(pContext)->complete(isSuccess);
+            }
+    };
+}
@@ -0,0 +1,210 @@
+#include <string.h>
+#include "wearleveling_counter.h"
+
+#define WEARLEVELING_COUNTER_FORMATED_FLAG      ((uint16_t)0x4321)
+#define WEARLEVELING_COUNTER_ADDR_FORMATED_FLAG ((uint32_t)0x00)
+#define WEARLEVELING_COUNTER_ADDR_BASE_LOW      ((uint32_t)0x02)
+#define WEARLEVELING_COUNTER_ADDR_BASE_HIGH     ((uint32_t)0x04)
+#define WEARLEVELING_COUNTER_ADDR_BIT_FIELD     ((uint32_t)0x06)
+#define WEARLEVELING_COUNTER_BITS_PER_HALF_WORD (16U)
+#define WEARLEVELING_COUNTER_ERASED_HALF_WORD   ((uint16_t)0xFFFF)
+
+static uint8_t wearleveling_counter_isFormated(wearleveling_counter_state_typeDef * const pState, const uint32_t sectorAddr);
+static uint8_t wearleveling_counter_formatPage(wearleveling_counter_state_typeDef * const pState, const uint32_t baseValue);
+static uint8_t wearleveling_counter_formatSector(wearleveling_counter_state_typeDef * const pState, const uint32_t sectorAddr, const uint32_t baseValue);
+static uint32_t wearleveling_counter_readBase(wearleveling_counter_state_typeDef * const pState, const uint32_t sectorAddr);
+static void wearleveling_counter_mount(wearleveling_counter_state_typeDef * const pState);
+static uint16_t wearleveling_counter_findIndexHalfWord(wearleveling_counter_state_typeDef * const pState);
+static uint16_t wearleveling_counter_countSetBits(uint16_t halfWord);
+static uint32_t wearleveling_counter_calculateAddressFromIndex(wearleveling_counter_state_typeDef * const pState, const uint16_t index);
+
+wearleveling_counter_handle_typeDef
+wearleveling_counter_construct(wearleveling_counter_state_typeDef * const pState, wearleveling_params_typeDef * const pParam)
+{
+    if ((pState == NULL) || (pParam == NULL)) return NULL;
+    if (pParam->pageCapacityInByte < (WEARLEVELING_COUNTER_ADDR_BIT_FIELD + 2)) return NULL;
+
+    memset((void *)pState, 0, sizeof(wearleveling_counter_state_typeDef));
+    pState->params = *pParam;
+    pState->numOfHalfWords = (pParam->pageCapacityInByte - WEARLEVELING_COUNTER_ADDR_BIT_FIELD) >> 1;
+
+    if (wearleveling_counter_isFormated(pState, 0) == 0)
+    {
+        if (wearleveling_counter_formatPage(pState, 0) == 0) return NULL;
+        return (wearleveling_counter_handle_typeDef)pState;
+    }
+
+    wearleveling_counter_mount(pState);
+    return (wearleveling_counter_handle_typeDef)pState;
+}
+
+wearleveling_counter_handle_typeDef
+wearleveling_counter_constructPingPong(wearleveling_counter_state_typeDef * const pState, wearleveling_params_typeDef * const pParam, const wearleveling_sector_params_typeDef * const pSectorParam)
+{
+    if ((pState == NULL) || (pParam == NULL) || (pSectorParam == NULL)) return NULL;
+    if (pSectorParam->sectorErase == NULL) return NULL;
+    if (pParam->pageCapacityInByte < (WEARLEVELING_COUNTER_ADDR_BIT_FIELD + 2)) return NULL;
+
+    memset((void *)pState, 0, sizeof(wearleveling_counter_state_typeDef));
+    pState->params = *pParam;
+    pState->sectorParams = *pSectorParam;
+    pState->isPingPong = 1;
+    pState->numOfHalfWords = (pParam->pageCapacityInByte - WEARLEVELING_COUNTER_ADDR_BIT_FIELD) >> 1;
+
+    const uint32_t ADDR_B = pSectorParam->spareSectorAddr;
+    const uint8_t IS_FORMATED_A = wearleveling_counter_isFormated(pState, 0);
+    const uint8_t IS_FORMATED_B = wearleveling_counter_isFormated(pState, ADDR_B);
+
+    if ((IS_FORMATED_A == 0) && (IS_FORMATED_B == 0))
+    {
+        if (wearleveling_counter_formatSector(pState, 0, 0) == 0) return NULL;
+        return (wearleveling_counter_handle_typeDef)pState;
+    }
+
+    /* a roll over that lost power before erasing the old sector leaves both, the base only grows */
+    pState->baseAddr = 0;
+    if (IS_FORMATED_B && ((IS_FORMATED_A == 0) || (wearleveling_counter_readBase(pState, ADDR_B) > wearleveling_counter_readBase(pState, 0))))
+    {
+        pState->baseAddr = ADDR_B;
+    }
+
+    wearleveling_counter_mount(pState);
+    return (wearleveling_counter_handle_typeDef)pState;
+}
+
+uint8_t wearleveling_counter_increment(wearleveling_counter_handle_typeDef handle)
+{
+    if (handle == NULL) return 0;
+
+    if (handle->indexHalfWord >= handle->numOfHalfWords)
+    {
+        if (wearleveling_counter_formatPage(handle, handle->value) == 0) return 0;
+    }
+
+    /* clear the lowest bit that is still set */
+    const uint16_t NEXT_HALF_WORD = handle->currentHalfWord & (uint16_t)(handle->currentHalfWord - 1);
+    const uint32_t ADDRESS = wearleveling_counter_calculateAddressFromIndex(handle, handle->indexHalfWord);
+    if (handle->params.writeTwoByte(ADDRESS, NEXT_HALF_WORD) == 0) return 0;
+
+    handle->value++;
+    handle->currentHalfWord = NEXT_HALF_WORD;
+
+    if (NEXT_HALF_WORD == 0)
+    {
+        handle->indexHalfWord++;
+        handle->currentHalfWord = WEARLEVELING_COUNTER_ERASED_HALF_WORD;
+    }
+
+    return 1;
+}
+
+uint32_t wearleveling_counter_read(wearleveling_counter_handle_typeDef handle)
+{
+    return handle == NULL ? 0 : handle->value;
+}
+
+uint32_t wearleveling_counter_getIncrementsPerErase(wearleveling_counter_handle_typeDef handle)
+{
+    return handle == NULL ? 0 : (uint32_t)handle->numOfHalfWords * WEARLEVELING_COUNTER_BITS_PER_HALF_WORD;
+}
+
+static uint8_t wearleveling_counter_isFormated(wearleveling_counter_state_typeDef * const pState, const uint32_t sectorAddr)
+{
+    if (pState == NULL) return 0;
+    uint16_t formatedFlag = pState->params.readTwoByte(sectorAddr + WEARLEVELING_COUNTER_ADDR_FORMATED_FLAG);
+    return formatedFlag == WEARLEVELING_COUNTER_FORMATED_FLAG ? 1 : 0;
+}
+
+static uint8_t wearleveling_counter_formatPage(wearleveling_counter_state_typeDef * const pState, const uint32_t baseValue)
+{
+    if (pState == NULL) return 0;
+
+    if (pState->isPingPong)
+    {
+        /* the active sector keeps the count until the other one carries the new base */
+        const uint32_t OTHER_ADDR = pState->baseAddr == 0 ? pState->sectorParams.spareSectorAddr : 0;
+        return wearleveling_counter_formatSector(pState, OTHER_ADDR, baseValue);
+    }
+
+    if (pState->params.pageErase() == 0) return 0;
+    return wearleveling_counter_formatSector(pState, 0, baseValue);
+}
+
+static uint8_t wearleveling_counter_formatSector(wearleveling_counter_state_typeDef * const pState, const uint32_t sectorAddr, const uint32_t baseValue)
+{
+    if (pState == NULL) return 0;
+    if (pState->isPingPong && (pState->sectorParams.sectorErase(sectorAddr) == 0)) return 0;
+
+    /* the formated flag goes last, a page without it is not trusted at construct */
+    if (pState->params.writeTwoByte(sectorAddr + WEARLEVELING_COUNTER_ADDR_BASE_LOW, (uint16_t)baseValue) == 0) return 0;
+    if (pState->params.writeTwoByte(sectorAddr + WEARLEVELING_COUNTER_ADDR_BASE_HIGH, (uint16_t)(baseValue >> 16)) == 0) return 0;
+    if (pState->params.writeTwoByte(sectorAddr + WEARLEVELING_COUNTER_ADDR_FORMATED_FLAG, WEARLEVELING_COUNTER_FORMATED_FLAG) == 0) return 0;
+
+    pState->baseAddr = sectorAddr;
+    pState->baseValue = baseValue;
+    pState->value = baseValue;
+    pState->indexHalfWord = 0;
+    pState->currentHalfWord = WEARLEVELING_COUNTER_ERASED_HALF_WORD;
+
+    return 1;
+}
+
+static uint32_t wearleveling_counter_readBase(wearleveling_counter_state_typeDef * const pState, const uint32_t sectorAddr)
+{
+    const uint16_t BASE_LOW = pState->params.readTwoByte(sectorAddr + WEARLEVELING_COUNTER_ADDR_BASE_LOW);
+    const uint16_t BASE_HIGH = pState->params.readTwoByte(sectorAddr + WEARLEVELING_COUNTER_ADDR_BASE_HIGH);
+    return ((uint32_t)BASE_HIGH << 16) | BASE_LOW;
+}
+
+static void wearleveling_counter_mount(wearleveling_counter_state_typeDef * const pState)
+{
+    pState->baseValue = wearleveling_counter_readBase(pState, pState->baseAddr);
+    pState->indexHalfWord = wearleveling_counter_findIndexHalfWord(pState);
+    pState->value = pState->baseValue + ((uint32_t)pState->indexHalfWord * WEARLEVELING_COUNTER_BITS_PER_HALF_WORD);
+    pState->currentHalfWord = WEARLEVELING_COUNTER_ERASED_HALF_WORD;
+
+    if (pState->indexHalfWord < pState->numOfHalfWords)
+    {
+        pState->currentHalfWord = pState->params.readTwoByte(wearleveling_counter_calculateAddressFromIndex(pState, pState->indexHalfWord));
+        pState->value += WEARLEVELING_COUNTER_BITS_PER_HALF_WORD - wearleveling_counter_countSetBits(pState->currentHalfWord);
+    }
+}
+
+static uint16_t wearleveling_counter_findIndexHalfWord(wearleveling_counter_state_typeDef * const pState)
+{
+    if (pState == NULL) return 0;
+
+    /* fully cleared half words are always in front of the others, binary search the first one with a bit set */
+    uint16_t low = 0;
+    uint16_t high = pState->numOfHalfWords;
+
+    while (low < high)
+    {
+        const uint16_t MIDDLE = low + ((high - low) >> 1);
+        const uint16_t HALF_WORD = pState->params.readTwoByte(wearleveling_counter_calculateAddressFromIndex(pState, MIDDLE));
+
+        if (HALF_WORD == 0)
+        {
+            low = MIDDLE + 1;
+        }
+        else
+        {
+            high = MIDDLE;
+        }
+    }
+
+    return low;
+}
+
+static uint16_t wearleveling_counter_countSetBits(uint16_t halfWord)
+{
+    halfWord = halfWord - ((halfWord >> 1) & 0x5555);
+    halfWord = (halfWord & 0x3333) + ((halfWord >> 2) & 0x3333);
+    halfWord = (halfWord + (halfWord >> 4)) & 0x0F0F;
+    return (halfWord + (halfWord >> 8)) & 0x001F;
+}
+
+static uint32_t wearleveling_counter_calculateAddressFromIndex(wearleveling_counter_state_typeDef * const pState, const uint16_t index)
+{
+    return pState->baseAddr + WEARLEVELING_COUNTER_ADDR_BIT_FIELD + ((uint32_t)index * 2);
+}
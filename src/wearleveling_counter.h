@@ -0,0 +1,48 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "wearleveling.h"
+
+//
+// Monotonic counter stored as a thermometer code: every increment clears
+// one more bit of the page, the page is only erased (and the compacted
+// base value written) when all bits have been used.
+//
+// page layout:
+//   [formated flag][base value low][base value high][bit field ...]
+//
+// A single page is erased before the new base is programmed, a power cut
+// in between comes back as 0. Boot and anti-rollback counters want
+// constructPingPong: the roll over formats the other sector with the new
+// base, flag last, and the old sector stays valid until the roll over
+// after; at construct the formated sector with the larger base wins.
+//
+typedef struct
+{
+    wearleveling_params_typeDef params;
+    /* ping-pong mode only */
+    wearleveling_sector_params_typeDef sectorParams;
+    uint32_t baseAddr;
+    uint8_t isPingPong;
+    uint32_t baseValue;
+    uint32_t value;
+    uint16_t indexHalfWord;
+    uint16_t currentHalfWord;
+    uint16_t numOfHalfWords;
+}wearleveling_counter_state_typeDef;
+
+typedef wearleveling_counter_state_typeDef* wearleveling_counter_handle_typeDef;
+
+wearleveling_counter_handle_typeDef wearleveling_counter_construct(wearleveling_counter_state_typeDef * const pState, wearleveling_params_typeDef * const pParam);
+wearleveling_counter_handle_typeDef wearleveling_counter_constructPingPong(wearleveling_counter_state_typeDef * const pState, wearleveling_params_typeDef * const pParam, const wearleveling_sector_params_typeDef * const pSectorParam);
+uint8_t wearleveling_counter_increment(wearleveling_counter_handle_typeDef handle);
+uint32_t wearleveling_counter_read(wearleveling_counter_handle_typeDef handle);
+uint32_t wearleveling_counter_getIncrementsPerErase(wearleveling_counter_handle_typeDef handle);
+
+#ifdef __cplusplus
+}
+#endif
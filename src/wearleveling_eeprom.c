@@ -0,0 +1,186 @@
+#include <string.h>
+#include "wearleveling_eeprom.h"
+
+#define WEARLEVELING_EEPROM_VALID_FLAG          ((uint16_t)0x4545)
+#define WEARLEVELING_EEPROM_ERASED_HALF_WORD    ((uint16_t)0xFFFF)
+#define WEARLEVELING_EEPROM_ADDR_VALID_FLAG     ((uint32_t)0x00)
+#define WEARLEVELING_EEPROM_ADDR_SEQUENCE       ((uint32_t)0x02)
+#define WEARLEVELING_EEPROM_ADDR_FIRST_ENTRY    ((uint32_t)0x04)
+#define WEARLEVELING_EEPROM_ENTRY_SIZE          ((uint32_t)0x04)
+
+static uint8_t wearleveling_eeprom_isValidSector(wearleveling_eeprom_state_typeDef * const pState, const uint32_t sectorAddr);
+static uint8_t wearleveling_eeprom_formatSector(wearleveling_eeprom_state_typeDef * const pState, const uint32_t sectorAddr, const uint16_t sequence);
+static void wearleveling_eeprom_loadTable(wearleveling_eeprom_state_typeDef * const pState);
+static uint8_t wearleveling_eeprom_writeEntry(wearleveling_eeprom_state_typeDef * const pState, const uint32_t sectorAddr, const uint16_t index, const uint16_t virtAddr, const uint16_t value);
+static uint8_t wearleveling_eeprom_isWritten(wearleveling_eeprom_state_typeDef * const pState, const uint16_t virtAddr);
+static void wearleveling_eeprom_setValue(wearleveling_eeprom_state_typeDef * const pState, const uint16_t virtAddr, const uint16_t value);
+static uint32_t wearleveling_eeprom_calculateEntryAddr(const uint32_t sectorAddr, const uint16_t index);
+
+wearleveling_eeprom_handle_typeDef
+wearleveling_eeprom_construct(wearleveling_eeprom_state_typeDef * const pState, const wearleveling_eeprom_params_typeDef * const pParam)
+{
+    if ((pState == NULL) || (pParam == NULL)) return NULL;
+    if ((pParam->readTwoByte == NULL) || (pParam->writeTwoByte == NULL) || (pParam->sectorErase == NULL)) return NULL;
+    if ((pParam->pValues == NULL) || (pParam->pIsWritten == NULL) || (pParam->numOfVariables == 0)) return NULL;
+    if (pParam->numOfVariables >= WEARLEVELING_EEPROM_ERASED_HALF_WORD) return NULL;
+
+    memset((void *)pState, 0, sizeof(wearleveling_eeprom_state_typeDef));
+    pState->params = *pParam;
+    pState->numOfEntries = (uint16_t)((pParam->sectorSizeInByte - WEARLEVELING_EEPROM_ADDR_FIRST_ENTRY) / WEARLEVELING_EEPROM_ENTRY_SIZE);
+
+    /* a compaction must leave room for the write that started it */
+    if (pState->numOfEntries <= pParam->numOfVariables) return NULL;
+
+    const uint8_t IS_VALID_A = wearleveling_eeprom_isValidSector(pState, 0);
+    const uint8_t IS_VALID_B = wearleveling_eeprom_isValidSector(pState, pParam->spareSectorAddr);
+    const uint16_t SEQUENCE_A = pParam->readTwoByte(WEARLEVELING_EEPROM_ADDR_SEQUENCE);
+    const uint16_t SEQUENCE_B = pParam->readTwoByte(pParam->spareSectorAddr + WEARLEVELING_EEPROM_ADDR_SEQUENCE);
+
+    if ((IS_VALID_A == 0) && (IS_VALID_B == 0))
+    {
+        if (wearleveling_eeprom_formatSector(pState, 0, 0) == 0) return NULL;
+    }
+    else if (IS_VALID_B && ((IS_VALID_A == 0) || ((int16_t)(SEQUENCE_B - SEQUENCE_A) > 0)))
+    {
+        pState->activeAddr = pParam->spareSectorAddr;
+        pState->sequence = SEQUENCE_B;
+    }
+    else
+    {
+        pState->activeAddr = 0;
+        pState->sequence = SEQUENCE_A;
+    }
+
+    wearleveling_eeprom_loadTable(pState);
+    return (wearleveling_eeprom_handle_typeDef)pState;
+}
+
+uint8_t wearleveling_eeprom_read(wearleveling_eeprom_handle_typeDef eeprom, const uint16_t virtAddr, uint16_t * const pValue)
+{
+    if ((eeprom == NULL) || (pValue == NULL)) return 0;
+    if (virtAddr >= eeprom->params.numOfVariables) return 0;
+    if (wearleveling_eeprom_isWritten(eeprom, virtAddr) == 0) return 0;
+
+    *pValue = eeprom->params.pValues[virtAddr];
+    return 1;
+}
+
+uint8_t wearleveling_eeprom_write(wearleveling_eeprom_handle_typeDef eeprom, const uint16_t virtAddr, const uint16_t value)
+{
+    if (eeprom == NULL) return 0;
+    if (virtAddr >= eeprom->params.numOfVariables) return 0;
+
+    /* same value, nothing to wear */
+    if (wearleveling_eeprom_isWritten(eeprom, virtAddr) && (eeprom->params.pValues[virtAddr] == value)) return 1;
+
+    if (eeprom->indexEntryWrite >= eeprom->numOfEntries)
+    {
+        if (wearleveling_eeprom_compact(eeprom) == 0) return 0;
+    }
+
+    if (wearleveling_eeprom_writeEntry(eeprom, eeprom->activeAddr, eeprom->indexEntryWrite, virtAddr, value) == 0) return 0;
+
+    eeprom->indexEntryWrite++;
+    wearleveling_eeprom_setValue(eeprom, virtAddr, value);
+    return 1;
+}
+
+uint8_t wearleveling_eeprom_compact(wearleveling_eeprom_handle_typeDef eeprom)
+{
+    if (eeprom == NULL) return 0;
+
+    const uint32_t TARGET_ADDR = eeprom->activeAddr == 0 ? eeprom->params.spareSectorAddr : 0;
+    if (eeprom->params.sectorErase(TARGET_ADDR) == 0) return 0;
+
+    /* the latest value of each variable, straight from the RAM table */
+    uint16_t index = 0;
+    for(uint16_t i = 0; i < eeprom->params.numOfVariables; i++)
+    {
+        if (wearleveling_eeprom_isWritten(eeprom, i) == 0) continue;
+        if (wearleveling_eeprom_writeEntry(eeprom, TARGET_ADDR, index, i, eeprom->params.pValues[i]) == 0) return 0;
+        index++;
+    }
+
+    const uint16_t SEQUENCE = (uint16_t)(eeprom->sequence + 1);
+    if (eeprom->params.writeTwoByte(TARGET_ADDR + WEARLEVELING_EEPROM_ADDR_SEQUENCE, SEQUENCE) == 0) return 0;
+    if (eeprom->params.writeTwoByte(TARGET_ADDR + WEARLEVELING_EEPROM_ADDR_VALID_FLAG, WEARLEVELING_EEPROM_VALID_FLAG) == 0) return 0;
+
+    eeprom->activeAddr = TARGET_ADDR;
+    eeprom->sequence = SEQUENCE;
+    eeprom->indexEntryWrite = index;
+    eeprom->numOfCompactions++;
+    return 1;
+}
+
+uint16_t wearleveling_eeprom_getNumOfFreeEntries(wearleveling_eeprom_handle_typeDef eeprom)
+{
+    return eeprom == NULL ? 0 : (uint16_t)(eeprom->numOfEntries - eeprom->indexEntryWrite);
+}
+
+uint32_t wearleveling_eeprom_getNumOfCompactions(wearleveling_eeprom_handle_typeDef eeprom)
+{
+    return eeprom == NULL ? 0 : eeprom->numOfCompactions;
+}
+
+static uint8_t wearleveling_eeprom_isValidSector(wearleveling_eeprom_state_typeDef * const pState, const uint32_t sectorAddr)
+{
+    return pState->params.readTwoByte(sectorAddr + WEARLEVELING_EEPROM_ADDR_VALID_FLAG) == WEARLEVELING_EEPROM_VALID_FLAG ? 1 : 0;
+}
+
+static uint8_t wearleveling_eeprom_formatSector(wearleveling_eeprom_state_typeDef * const pState, const uint32_t sectorAddr, const uint16_t sequence)
+{
+    if (pState->params.sectorErase(sectorAddr) == 0) return 0;
+    if (pState->params.writeTwoByte(sectorAddr + WEARLEVELING_EEPROM_ADDR_SEQUENCE, sequence) == 0) return 0;
+    if (pState->params.writeTwoByte(sectorAddr + WEARLEVELING_EEPROM_ADDR_VALID_FLAG, WEARLEVELING_EEPROM_VALID_FLAG) == 0) return 0;
+
+    pState->activeAddr = sectorAddr;
+    pState->sequence = sequence;
+    return 1;
+}
+
+static void wearleveling_eeprom_loadTable(wearleveling_eeprom_state_typeDef * const pState)
+{
+    memset(pState->params.pIsWritten, 0, (pState->params.numOfVariables + 7U) / 8U);
+    pState->indexEntryWrite = pState->numOfEntries;
+
+    /* one pass, later entries overwrite earlier ones */
+    for(uint16_t i = 0; i < pState->numOfEntries; i++)
+    {
+        const uint32_t ADDR = wearleveling_eeprom_calculateEntryAddr(pState->activeAddr, i);
+        const uint16_t VALUE = pState->params.readTwoByte(ADDR);
+        const uint16_t VIRT_ADDR = pState->params.readTwoByte(ADDR + 2);
+
+        if ((VALUE == WEARLEVELING_EEPROM_ERASED_HALF_WORD) && (VIRT_ADDR == WEARLEVELING_EEPROM_ERASED_HALF_WORD))
+        {
+            pState->indexEntryWrite = i;
+            return;
+        }
+
+        /* a torn entry has its value but no address */
+        if (VIRT_ADDR >= pState->params.numOfVariables) continue;
+        wearleveling_eeprom_setValue(pState, VIRT_ADDR, VALUE);
+    }
+}
+
+static uint8_t wearleveling_eeprom_writeEntry(wearleveling_eeprom_state_typeDef * const pState, const uint32_t sectorAddr, const uint16_t index, const uint16_t virtAddr, const uint16_t value)
+{
+    const uint32_t ADDR = wearleveling_eeprom_calculateEntryAddr(sectorAddr, index);
+    if (pState->params.writeTwoByte(ADDR, value) == 0) return 0;
+    return pState->params.writeTwoByte(ADDR + 2, virtAddr);
+}
+
+static uint8_t wearleveling_eeprom_isWritten(wearleveling_eeprom_state_typeDef * const pState, const uint16_t virtAddr)
+{
+    return (pState->params.pIsWritten[virtAddr >> 3] >> (virtAddr & 7U)) & 1U;
+}
+
+static void wearleveling_eeprom_setValue(wearleveling_eeprom_state_typeDef * const pState, const uint16_t virtAddr, const uint16_t value)
+{
+    pState->params.pIsWritten[virtAddr >> 3] |= (uint8_t)(1U << (virtAddr & 7U));
+    pState->params.pValues[virtAddr] = value;
+}
+
+static uint32_t wearleveling_eeprom_calculateEntryAddr(const uint32_t sectorAddr, const uint16_t index)
+{
+    return sectorAddr + WEARLEVELING_EEPROM_ADDR_FIRST_ENTRY + ((uint32_t)index * WEARLEVELING_EEPROM_ENTRY_SIZE);
+}
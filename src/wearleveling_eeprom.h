@@ -0,0 +1,57 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "wearleveling.h"
+
+//
+// EEPROM emulation with 16-bit variables at virtual addresses, for code
+// written against read(virtAddr)/write(virtAddr, value) (ST AN2594 style).
+// Every write appends one (value, address) pair to the active sector, the
+// address programmed last so a torn write is skipped. Two sectors, like
+// ping-pong mode, at 0 and spareSectorAddr:
+//
+//   sector: [valid flag][sequence][value][address][value][address] ...
+//
+// The mount walks the active sector once and fills a RAM table of every
+// variable, reads never touch flash. When the active sector is full the
+// latest value of each variable is copied to the other one, whose valid
+// flag goes last; until then a reset comes back to the old sector.
+//
+typedef struct
+{
+    uint16_t sectorSizeInByte;
+    uint32_t spareSectorAddr;
+    uint16_t numOfVariables;                        /* virtual addresses 0 .. numOfVariables - 1 */
+    uint16_t (*readTwoByte) (uint32_t addr);
+    uint8_t (*writeTwoByte) (uint32_t addr, uint16_t data);
+    uint8_t (*sectorErase) (uint32_t addr);
+    uint16_t * pValues;                             /* numOfVariables entries */
+    uint8_t * pIsWritten;                           /* (numOfVariables + 7) / 8 bytes */
+}wearleveling_eeprom_params_typeDef;
+
+typedef struct
+{
+    wearleveling_eeprom_params_typeDef params;
+    uint32_t activeAddr;
+    uint16_t sequence;
+    uint16_t numOfEntries;
+    uint16_t indexEntryWrite;
+    uint32_t numOfCompactions;
+}wearleveling_eeprom_state_typeDef;
+
+typedef wearleveling_eeprom_state_typeDef* wearleveling_eeprom_handle_typeDef;
+
+wearleveling_eeprom_handle_typeDef wearleveling_eeprom_construct(wearleveling_eeprom_state_typeDef * const pState, const wearleveling_eeprom_params_typeDef * const pParam);
+uint8_t wearleveling_eeprom_read(wearleveling_eeprom_handle_typeDef eeprom, const uint16_t virtAddr, uint16_t * const pValue);
+uint8_t wearleveling_eeprom_write(wearleveling_eeprom_handle_typeDef eeprom, const uint16_t virtAddr, const uint16_t value);
+uint8_t wearleveling_eeprom_compact(wearleveling_eeprom_handle_typeDef eeprom);
+uint16_t wearleveling_eeprom_getNumOfFreeEntries(wearleveling_eeprom_handle_typeDef eeprom);
+uint32_t wearleveling_eeprom_getNumOfCompactions(wearleveling_eeprom_handle_typeDef eeprom);
+
+#ifdef __cplusplus
+}
+#endif
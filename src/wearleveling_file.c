@@ -0,0 +1,155 @@
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "wearleveling_file.h"
+
+#define WEARLEVELING_FILE_ERASED_BYTE   ((uint8_t)0xFF)
+#define WEARLEVELING_FILE_CHUNK_SIZE    (4096U)
+
+static uint8_t wearleveling_file_prepare(wearleveling_file_typeDef * const pFile);
+static uint8_t wearleveling_file_fill(wearleveling_file_typeDef * const pFile, const uint32_t addr, const uint32_t sizeInByte);
+static uint8_t wearleveling_file_syncRange(wearleveling_file_typeDef * const pFile, const uint32_t addr, const uint32_t sizeInByte);
+
+uint8_t wearleveling_file_open(wearleveling_file_typeDef * const pFile, const char * const pPath, const wearleveling_file_params_typeDef * const pParam)
+{
+    if ((pFile == NULL) || (pPath == NULL) || (pParam == NULL)) return 0;
+    if ((pParam->sizeInByte == 0) || (pParam->eraseUnitInByte == 0)) return 0;
+    if ((pParam->sizeInByte % pParam->eraseUnitInByte) != 0) return 0;
+
+    memset((void *)pFile, 0, sizeof(wearleveling_file_typeDef));
+    pFile->params = *pParam;
+    pFile->fd = open(pPath, O_RDWR | O_CREAT, 0644);
+    if (pFile->fd < 0) return 0;
+
+    if (wearleveling_file_prepare(pFile) == 0)
+    {
+        close(pFile->fd);
+        pFile->fd = -1;
+        return 0;
+    }
+
+    void * const pMapped = mmap(NULL, pFile->params.sizeInByte, PROT_READ, MAP_SHARED, pFile->fd, 0);
+    if (pMapped == MAP_FAILED)
+    {
+        close(pFile->fd);
+        pFile->fd = -1;
+        return 0;
+    }
+
+    pFile->pMapped = (const uint8_t *)pMapped;
+    return 1;
+}
+
+void wearleveling_file_close(wearleveling_file_typeDef * const pFile)
+{
+    if ((pFile == NULL) || (pFile->pMapped == NULL)) return;
+
+    munmap((void *)pFile->pMapped, pFile->params.sizeInByte);
+    close(pFile->fd);
+    pFile->pMapped = NULL;
+    pFile->fd = -1;
+}
+
+uint8_t wearleveling_file_sync(wearleveling_file_typeDef * const pFile)
+{
+    if ((pFile == NULL) || (pFile->pMapped == NULL)) return 0;
+    return fdatasync(pFile->fd) == 0 ? 1 : 0;
+}
+
+uint16_t wearleveling_file_readTwoByte(wearleveling_file_typeDef * const pFile, uint32_t addr)
+{
+    if ((pFile == NULL) || (pFile->pMapped == NULL)) return 0;
+    if ((addr + 1) >= pFile->params.sizeInByte) return 0;
+
+    return (uint16_t)(pFile->pMapped[addr] | (pFile->pMapped[addr + 1] << 8));
+}
+
+uint8_t wearleveling_file_writeTwoByte(wearleveling_file_typeDef * const pFile, uint32_t addr, uint16_t data)
+{
+    if ((pFile == NULL) || (pFile->pMapped == NULL)) return 0;
+    if ((addr + 1) >= pFile->params.sizeInByte) return 0;
+    if (addr % 2) return 0;
+
+    /* NOR rule, a program can only clear bits */
+    const uint16_t CURRENT = wearleveling_file_readTwoByte(pFile, addr);
+    if ((uint16_t)(CURRENT & data) != data)
+    {
+        pFile->numOfRejectedWrites++;
+        return 0;
+    }
+
+    const uint8_t TWO_BYTE[2] = { (uint8_t)data, (uint8_t)(data >> 8) };
+    if (pwrite(pFile->fd, TWO_BYTE, sizeof(TWO_BYTE), (off_t)addr) != (ssize_t)sizeof(TWO_BYTE)) return 0;
+
+    return wearleveling_file_syncRange(pFile, addr, sizeof(TWO_BYTE));
+}
+
+uint8_t wearleveling_file_sectorErase(wearleveling_file_typeDef * const pFile, uint32_t addr)
+{
+    if ((pFile == NULL) || (pFile->pMapped == NULL)) return 0;
+    if ((addr % pFile->params.eraseUnitInByte) != 0) return 0;
+    if (addr >= pFile->params.sizeInByte) return 0;
+
+    if (wearleveling_file_fill(pFile, addr, pFile->params.eraseUnitInByte) == 0) return 0;
+    return wearleveling_file_syncRange(pFile, addr, pFile->params.eraseUnitInByte);
+}
+
+uint8_t wearleveling_file_pageErase(wearleveling_file_typeDef * const pFile)
+{
+    return wearleveling_file_sectorErase(pFile, 0);
+}
+
+static uint8_t wearleveling_file_prepare(wearleveling_file_typeDef * const pFile)
+{
+    if (pFile == NULL) return 0;
+
+    struct stat fileStat;
+    if (fstat(pFile->fd, &fileStat) != 0) return 0;
+
+    /* block devices report no size through st_size, ask the device itself */
+    if (S_ISBLK(fileStat.st_mode))
+    {
+        const off_t DEVICE_SIZE = lseek(pFile->fd, 0, SEEK_END);
+        return DEVICE_SIZE >= (off_t)pFile->params.sizeInByte ? 1 : 0;
+    }
+
+    if (S_ISREG(fileStat.st_mode) == 0) return 0;
+    if (fileStat.st_size >= (off_t)pFile->params.sizeInByte) return 1;
+
+    /* a new or short file is grown as erased flash */
+    const uint32_t OLD_SIZE = (uint32_t)fileStat.st_size;
+    if (ftruncate(pFile->fd, (off_t)pFile->params.sizeInByte) != 0) return 0;
+    return wearleveling_file_fill(pFile, OLD_SIZE, pFile->params.sizeInByte - OLD_SIZE);
+}
+
+static uint8_t wearleveling_file_fill(wearleveling_file_typeDef * const pFile, const uint32_t addr, const uint32_t sizeInByte)
+{
+    if (pFile == NULL) return 0;
+
+    uint8_t chunk[WEARLEVELING_FILE_CHUNK_SIZE];
+    memset(chunk, WEARLEVELING_FILE_ERASED_BYTE, sizeof(chunk));
+
+    uint32_t done = 0;
+    while (done < sizeInByte)
+    {
+        const uint32_t LEFT = sizeInByte - done;
+        const uint32_t LEN = LEFT < sizeof(chunk) ? LEFT : (uint32_t)sizeof(chunk);
+        if (pwrite(pFile->fd, chunk, LEN, (off_t)(addr + done)) != (ssize_t)LEN) return 0;
+        done += LEN;
+    }
+
+    return 1;
+}
+
+static uint8_t wearleveling_file_syncRange(wearleveling_file_typeDef * const pFile, const uint32_t addr, const uint32_t sizeInByte)
+{
+    if (pFile == NULL) return 0;
+    if (pFile->params.isSyncEveryWrite == 0) return 1;
+
+    /* msync wants a page aligned start */
+    const uint32_t PAGE_MASK = (uint32_t)sysconf(_SC_PAGESIZE) - 1;
+    const uint32_t START = addr & ~PAGE_MASK;
+    return msync((void *)(pFile->pMapped + START), (addr - START) + sizeInByte, MS_SYNC) == 0 ? 1 : 0;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "wearleveling.h"
+
+//
+// Flash emulated on top of a file or a raw block device (Linux/POSIX).
+// Reads come from a read only shared mapping, programs and erases go
+// through pwrite() so the device sees them in order. Programs follow NOR
+// rules: a bit can go from 1 to 0 only, anything else is rejected and the
+// file is left untouched. An erase fills one erase unit with 0xFF.
+//
+// The device spans sizeInByte bytes and is split into erase units of
+// eraseUnitInByte bytes; pageErase() erases the first one and
+// sectorErase(addr) the one at addr, so a ping-pong store can keep both
+// sectors in one file.
+//
+typedef struct
+{
+    uint32_t sizeInByte;
+    uint32_t eraseUnitInByte;
+    uint8_t isSyncEveryWrite;   /* msync() after each program/erase, for power loss tests on a real device */
+}wearleveling_file_params_typeDef;
+
+typedef struct
+{
+    wearleveling_file_params_typeDef params;
+    int fd;
+    const uint8_t * pMapped;
+    uint32_t numOfRejectedWrites;
+}wearleveling_file_typeDef;
+
+uint8_t wearleveling_file_open(wearleveling_file_typeDef * const pFile, const char * const pPath, const wearleveling_file_params_typeDef * const pParam);
+void wearleveling_file_close(wearleveling_file_typeDef * const pFile);
+uint8_t wearleveling_file_sync(wearleveling_file_typeDef * const pFile);
+uint16_t wearleveling_file_readTwoByte(wearleveling_file_typeDef * const pFile, uint32_t addr);
+uint8_t wearleveling_file_writeTwoByte(wearleveling_file_typeDef * const pFile, uint32_t addr, uint16_t data);
+uint8_t wearleveling_file_sectorErase(wearleveling_file_typeDef * const pFile, uint32_t addr);
+uint8_t wearleveling_file_pageErase(wearleveling_file_typeDef * const pFile);
+
+//
+// The store callbacks take no context, this defines the four of them for
+// one file object:
+//
+//   static wearleveling_file_typeDef settingsFile;
+//   WEARLEVELING_FILE_DEFINE_CALLBACKS(settings, &settingsFile)
+//   ... .readTwoByte = settings_readTwoByte, .pageErase = settings_pageErase ...
+//
+#define WEARLEVELING_FILE_DEFINE_CALLBACKS(prefix, pFile) \
+    __attribute__((unused)) static uint16_t prefix##_readTwoByte(uint32_t addr) { return wearleveling_file_readTwoByte((pFile), addr); } \
+    __attribute__((unused)) static uint8_t prefix##_writeTwoByte(uint32_t addr, uint16_t data) { return wearleveling_file_writeTwoByte((pFile), addr, data); } \
+    __attribute__((unused)) static uint8_t prefix##_pageErase(void) { return wearleveling_file_pageErase((pFile)); } \
+    __attribute__((unused)) static uint8_t prefix##_sectorErase(uint32_t addr) { return wearleveling_file_sectorErase((pFile), addr); }
+
+#ifdef __cplusplus
+}
+#endif
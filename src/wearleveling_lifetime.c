@@ -0,0 +1,153 @@
+#include <string.h>
+#include "wearleveling_lifetime.h"
+
+#define WEARLEVELING_LIFETIME_MILLI             (1000U)
+#define WEARLEVELING_LIFETIME_PERCENT           (100U)
+#define WEARLEVELING_LIFETIME_UNKNOWN           ((uint32_t)0xFFFFFFFF)
+
+static uint8_t wearleveling_lifetime_trackErases(wearleveling_lifetime_state_typeDef * const pState);
+static void wearleveling_lifetime_getErasesPerSave(wearleveling_lifetime_state_typeDef * const pState, uint32_t * const pNumOfErases, uint32_t * const pNumOfSaves);
+static uint32_t wearleveling_lifetime_saturate(const uint64_t value);
+
+wearleveling_lifetime_handle_typeDef
+wearleveling_lifetime_construct(wearleveling_lifetime_state_typeDef * const pState, wearleveling_handle_typeDef handle, const wearleveling_lifetime_params_typeDef * const pParam)
+{
+    if ((pState == NULL) || (handle == NULL) || (pParam == NULL)) return NULL;
+    if (pParam->getTimeInSecond == NULL) return NULL;
+
+    memset((void *)pState, 0, sizeof(wearleveling_lifetime_state_typeDef));
+    pState->params = *pParam;
+    pState->handle = handle;
+    pState->lastTime = pParam->getTimeInSecond();
+    pState->lastNumOfSaves = wearleveling_v2_getNumOfSaves(handle);
+    pState->firstNumOfSaves = pState->lastNumOfSaves;
+    /* the erases the store did at its own construct (format of a blank page) go to the counter on the first update */
+    pState->lastNumOfErases = 0;
+    pState->firstNumOfErases = wearleveling_v2_getNumOfErases(handle);
+    pState->eraseCount = pParam->eraseCounter != NULL ? wearleveling_counter_read(pParam->eraseCounter) : pParam->initialEraseCount;
+
+    return (wearleveling_lifetime_handle_typeDef)pState;
+}
+
+uint8_t wearleveling_lifetime_update(wearleveling_lifetime_handle_typeDef lifetime)
+{
+    if (lifetime == NULL) return 0;
+
+    const uint8_t IS_TRACKED = wearleveling_lifetime_trackErases(lifetime);
+
+    const uint32_t NOW = lifetime->params.getTimeInSecond();
+    const uint32_t ELAPSED = NOW - lifetime->lastTime;
+    if (ELAPSED == 0) return IS_TRACKED;
+
+    /* not the generation, a ping-pong store also bumps it on every compaction commit */
+    const uint32_t NUM_OF_SAVES = wearleveling_v2_getNumOfSaves(lifetime->handle);
+    const uint32_t SAMPLE = wearleveling_lifetime_saturate(((uint64_t)(NUM_OF_SAVES - lifetime->lastNumOfSaves) * WEARLEVELING_LIFETIME_MILLI) / ELAPSED);
+    lifetime->lastNumOfSaves = NUM_OF_SAVES;
+    lifetime->lastTime = NOW;
+
+    if (lifetime->hasSaveRate == 0)
+    {
+        lifetime->saveRateInMilliPerSecond = SAMPLE;
+        lifetime->hasSaveRate = 1;
+        return IS_TRACKED;
+    }
+
+    /* exponential moving average, done in 64 bits so a large shift cannot overflow */
+    const int64_t DELTA = (int64_t)SAMPLE - (int64_t)lifetime->saveRateInMilliPerSecond;
+    lifetime->saveRateInMilliPerSecond = (uint32_t)((int64_t)lifetime->saveRateInMilliPerSecond + (DELTA / ((int64_t)1 << lifetime->params.smoothingShift)));
+
+    return IS_TRACKED;
+}
+
+uint32_t wearleveling_lifetime_getEraseCount(wearleveling_lifetime_handle_typeDef lifetime)
+{
+    return lifetime == NULL ? 0 : lifetime->eraseCount;
+}
+
+uint32_t wearleveling_lifetime_getSaveRateInMilliPerSecond(wearleveling_lifetime_handle_typeDef lifetime)
+{
+    return lifetime == NULL ? 0 : lifetime->saveRateInMilliPerSecond;
+}
+
+uint32_t wearleveling_lifetime_getRemainingLifeInSecond(wearleveling_lifetime_handle_typeDef lifetime)
+{
+    if (lifetime == NULL) return 0;
+
+    /* a ping-pong store spreads its erases over two sectors */
+    const uint32_t NUM_OF_SECTORS = lifetime->handle->isPingPong ? 2U : 1U;
+    const uint32_t USED_CYCLES = (lifetime->eraseCount + NUM_OF_SECTORS - 1) / NUM_OF_SECTORS;
+    if (USED_CYCLES >= lifetime->params.ratedCycles) return 0;
+    if (lifetime->saveRateInMilliPerSecond == 0) return WEARLEVELING_LIFETIME_UNKNOWN;
+
+    uint32_t numOfErases = 0;
+    uint32_t numOfSaves = 0;
+    wearleveling_lifetime_getErasesPerSave(lifetime, &numOfErases, &numOfSaves);
+
+    /* remaining cycles / (save rate * erases per save / sectors) */
+    const uint64_t REMAINING_CYCLES = lifetime->params.ratedCycles - USED_CYCLES;
+    const uint64_t DIVIDEND = REMAINING_CYCLES * WEARLEVELING_LIFETIME_MILLI * numOfSaves * NUM_OF_SECTORS;
+    const uint64_t DIVISOR = (uint64_t)lifetime->saveRateInMilliPerSecond * numOfErases;
+
+    return wearleveling_lifetime_saturate(DIVIDEND / DIVISOR);
+}
+
+uint32_t wearleveling_lifetime_getWriteAmplificationInPercent(wearleveling_lifetime_handle_typeDef lifetime)
+{
+    if (lifetime == NULL) return 0;
+
+    uint32_t numOfErases = 0;
+    uint32_t numOfSaves = 0;
+    wearleveling_lifetime_getErasesPerSave(lifetime, &numOfErases, &numOfSaves);
+
+    /* bytes erased for every byte the caller saved */
+    const uint64_t ERASED_BYTES = (uint64_t)numOfErases * lifetime->handle->params.pageCapacityInByte;
+    const uint64_t SAVED_BYTES = (uint64_t)numOfSaves * lifetime->handle->params.dataSizeInByte;
+    if (SAVED_BYTES == 0) return 0;
+
+    return wearleveling_lifetime_saturate((ERASED_BYTES * WEARLEVELING_LIFETIME_PERCENT) / SAVED_BYTES);
+}
+
+static uint8_t wearleveling_lifetime_trackErases(wearleveling_lifetime_state_typeDef * const pState)
+{
+    if (pState == NULL) return 0;
+
+    const uint32_t NUM_OF_ERASES = wearleveling_v2_getNumOfErases(pState->handle);
+    while (pState->lastNumOfErases != NUM_OF_ERASES)
+    {
+        if (pState->params.eraseCounter != NULL)
+        {
+            if (wearleveling_counter_increment(pState->params.eraseCounter) == 0) return 0;
+        }
+        pState->lastNumOfErases++;
+        pState->eraseCount++;
+    }
+
+    return 1;
+}
+
+static void wearleveling_lifetime_getErasesPerSave(wearleveling_lifetime_state_typeDef * const pState, uint32_t * const pNumOfErases, uint32_t * const pNumOfSaves)
+{
+    if ((pState == NULL) || (pNumOfErases == NULL) || (pNumOfSaves == NULL)) return;
+
+    /* measured since construct, the page geometry stands in until the first erase */
+    *pNumOfErases = pState->lastNumOfErases > pState->firstNumOfErases ? (pState->lastNumOfErases - pState->firstNumOfErases) : 0U;
+    *pNumOfSaves = pState->lastNumOfSaves - pState->firstNumOfSaves;
+
+    if ((*pNumOfErases == 0) || (*pNumOfSaves == 0))
+    {
+        *pNumOfErases = 1;
+        *pNumOfSaves = pState->handle->numOfBuckets == 0 ? 1U : pState->handle->numOfBuckets;
+    }
+
+    /* keep the ratio, not the magnitude, so the 64-bit products above cannot overflow */
+    while (*pNumOfSaves > 0xFFFF)
+    {
+        *pNumOfSaves >>= 1;
+        *pNumOfErases = *pNumOfErases > 1 ? (*pNumOfErases >> 1) : 1U;
+    }
+}
+
+static uint32_t wearleveling_lifetime_saturate(const uint64_t value)
+{
+    return value > WEARLEVELING_LIFETIME_UNKNOWN ? WEARLEVELING_LIFETIME_UNKNOWN : (uint32_t)value;
+}
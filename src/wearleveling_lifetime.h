@@ -0,0 +1,59 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "wearleveling.h"
+#include "wearleveling_counter.h"
+
+//
+// Remaining life of a store, from the erases it has already done, the
+// rated erase cycles of the part and the save rate seen at run time.
+//
+// The erase count survives a reset when an erase counter (a thermometer
+// counter on its own page) is given, otherwise it starts at
+// initialEraseCount. The save rate is a moving average over the samples
+// taken by wearleveling_lifetime_update(), which is O(1) and only writes
+// to flash (one counter bit) when the store erased since the last call.
+//
+// Construct it right after the store, once per reset: every erase the
+// store did since its own construct, including the format of a blank
+// page, is added to the count by the first update.
+//
+typedef struct
+{
+    uint32_t ratedCycles;                               /* per sector, from the datasheet */
+    uint32_t (*getTimeInSecond) (void);
+    uint8_t smoothingShift;                             /* a new sample weighs 1/2^smoothingShift */
+    wearleveling_counter_handle_typeDef eraseCounter;   /* NULL to keep the count in RAM */
+    uint32_t initialEraseCount;
+}wearleveling_lifetime_params_typeDef;
+
+typedef struct
+{
+    wearleveling_lifetime_params_typeDef params;
+    wearleveling_handle_typeDef handle;
+    uint32_t eraseCount;
+    uint32_t lastTime;
+    uint32_t lastNumOfSaves;
+    uint32_t lastNumOfErases;
+    uint32_t firstNumOfSaves;
+    uint32_t firstNumOfErases;
+    uint32_t saveRateInMilliPerSecond;
+    uint8_t hasSaveRate;
+}wearleveling_lifetime_state_typeDef;
+
+typedef wearleveling_lifetime_state_typeDef* wearleveling_lifetime_handle_typeDef;
+
+wearleveling_lifetime_handle_typeDef wearleveling_lifetime_construct(wearleveling_lifetime_state_typeDef * const pState, wearleveling_handle_typeDef handle, const wearleveling_lifetime_params_typeDef * const pParam);
+uint8_t wearleveling_lifetime_update(wearleveling_lifetime_handle_typeDef lifetime);
+uint32_t wearleveling_lifetime_getEraseCount(wearleveling_lifetime_handle_typeDef lifetime);
+uint32_t wearleveling_lifetime_getSaveRateInMilliPerSecond(wearleveling_lifetime_handle_typeDef lifetime);
+uint32_t wearleveling_lifetime_getRemainingLifeInSecond(wearleveling_lifetime_handle_typeDef lifetime);
+uint32_t wearleveling_lifetime_getWriteAmplificationInPercent(wearleveling_lifetime_handle_typeDef lifetime);
+
+#ifdef __cplusplus
+}
+#endif
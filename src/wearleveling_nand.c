@@ -0,0 +1,271 @@
+#include <string.h>
+#include "wearleveling_nand.h"
+
+#define WEARLEVELING_NAND_FORMATED_FLAG         ((uint16_t)0x1357)
+#define WEARLEVELING_NAND_ADDR_FORMATED_FLAG    (0U)
+#define WEARLEVELING_NAND_ADDR_SEQUENCE         (2U)
+#define WEARLEVELING_NAND_ADDR_NUM_OF_RECORDS   (6U)
+#define WEARLEVELING_NAND_HEADER_SIZE           (8U)
+#define WEARLEVELING_NAND_ERASED_BYTE           ((uint8_t)0xFF)
+
+static uint8_t wearleveling_nand_readValidPage(wearleveling_nand_state_typeDef * const pState, const uint16_t block, const uint16_t page, uint32_t * const pSequence);
+static uint8_t wearleveling_nand_isErased(wearleveling_nand_state_typeDef * const pState);
+static void wearleveling_nand_findWritePosition(wearleveling_nand_state_typeDef * const pState, const uint16_t newestBlock);
+static uint8_t wearleveling_nand_advanceToGoodBlock(wearleveling_nand_state_typeDef * const pState);
+static void wearleveling_nand_retireBlock(wearleveling_nand_state_typeDef * const pState, const uint16_t block);
+static void wearleveling_nand_resetPageBuffer(wearleveling_nand_state_typeDef * const pState);
+static uint32_t wearleveling_nand_getFourByte(const uint8_t * const pData, const uint16_t offset);
+static void wearleveling_nand_putFourByte(uint8_t * const pData, const uint16_t offset, const uint32_t fourByte);
+
+wearleveling_nand_handle_typeDef
+wearleveling_nand_construct(wearleveling_nand_state_typeDef * const pState, const wearleveling_nand_params_typeDef * const pParam)
+{
+    if ((pState == NULL) || (pParam == NULL)) return NULL;
+    if ((pParam->programPage == NULL) || (pParam->readPage == NULL) || (pParam->eraseBlock == NULL)) return NULL;
+    if ((pParam->pPageBuffer == NULL) || (pParam->pBadBlockTable == NULL) || (pParam->pNewest == NULL)) return NULL;
+    if ((pParam->pagesPerBlock == 0) || (pParam->numOfBlocks < 2) || (pParam->dataSizeInByte == 0)) return NULL;
+    if ((pParam->eccSizeInByte != 0) && ((pParam->eccEncode == NULL) || (pParam->eccCorrect == NULL))) return NULL;
+    if (pParam->pageSizeInByte < (WEARLEVELING_NAND_HEADER_SIZE + pParam->eccSizeInByte + pParam->dataSizeInByte)) return NULL;
+
+    memset((void *)pState, 0, sizeof(wearleveling_nand_state_typeDef));
+    pState->params = *pParam;
+    pState->recordsPerPage = (uint16_t)((pParam->pageSizeInByte - WEARLEVELING_NAND_HEADER_SIZE - pParam->eccSizeInByte) / pParam->dataSizeInByte);
+
+    memset(pParam->pBadBlockTable, 0, (pParam->numOfBlocks + 7U) / 8U);
+    for(uint16_t i = 0; i < pParam->numOfBlocks; i++)
+    {
+        if ((pParam->isBadBlock != NULL) && pParam->isBadBlock(i))
+        {
+            pParam->pBadBlockTable[i >> 3] |= (uint8_t)(1U << (i & 7U));
+            pState->numOfBadBlocks++;
+        }
+    }
+
+    /* the block opened last has the newest first page */
+    uint16_t newestBlock = 0;
+    for(uint16_t i = 0; i < pParam->numOfBlocks; i++)
+    {
+        uint32_t sequence = 0;
+        if (wearleveling_nand_isBadBlock(pState, i)) continue;
+        if (wearleveling_nand_readValidPage(pState, i, 0, &sequence) == 0) continue;
+        if (pState->hasRecord && ((int32_t)(sequence - pState->sequence) <= 0)) continue;
+
+        newestBlock = i;
+        pState->sequence = sequence;
+        pState->hasRecord = 1;
+    }
+
+    if (pState->hasRecord == 0)
+    {
+        pState->writeBlock = pParam->numOfBlocks - 1;
+        pState->writePage = pParam->pagesPerBlock;
+    }
+    else
+    {
+        wearleveling_nand_findWritePosition(pState, newestBlock);
+    }
+
+    wearleveling_nand_resetPageBuffer(pState);
+    return (wearleveling_nand_handle_typeDef)pState;
+}
+
+uint8_t wearleveling_nand_save(wearleveling_nand_handle_typeDef nand, const uint8_t * const pData)
+{
+    if ((nand == NULL) || (pData == NULL)) return 0;
+
+    /* a full buffer could not be programmed last time, try that one first */
+    if (nand->numOfPending >= nand->recordsPerPage)
+    {
+        if (wearleveling_nand_flush(nand) == 0) return 0;
+    }
+
+    const uint16_t OFFSET = (uint16_t)(WEARLEVELING_NAND_HEADER_SIZE + (nand->numOfPending * nand->params.dataSizeInByte));
+    memcpy(nand->params.pPageBuffer + OFFSET, pData, nand->params.dataSizeInByte);
+    memcpy(nand->params.pNewest, pData, nand->params.dataSizeInByte);
+    nand->numOfPending++;
+    nand->hasRecord = 1;
+
+    if (nand->numOfPending < nand->recordsPerPage) return 1;
+    return wearleveling_nand_flush(nand);
+}
+
+uint8_t wearleveling_nand_read(wearleveling_nand_handle_typeDef nand, uint8_t * const pData)
+{
+    if ((nand == NULL) || (pData == NULL)) return 0;
+    if (nand->hasRecord == 0) return 0;
+
+    memcpy(pData, nand->params.pNewest, nand->params.dataSizeInByte);
+    return 1;
+}
+
+uint8_t wearleveling_nand_flush(wearleveling_nand_handle_typeDef nand)
+{
+    if (nand == NULL) return 0;
+    if (nand->numOfPending == 0) return 1;
+
+    uint8_t * const pPage = nand->params.pPageBuffer;
+    const uint16_t ECC_OFFSET = (uint16_t)(nand->params.pageSizeInByte - nand->params.eccSizeInByte);
+
+    pPage[WEARLEVELING_NAND_ADDR_FORMATED_FLAG] = (uint8_t)WEARLEVELING_NAND_FORMATED_FLAG;
+    pPage[WEARLEVELING_NAND_ADDR_FORMATED_FLAG + 1] = (uint8_t)(WEARLEVELING_NAND_FORMATED_FLAG >> 8);
+    wearleveling_nand_putFourByte(pPage, WEARLEVELING_NAND_ADDR_SEQUENCE, nand->sequence + 1);
+    pPage[WEARLEVELING_NAND_ADDR_NUM_OF_RECORDS] = (uint8_t)nand->numOfPending;
+    pPage[WEARLEVELING_NAND_ADDR_NUM_OF_RECORDS + 1] = (uint8_t)(nand->numOfPending >> 8);
+
+    if (nand->params.eccSizeInByte != 0)
+    {
+        if (nand->params.eccEncode(pPage, ECC_OFFSET, pPage + ECC_OFFSET) == 0) return 0;
+    }
+
+    /* every good block gets one try, a failing one is retired and the page goes to the next */
+    for(uint16_t i = 0; i < nand->params.numOfBlocks; i++)
+    {
+        if (nand->writePage >= nand->params.pagesPerBlock)
+        {
+            if (wearleveling_nand_advanceToGoodBlock(nand) == 0) return 0;
+        }
+
+        const uint32_t PAGE_ADDR = ((uint32_t)nand->writeBlock * nand->params.pagesPerBlock) + nand->writePage;
+        if (nand->params.programPage(PAGE_ADDR, pPage))
+        {
+            nand->writePage++;
+            nand->sequence++;
+            wearleveling_nand_resetPageBuffer(nand);
+            return 1;
+        }
+
+        wearleveling_nand_retireBlock(nand, nand->writeBlock);
+        nand->writePage = nand->params.pagesPerBlock;
+    }
+
+    return 0;
+}
+
+uint8_t wearleveling_nand_isBadBlock(wearleveling_nand_handle_typeDef nand, const uint16_t block)
+{
+    if (nand == NULL) return 0;
+    if (block >= nand->params.numOfBlocks) return 1;
+    return (nand->params.pBadBlockTable[block >> 3] >> (block & 7U)) & 1U;
+}
+
+uint16_t wearleveling_nand_getNumOfBadBlocks(wearleveling_nand_handle_typeDef nand)
+{
+    return nand == NULL ? 0 : nand->numOfBadBlocks;
+}
+
+uint16_t wearleveling_nand_getRecordsPerPage(wearleveling_nand_handle_typeDef nand)
+{
+    return nand == NULL ? 0 : nand->recordsPerPage;
+}
+
+static uint8_t wearleveling_nand_readValidPage(wearleveling_nand_state_typeDef * const pState, const uint16_t block, const uint16_t page, uint32_t * const pSequence)
+{
+    uint8_t * const pPage = pState->params.pPageBuffer;
+    const uint16_t ECC_OFFSET = (uint16_t)(pState->params.pageSizeInByte - pState->params.eccSizeInByte);
+    const uint32_t PAGE_ADDR = ((uint32_t)block * pState->params.pagesPerBlock) + page;
+
+    if (pState->params.readPage(PAGE_ADDR, pPage) == 0) return 0;
+    if (wearleveling_nand_isErased(pState)) return 0;
+
+    if (pState->params.eccSizeInByte != 0)
+    {
+        if (pState->params.eccCorrect(pPage, ECC_OFFSET, pPage + ECC_OFFSET) == 0) return 0;
+    }
+
+    const uint16_t FLAG = (uint16_t)(pPage[WEARLEVELING_NAND_ADDR_FORMATED_FLAG] | (pPage[WEARLEVELING_NAND_ADDR_FORMATED_FLAG + 1] << 8));
+    const uint16_t NUM_OF_RECORDS = (uint16_t)(pPage[WEARLEVELING_NAND_ADDR_NUM_OF_RECORDS] | (pPage[WEARLEVELING_NAND_ADDR_NUM_OF_RECORDS + 1] << 8));
+    if (FLAG != WEARLEVELING_NAND_FORMATED_FLAG) return 0;
+    if ((NUM_OF_RECORDS == 0) || (NUM_OF_RECORDS > pState->recordsPerPage)) return 0;
+
+    *pSequence = wearleveling_nand_getFourByte(pPage, WEARLEVELING_NAND_ADDR_SEQUENCE);
+    return 1;
+}
+
+static uint8_t wearleveling_nand_isErased(wearleveling_nand_state_typeDef * const pState)
+{
+    for(uint16_t i = 0; i < pState->params.pageSizeInByte; i++)
+    {
+        if (pState->params.pPageBuffer[i] != WEARLEVELING_NAND_ERASED_BYTE) return 0;
+    }
+
+    return 1;
+}
+
+static void wearleveling_nand_findWritePosition(wearleveling_nand_state_typeDef * const pState, const uint16_t newestBlock)
+{
+    pState->writeBlock = newestBlock;
+    pState->writePage = pState->params.pagesPerBlock;
+
+    /* pages go out in order: the newest valid one holds the newest record, the first erased one is next */
+    for(uint16_t page = 0; page < pState->params.pagesPerBlock; page++)
+    {
+        uint32_t sequence = 0;
+        if (wearleveling_nand_readValidPage(pState, newestBlock, page, &sequence))
+        {
+            const uint16_t NUM_OF_RECORDS = (uint16_t)(pState->params.pPageBuffer[WEARLEVELING_NAND_ADDR_NUM_OF_RECORDS] |
+                (pState->params.pPageBuffer[WEARLEVELING_NAND_ADDR_NUM_OF_RECORDS + 1] << 8));
+            const uint16_t OFFSET = (uint16_t)(WEARLEVELING_NAND_HEADER_SIZE + ((NUM_OF_RECORDS - 1) * pState->params.dataSizeInByte));
+            memcpy(pState->params.pNewest, pState->params.pPageBuffer + OFFSET, pState->params.dataSizeInByte);
+            pState->sequence = sequence;
+            continue;
+        }
+
+        /* a torn or unreadable page is never programmed again, only an erased one is */
+        if (wearleveling_nand_isErased(pState))
+        {
+            pState->writePage = page;
+            return;
+        }
+    }
+}
+
+static uint8_t wearleveling_nand_advanceToGoodBlock(wearleveling_nand_state_typeDef * const pState)
+{
+    const uint16_t CURRENT_BLOCK = pState->writeBlock;
+
+    /* the current block keeps the newest page, it is never the one erased here */
+    for(uint16_t i = 1; i < pState->params.numOfBlocks; i++)
+    {
+        const uint16_t BLOCK = (uint16_t)((CURRENT_BLOCK + i) % pState->params.numOfBlocks);
+        if (wearleveling_nand_isBadBlock(pState, BLOCK)) continue;
+        if (pState->params.eraseBlock(BLOCK) == 0)
+        {
+            wearleveling_nand_retireBlock(pState, BLOCK);
+            continue;
+        }
+
+        pState->writeBlock = BLOCK;
+        pState->writePage = 0;
+        return 1;
+    }
+
+    return 0;
+}
+
+static void wearleveling_nand_retireBlock(wearleveling_nand_state_typeDef * const pState, const uint16_t block)
+{
+    if (wearleveling_nand_isBadBlock(pState, block)) return;
+
+    pState->params.pBadBlockTable[block >> 3] |= (uint8_t)(1U << (block & 7U));
+    pState->numOfBadBlocks++;
+    if (pState->params.markBadBlock != NULL) pState->params.markBadBlock(block);
+}
+
+static void wearleveling_nand_resetPageBuffer(wearleveling_nand_state_typeDef * const pState)
+{
+    memset(pState->params.pPageBuffer, WEARLEVELING_NAND_ERASED_BYTE, pState->params.pageSizeInByte);
+    pState->numOfPending = 0;
+}
+
+static uint32_t wearleveling_nand_getFourByte(const uint8_t * const pData, const uint16_t offset)
+{
+    return (uint32_t)pData[offset] | ((uint32_t)pData[offset + 1] << 8) | ((uint32_t)pData[offset + 2] << 16) | ((uint32_t)pData[offset + 3] << 24);
+}
+
+static void wearleveling_nand_putFourByte(uint8_t * const pData, const uint16_t offset, const uint32_t fourByte)
+{
+    pData[offset] = (uint8_t)fourByte;
+    pData[offset + 1] = (uint8_t)(fourByte >> 8);
+    pData[offset + 2] = (uint8_t)(fourByte >> 16);
+    pData[offset + 3] = (uint8_t)(fourByte >> 24);
+}
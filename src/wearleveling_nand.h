@@ -0,0 +1,71 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "wearleveling.h"
+
+//
+// Record store for NAND (SPI-NAND and the like): whole page programs, each
+// page programmed once per erase, blocks going bad. Records are collected
+// in a RAM page buffer and programmed together, a full buffer goes out by
+// itself, wearleveling_nand_flush() sends a partial one:
+//
+//   nand page: [formated flag][sequence 4 bytes][num of records][record 0][record 1] ... [ecc]
+//
+// Pages are written in order through the blocks, a block is erased when the
+// log enters it; blocks in the bad block table are skipped, and a block
+// whose program or erase fails is added to it (and reported through
+// markBadBlock). The newest page is found again at construct from the page
+// sequence; a page failing its ECC check is skipped. Records still in the
+// RAM buffer are lost on a reset.
+//
+// The ECC hooks cover everything in front of the last eccSizeInByte bytes
+// of the page; leave them NULL for parts with on-die ECC.
+//
+typedef struct
+{
+    uint16_t pageSizeInByte;
+    uint16_t pagesPerBlock;
+    uint16_t numOfBlocks;
+    uint16_t dataSizeInByte;
+    uint16_t eccSizeInByte;
+    uint8_t (*programPage) (uint32_t pageAddr, const uint8_t * pData);     /* pageAddr = block * pagesPerBlock + page */
+    uint8_t (*readPage) (uint32_t pageAddr, uint8_t * pData);
+    uint8_t (*eraseBlock) (uint16_t block);
+    uint8_t (*isBadBlock) (uint16_t block);                                 /* factory marker, NULL if none */
+    uint8_t (*markBadBlock) (uint16_t block);                               /* NULL if none */
+    uint8_t (*eccEncode) (const uint8_t * pData, uint16_t len, uint8_t * pEcc);
+    uint8_t (*eccCorrect) (uint8_t * pData, uint16_t len, const uint8_t * pEcc);   /* 0 when uncorrectable */
+    uint8_t * pPageBuffer;                                                  /* pageSizeInByte bytes */
+    uint8_t * pBadBlockTable;                                               /* (numOfBlocks + 7) / 8 bytes */
+    uint8_t * pNewest;                                                      /* dataSizeInByte bytes */
+}wearleveling_nand_params_typeDef;
+
+typedef struct
+{
+    wearleveling_nand_params_typeDef params;
+    uint32_t sequence;
+    uint16_t recordsPerPage;
+    uint16_t numOfPending;
+    uint16_t writeBlock;
+    uint16_t writePage;
+    uint16_t numOfBadBlocks;
+    uint8_t hasRecord;
+}wearleveling_nand_state_typeDef;
+
+typedef wearleveling_nand_state_typeDef* wearleveling_nand_handle_typeDef;
+
+wearleveling_nand_handle_typeDef wearleveling_nand_construct(wearleveling_nand_state_typeDef * const pState, const wearleveling_nand_params_typeDef * const pParam);
+uint8_t wearleveling_nand_save(wearleveling_nand_handle_typeDef nand, const uint8_t * const pData);
+uint8_t wearleveling_nand_read(wearleveling_nand_handle_typeDef nand, uint8_t * const pData);
+uint8_t wearleveling_nand_flush(wearleveling_nand_handle_typeDef nand);
+uint8_t wearleveling_nand_isBadBlock(wearleveling_nand_handle_typeDef nand, const uint16_t block);
+uint16_t wearleveling_nand_getNumOfBadBlocks(wearleveling_nand_handle_typeDef nand);
+uint16_t wearleveling_nand_getRecordsPerPage(wearleveling_nand_handle_typeDef nand);
+
+#ifdef __cplusplus
+}
+#endif
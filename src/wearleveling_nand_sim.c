@@ -0,0 +1,158 @@
+#include <string.h>
+#include "wearleveling_nand_sim.h"
+
+#define WEARLEVELING_NAND_SIM_PROGRAMMED        ((uint8_t)0x01)
+
+static uint32_t wearleveling_nand_sim_getPageOffset(wearleveling_nand_sim_typeDef * const pSim, const uint32_t pageAddr);
+static uint32_t wearleveling_nand_sim_getNumOfPages(wearleveling_nand_sim_typeDef * const pSim);
+static void wearleveling_nand_sim_calculateEcc(const uint8_t * pData, uint16_t len, uint32_t * const pSyndrome, uint8_t * const pParity);
+
+void wearleveling_nand_sim_init(wearleveling_nand_sim_typeDef * const pSim)
+{
+    if (pSim == NULL) return;
+
+    /* fresh part: all erased, no block bad */
+    memset(pSim->pMemory, 0xFF, wearleveling_nand_sim_getNumOfPages(pSim) * pSim->pageSizeInByte);
+    memset(pSim->pPageFlags, 0, wearleveling_nand_sim_getNumOfPages(pSim));
+    memset(pSim->pBlockFlags, 0, pSim->numOfBlocks);
+    pSim->numOfPrograms = 0;
+    pSim->numOfErases = 0;
+    pSim->numOfReprograms = 0;
+}
+
+uint8_t wearleveling_nand_sim_programPage(wearleveling_nand_sim_typeDef * const pSim, uint32_t pageAddr, const uint8_t * pData)
+{
+    if ((pSim == NULL) || (pData == NULL)) return 0;
+    if (pageAddr >= wearleveling_nand_sim_getNumOfPages(pSim)) return 0;
+
+    const uint16_t BLOCK = (uint16_t)(pageAddr / pSim->pagesPerBlock);
+    if (pSim->pBlockFlags[BLOCK] & WEARLEVELING_NAND_SIM_FAILING) return 0;
+
+    if (pSim->pPageFlags[pageAddr] & WEARLEVELING_NAND_SIM_PROGRAMMED)
+    {
+        pSim->numOfReprograms++;
+        return 0;
+    }
+
+    memcpy(pSim->pMemory + wearleveling_nand_sim_getPageOffset(pSim, pageAddr), pData, pSim->pageSizeInByte);
+    pSim->pPageFlags[pageAddr] |= WEARLEVELING_NAND_SIM_PROGRAMMED;
+    pSim->numOfPrograms++;
+    return 1;
+}
+
+uint8_t wearleveling_nand_sim_readPage(wearleveling_nand_sim_typeDef * const pSim, uint32_t pageAddr, uint8_t * pData)
+{
+    if ((pSim == NULL) || (pData == NULL)) return 0;
+    if (pageAddr >= wearleveling_nand_sim_getNumOfPages(pSim)) return 0;
+
+    memcpy(pData, pSim->pMemory + wearleveling_nand_sim_getPageOffset(pSim, pageAddr), pSim->pageSizeInByte);
+    return 1;
+}
+
+uint8_t wearleveling_nand_sim_eraseBlock(wearleveling_nand_sim_typeDef * const pSim, uint16_t block)
+{
+    if (pSim == NULL) return 0;
+    if (block >= pSim->numOfBlocks) return 0;
+    if (pSim->pBlockFlags[block] & WEARLEVELING_NAND_SIM_FAILING) return 0;
+
+    const uint32_t FIRST_PAGE = (uint32_t)block * pSim->pagesPerBlock;
+    memset(pSim->pMemory + wearleveling_nand_sim_getPageOffset(pSim, FIRST_PAGE), 0xFF, (uint32_t)pSim->pagesPerBlock * pSim->pageSizeInByte);
+    memset(pSim->pPageFlags + FIRST_PAGE, 0, pSim->pagesPerBlock);
+    pSim->numOfErases++;
+    return 1;
+}
+
+uint8_t wearleveling_nand_sim_isBadBlock(wearleveling_nand_sim_typeDef * const pSim, uint16_t block)
+{
+    if (pSim == NULL) return 1;
+    if (block >= pSim->numOfBlocks) return 1;
+    return (pSim->pBlockFlags[block] & (WEARLEVELING_NAND_SIM_FACTORY_BAD | WEARLEVELING_NAND_SIM_MARKED_BAD)) ? 1 : 0;
+}
+
+uint8_t wearleveling_nand_sim_markBadBlock(wearleveling_nand_sim_typeDef * const pSim, uint16_t block)
+{
+    if (pSim == NULL) return 0;
+    if (block >= pSim->numOfBlocks) return 0;
+
+    pSim->pBlockFlags[block] |= WEARLEVELING_NAND_SIM_MARKED_BAD;
+    return 1;
+}
+
+void wearleveling_nand_sim_flipBit(wearleveling_nand_sim_typeDef * const pSim, uint32_t pageAddr, uint32_t bitIndex)
+{
+    if (pSim == NULL) return;
+    if (pageAddr >= wearleveling_nand_sim_getNumOfPages(pSim)) return;
+    if (bitIndex >= ((uint32_t)pSim->pageSizeInByte * 8U)) return;
+
+    pSim->pMemory[wearleveling_nand_sim_getPageOffset(pSim, pageAddr) + (bitIndex >> 3)] ^= (uint8_t)(1U << (bitIndex & 7U));
+}
+
+uint8_t wearleveling_nand_sim_eccEncode(const uint8_t * pData, uint16_t len, uint8_t * pEcc)
+{
+    if ((pData == NULL) || (pEcc == NULL)) return 0;
+
+    uint32_t syndrome = 0;
+    uint8_t parity = 0;
+    wearleveling_nand_sim_calculateEcc(pData, len, &syndrome, &parity);
+
+    pEcc[0] = (uint8_t)syndrome;
+    pEcc[1] = (uint8_t)(syndrome >> 8);
+    pEcc[2] = (uint8_t)(syndrome >> 16);
+    pEcc[3] = (uint8_t)(syndrome >> 24);
+    pEcc[4] = parity;
+    pEcc[5] = (uint8_t)~parity;
+    return 1;
+}
+
+uint8_t wearleveling_nand_sim_eccCorrect(uint8_t * pData, uint16_t len, const uint8_t * pEcc)
+{
+    if ((pData == NULL) || (pEcc == NULL)) return 0;
+
+    /* parity and its complement, a flip in the ECC bytes themselves is not corrected */
+    if ((uint8_t)(pEcc[4] ^ pEcc[5]) != 0xFF) return 0;
+
+    uint32_t syndrome = 0;
+    uint8_t parity = 0;
+    wearleveling_nand_sim_calculateEcc(pData, len, &syndrome, &parity);
+
+    const uint32_t STORED = (uint32_t)pEcc[0] | ((uint32_t)pEcc[1] << 8) | ((uint32_t)pEcc[2] << 16) | ((uint32_t)pEcc[3] << 24);
+    const uint32_t DIFFERENCE = syndrome ^ STORED;
+    if ((DIFFERENCE == 0) && (parity == pEcc[4])) return 1;
+
+    /* one flipped bit: parity differs and the positions point at it (1 based) */
+    if ((parity == pEcc[4]) || (DIFFERENCE == 0) || (DIFFERENCE > ((uint32_t)len * 8U))) return 0;
+
+    const uint32_t BIT_INDEX = DIFFERENCE - 1;
+    pData[BIT_INDEX >> 3] ^= (uint8_t)(1U << (BIT_INDEX & 7U));
+    return 1;
+}
+
+static uint32_t wearleveling_nand_sim_getPageOffset(wearleveling_nand_sim_typeDef * const pSim, const uint32_t pageAddr)
+{
+    return pageAddr * pSim->pageSizeInByte;
+}
+
+static uint32_t wearleveling_nand_sim_getNumOfPages(wearleveling_nand_sim_typeDef * const pSim)
+{
+    return (uint32_t)pSim->numOfBlocks * pSim->pagesPerBlock;
+}
+
+static void wearleveling_nand_sim_calculateEcc(const uint8_t * pData, uint16_t len, uint32_t * const pSyndrome, uint8_t * const pParity)
+{
+    uint32_t syndrome = 0;
+    uint8_t parity = 0;
+
+    for(uint32_t i = 0; i < len; i++)
+    {
+        uint8_t byte = pData[i];
+        for(uint32_t bit = 0; byte != 0; bit++, byte >>= 1)
+        {
+            if ((byte & 1U) == 0) continue;
+            syndrome ^= (i * 8U) + bit + 1U;
+            parity ^= 1U;
+        }
+    }
+
+    *pSyndrome = syndrome;
+    *pParity = parity;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+//
+// NAND simulator for host tests of the NAND store. Memory is a caller
+// buffer of numOfBlocks * pagesPerBlock * pageSizeInByte bytes; a page can
+// be programmed once per erase, a second program is refused and counted.
+// Blocks can be marked bad from the factory or set to fail their next
+// program/erase, and single bits can be flipped to exercise the ECC.
+//
+// wearleveling_nand_sim_eccEncode/eccCorrect are a small ECC for it:
+// the XOR of the positions of all set bits plus a parity bit, which
+// corrects one flipped bit and detects two.
+//
+#define WEARLEVELING_NAND_SIM_ECC_SIZE          (6U)
+#define WEARLEVELING_NAND_SIM_FACTORY_BAD       ((uint8_t)0x01)
+#define WEARLEVELING_NAND_SIM_FAILING           ((uint8_t)0x02)
+#define WEARLEVELING_NAND_SIM_MARKED_BAD        ((uint8_t)0x04)
+
+typedef struct
+{
+    uint16_t pageSizeInByte;
+    uint16_t pagesPerBlock;
+    uint16_t numOfBlocks;
+    uint8_t * pMemory;
+    uint8_t * pPageFlags;           /* one byte per page */
+    uint8_t * pBlockFlags;          /* one byte per block */
+    uint32_t numOfPrograms;
+    uint32_t numOfErases;
+    uint32_t numOfReprograms;
+}wearleveling_nand_sim_typeDef;
+
+void wearleveling_nand_sim_init(wearleveling_nand_sim_typeDef * const pSim);
+uint8_t wearleveling_nand_sim_programPage(wearleveling_nand_sim_typeDef * const pSim, uint32_t pageAddr, const uint8_t * pData);
+uint8_t wearleveling_nand_sim_readPage(wearleveling_nand_sim_typeDef * const pSim, uint32_t pageAddr, uint8_t * pData);
+uint8_t wearleveling_nand_sim_eraseBlock(wearleveling_nand_sim_typeDef * const pSim, uint16_t block);
+uint8_t wearleveling_nand_sim_isBadBlock(wearleveling_nand_sim_typeDef * const pSim, uint16_t block);
+uint8_t wearleveling_nand_sim_markBadBlock(wearleveling_nand_sim_typeDef * const pSim, uint16_t block);
+void wearleveling_nand_sim_flipBit(wearleveling_nand_sim_typeDef * const pSim, uint32_t pageAddr, uint32_t bitIndex);
+uint8_t wearleveling_nand_sim_eccEncode(const uint8_t * pData, uint16_t len, uint8_t * pEcc);
+uint8_t wearleveling_nand_sim_eccCorrect(uint8_t * pData, uint16_t len, const uint8_t * pEcc);
+
+//
+// The NAND callbacks take no context, this defines them for one simulator:
+//
+//   static wearleveling_nand_sim_typeDef sim;
+//   WEARLEVELING_NAND_SIM_DEFINE_CALLBACKS(sim, &sim)
+//   ... .programPage = sim_programPage, .eraseBlock = sim_eraseBlock ...
+//
+#define WEARLEVELING_NAND_SIM_DEFINE_CALLBACKS(prefix, pSim) \
+    __attribute__((unused)) static uint8_t prefix##_programPage(uint32_t pageAddr, const uint8_t * pData) { return wearleveling_nand_sim_programPage((pSim), pageAddr, pData); } \
+    __attribute__((unused)) static uint8_t prefix##_readPage(uint32_t pageAddr, uint8_t * pData) { return wearleveling_nand_sim_readPage((pSim), pageAddr, pData); } \
+    __attribute__((unused)) static uint8_t prefix##_eraseBlock(uint16_t block) { return wearleveling_nand_sim_eraseBlock((pSim), block); } \
+    __attribute__((unused)) static uint8_t prefix##_isBadBlock(uint16_t block) { return wearleveling_nand_sim_isBadBlock((pSim), block); } \
+    __attribute__((unused)) static uint8_t prefix##_markBadBlock(uint16_t block) { return wearleveling_nand_sim_markBadBlock((pSim), block); }
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,194 @@
+#include <string.h>
+#include "wearleveling_scheduler.h"
+
+static void wearleveling_scheduler_updateQueue(wearleveling_scheduler_state_typeDef * const pState, const uint32_t now);
+static uint8_t wearleveling_scheduler_isAboveThreshold(wearleveling_scheduler_state_typeDef * const pState, wearleveling_handle_typeDef handle);
+static uint8_t wearleveling_scheduler_hasWork(wearleveling_scheduler_state_typeDef * const pState, wearleveling_handle_typeDef handle);
+static uint8_t wearleveling_scheduler_doWork(wearleveling_scheduler_state_typeDef * const pState, wearleveling_handle_typeDef handle);
+static uint8_t wearleveling_scheduler_isEraseAllowed(wearleveling_scheduler_state_typeDef * const pState, const uint32_t now);
+static wearleveling_scheduler_entry_typeDef * wearleveling_scheduler_pickEntry(wearleveling_scheduler_state_typeDef * const pState);
+
+wearleveling_scheduler_handle_typeDef
+wearleveling_scheduler_construct(wearleveling_scheduler_state_typeDef * const pState, wearleveling_scheduler_params_typeDef * const pParam, wearleveling_scheduler_entry_typeDef * const pEntries, const uint16_t capacity)
+{
+    if ((pState == NULL) || (pParam == NULL) || (pEntries == NULL)) return NULL;
+    if (pParam->pScratch == NULL) return NULL;
+
+    memset((void *)pState, 0, sizeof(wearleveling_scheduler_state_typeDef));
+    memset((void *)pEntries, 0, sizeof(wearleveling_scheduler_entry_typeDef) * capacity);
+    pState->params = *pParam;
+    pState->pEntries = pEntries;
+    pState->capacity = capacity;
+
+    return (wearleveling_scheduler_handle_typeDef)pState;
+}
+
+uint8_t wearleveling_scheduler_register(wearleveling_scheduler_handle_typeDef scheduler, wearleveling_handle_typeDef handle)
+{
+    if ((scheduler == NULL) || (handle == NULL)) return 0;
+    if (scheduler->numOfEntries >= scheduler->capacity) return 0;
+    if (handle->params.dataSizeInByte > scheduler->params.scratchSizeInByte) return 0;
+
+    wearleveling_scheduler_entry_typeDef * const pEntry = &scheduler->pEntries[scheduler->numOfEntries];
+    pEntry->handle = handle;
+    pEntry->enqueueTime = 0;
+    pEntry->isQueued = 0;
+    scheduler->numOfEntries++;
+
+    return 1;
+}
+
+uint8_t wearleveling_scheduler_run(wearleveling_scheduler_handle_typeDef scheduler, const uint32_t now, const uint8_t isBusIdle)
+{
+    if (scheduler == NULL) return 0;
+
+    wearleveling_scheduler_updateQueue(scheduler, now);
+
+    if (isBusIdle == 0) return 0;
+    if (wearleveling_scheduler_isEraseAllowed(scheduler, now) == 0) return 0;
+
+    wearleveling_scheduler_entry_typeDef * const pEntry = wearleveling_scheduler_pickEntry(scheduler);
+    if (pEntry == NULL) return 0;
+
+    const uint32_t NUM_OF_ERASES = wearleveling_v2_getNumOfErases(pEntry->handle);
+    if (wearleveling_scheduler_doWork(scheduler, pEntry->handle) == 0) return 0;
+
+    /* a compaction that took more than one slice stays queued and keeps its first enqueue time */
+    if (wearleveling_scheduler_hasWork(scheduler, pEntry->handle) == 0)
+    {
+        const uint32_t WAIT = now - pEntry->enqueueTime;
+        if (WAIT > scheduler->worstCaseWait) scheduler->worstCaseWait = WAIT;
+
+        pEntry->isQueued = 0;
+        scheduler->queueDepth--;
+    }
+
+    if (wearleveling_v2_getNumOfErases(pEntry->handle) != NUM_OF_ERASES)
+    {
+        scheduler->lastEraseTime = now;
+        scheduler->numOfErases++;
+    }
+
+    return 1;
+}
+
+uint16_t wearleveling_scheduler_getQueueDepth(wearleveling_scheduler_handle_typeDef scheduler)
+{
+    return scheduler == NULL ? 0 : scheduler->queueDepth;
+}
+
+uint16_t wearleveling_scheduler_getMaxQueueDepth(wearleveling_scheduler_handle_typeDef scheduler)
+{
+    return scheduler == NULL ? 0 : scheduler->maxQueueDepth;
+}
+
+uint32_t wearleveling_scheduler_getWorstCaseWait(wearleveling_scheduler_handle_typeDef scheduler)
+{
+    return scheduler == NULL ? 0 : scheduler->worstCaseWait;
+}
+
+uint32_t wearleveling_scheduler_getNumOfErases(wearleveling_scheduler_handle_typeDef scheduler)
+{
+    return scheduler == NULL ? 0 : scheduler->numOfErases;
+}
+
+static void wearleveling_scheduler_updateQueue(wearleveling_scheduler_state_typeDef * const pState, const uint32_t now)
+{
+    if (pState == NULL) return;
+
+    for(uint16_t i = 0; i < pState->numOfEntries; i++)
+    {
+        wearleveling_scheduler_entry_typeDef * const pEntry = &pState->pEntries[i];
+        const uint8_t HAS_WORK = wearleveling_scheduler_hasWork(pState, pEntry->handle);
+
+        if ((pEntry->isQueued == 0) && HAS_WORK)
+        {
+            pEntry->isQueued = 1;
+            pEntry->enqueueTime = now;
+            pState->queueDepth++;
+        }
+        else if (pEntry->isQueued && (HAS_WORK == 0))
+        {
+            /* a foreground save already did the work */
+            pEntry->isQueued = 0;
+            pState->queueDepth--;
+        }
+    }
+
+    if (pState->queueDepth > pState->maxQueueDepth) pState->maxQueueDepth = pState->queueDepth;
+}
+
+static uint8_t wearleveling_scheduler_isAboveThreshold(wearleveling_scheduler_state_typeDef * const pState, wearleveling_handle_typeDef handle)
+{
+    if ((pState == NULL) || (handle == NULL)) return 0;
+    if (handle->numOfBuckets == 0) return 0;
+
+    /* a page holding only the record written right after a roll over gains nothing from another one */
+    const uint32_t USED = handle->numOfBuckets - wearleveling_v2_getNumOfFreeBuckets(handle);
+    if (USED <= 1) return 0;
+
+    return (USED * 100) >= ((uint32_t)pState->params.fillThresholdInPercent * handle->numOfBuckets) ? 1 : 0;
+}
+
+static uint8_t wearleveling_scheduler_hasWork(wearleveling_scheduler_state_typeDef * const pState, wearleveling_handle_typeDef handle)
+{
+    if ((pState == NULL) || (handle == NULL)) return 0;
+
+    const uint8_t IS_FULL = wearleveling_v2_getNumOfFreeBuckets(handle) == 0 ? 1 : 0;
+    if (handle->isPingPong == 0) return IS_FULL;
+
+    if (IS_FULL) return 1;
+    if (handle->spareState == WEARLEVELING_LIB_SPARE_ERASED) return 0;
+    return wearleveling_scheduler_isAboveThreshold(pState, handle);
+}
+
+static uint8_t wearleveling_scheduler_doWork(wearleveling_scheduler_state_typeDef * const pState, wearleveling_handle_typeDef handle)
+{
+    if ((pState == NULL) || (handle == NULL)) return 0;
+    if (handle->isPingPong == 0) return wearleveling_v2_rollOver(handle, pState->params.pScratch);
+
+    /* compaction steps up to and including one erase, the rate limit counts erases */
+    const uint32_t NUM_OF_ERASES = wearleveling_v2_getNumOfErases(handle);
+    const uint16_t NUM_OF_TWO_BYTES = (uint16_t)(handle->params.pageCapacityInByte >> 1);
+    uint8_t isProgress = 0;
+
+    while (wearleveling_scheduler_hasWork(pState, handle) && (wearleveling_v2_getNumOfErases(handle) == NUM_OF_ERASES))
+    {
+        if (wearleveling_v2_compactStep(handle, NUM_OF_TWO_BYTES) == 0) break;
+        isProgress = 1;
+    }
+
+    return isProgress;
+}
+
+static uint8_t wearleveling_scheduler_isEraseAllowed(wearleveling_scheduler_state_typeDef * const pState, const uint32_t now)
+{
+    if (pState == NULL) return 0;
+    if (pState->numOfErases == 0) return 1;
+    return (now - pState->lastEraseTime) >= pState->params.minEraseInterval ? 1 : 0;
+}
+
+static wearleveling_scheduler_entry_typeDef * wearleveling_scheduler_pickEntry(wearleveling_scheduler_state_typeDef * const pState)
+{
+    if (pState == NULL) return NULL;
+
+    wearleveling_scheduler_entry_typeDef * pPicked = NULL;
+    uint16_t pickedFreeBuckets = 0;
+
+    /* fewest free buckets first, the oldest request wins a tie */
+    for(uint16_t i = 0; i < pState->numOfEntries; i++)
+    {
+        wearleveling_scheduler_entry_typeDef * const pEntry = &pState->pEntries[i];
+        if (pEntry->isQueued == 0) continue;
+
+        const uint16_t FREE_BUCKETS = wearleveling_v2_getNumOfFreeBuckets(pEntry->handle);
+        if ((pPicked == NULL) || (FREE_BUCKETS < pickedFreeBuckets) ||
+            ((FREE_BUCKETS == pickedFreeBuckets) && ((int32_t)(pEntry->enqueueTime - pPicked->enqueueTime) < 0)))
+        {
+            pPicked = pEntry;
+            pickedFreeBuckets = FREE_BUCKETS;
+        }
+    }
+
+    return pPicked;
+}
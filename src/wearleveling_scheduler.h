@@ -0,0 +1,63 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "wearleveling.h"
+
+//
+// Device level erase scheduler. Handles sharing one flash device register
+// here and their erases are run from wearleveling_scheduler_run(), one at
+// a time, when the caller reports the bus idle. Time is in whatever unit
+// the caller passes as "now".
+//
+// Ping-pong handles are queued once the active sector is
+// fillThresholdInPercent full and the spare still needs its erase, or when
+// the active sector is full; the run drives wearleveling_v2_compactStep()
+// up to one erase, so the switch in the save does not erase. A single page
+// handle is only queued when it is full: rolling it over then costs the
+// erase its next save would pay anyway, earlier it would waste buckets.
+//
+typedef struct
+{
+    uint8_t fillThresholdInPercent;                 /* ping-pong handles only */
+    uint32_t minEraseInterval;
+    uint8_t * pScratch;
+    uint16_t scratchSizeInByte;
+}wearleveling_scheduler_params_typeDef;
+
+typedef struct
+{
+    wearleveling_handle_typeDef handle;
+    uint32_t enqueueTime;
+    uint8_t isQueued;
+}wearleveling_scheduler_entry_typeDef;
+
+typedef struct
+{
+    wearleveling_scheduler_params_typeDef params;
+    wearleveling_scheduler_entry_typeDef * pEntries;
+    uint16_t capacity;
+    uint16_t numOfEntries;
+    uint16_t queueDepth;
+    uint16_t maxQueueDepth;
+    uint32_t lastEraseTime;
+    uint32_t worstCaseWait;
+    uint32_t numOfErases;
+}wearleveling_scheduler_state_typeDef;
+
+typedef wearleveling_scheduler_state_typeDef* wearleveling_scheduler_handle_typeDef;
+
+wearleveling_scheduler_handle_typeDef wearleveling_scheduler_construct(wearleveling_scheduler_state_typeDef * const pState, wearleveling_scheduler_params_typeDef * const pParam, wearleveling_scheduler_entry_typeDef * const pEntries, const uint16_t capacity);
+uint8_t wearleveling_scheduler_register(wearleveling_scheduler_handle_typeDef scheduler, wearleveling_handle_typeDef handle);
+uint8_t wearleveling_scheduler_run(wearleveling_scheduler_handle_typeDef scheduler, const uint32_t now, const uint8_t isBusIdle);
+uint16_t wearleveling_scheduler_getQueueDepth(wearleveling_scheduler_handle_typeDef scheduler);
+uint16_t wearleveling_scheduler_getMaxQueueDepth(wearleveling_scheduler_handle_typeDef scheduler);
+uint32_t wearleveling_scheduler_getWorstCaseWait(wearleveling_scheduler_handle_typeDef scheduler);
+uint32_t wearleveling_scheduler_getNumOfErases(wearleveling_scheduler_handle_typeDef scheduler);
+
+#ifdef __cplusplus
+}
+#endif
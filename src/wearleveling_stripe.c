@@ -0,0 +1,168 @@
+#include <string.h>
+#include "wearleveling_stripe.h"
+
+#ifdef WEARLEVELING_BACKEND_HEADER
+#error "striping needs a store per device, a compile time backend binds a single one"
+#endif
+
+#define WEARLEVELING_STRIPE_SEQUENCE_SIZE       (2U)
+
+static void wearleveling_stripe_prepareRecord(wearleveling_stripe_state_typeDef * const pState, const uint16_t sequence, const uint8_t * const pData);
+static void wearleveling_stripe_setNewest(wearleveling_stripe_state_typeDef * const pState, const uint16_t index, const uint16_t sequence);
+static void wearleveling_stripe_onSaveDone(void * pContext, uint8_t isSuccess);
+
+wearleveling_stripe_handle_typeDef
+wearleveling_stripe_construct(wearleveling_stripe_state_typeDef * const pState, const wearleveling_stripe_params_typeDef * const pParam)
+{
+    if ((pState == NULL) || (pParam == NULL)) return NULL;
+    if ((pParam->pHandles == NULL) || (pParam->numOfHandles == 0) || (pParam->pScratch == NULL)) return NULL;
+
+    const uint16_t MEMBER_DATA_SIZE = pParam->pHandles[0] == NULL ? 0 : pParam->pHandles[0]->params.dataSizeInByte;
+    if (MEMBER_DATA_SIZE <= WEARLEVELING_STRIPE_SEQUENCE_SIZE) return NULL;
+
+    memset((void *)pState, 0, sizeof(wearleveling_stripe_state_typeDef));
+    pState->params = *pParam;
+    pState->dataSizeInByte = (uint16_t)(MEMBER_DATA_SIZE - WEARLEVELING_STRIPE_SEQUENCE_SIZE);
+
+    /* newest record over all members, sequences compare with wrap around */
+    for(uint16_t i = 0; i < pParam->numOfHandles; i++)
+    {
+        wearleveling_handle_typeDef handle = pParam->pHandles[i];
+        if (handle == NULL) return NULL;
+        if (handle->params.dataSizeInByte != MEMBER_DATA_SIZE) return NULL;
+
+        /* a lazily constructed member is mounted first, its write index says whether it holds a record */
+        if (wearleveling_v2_mount(handle) == 0) return NULL;
+        if (handle->indexBucketWrite == 0) continue;
+        if (wearleveling_v2_read(handle, pParam->pScratch) == 0) return NULL;
+
+        const uint16_t SEQUENCE = (uint16_t)(pParam->pScratch[0] | (pParam->pScratch[1] << 8));
+        if (pState->hasRecord && ((int16_t)(SEQUENCE - pState->sequence) <= 0)) continue;
+        wearleveling_stripe_setNewest(pState, i, SEQUENCE);
+    }
+
+    pState->submitSequence = pState->sequence;
+    pState->indexNext = pState->hasRecord ? (uint16_t)((pState->indexNewest + 1) % pParam->numOfHandles) : 0;
+
+    if (pParam->pSlots != NULL)
+    {
+        for(uint16_t i = 0; i < pParam->numOfHandles; i++)
+        {
+            pParam->pSlots[i].pStripe = pState;
+            pParam->pSlots[i].index = i;
+        }
+    }
+
+    return (wearleveling_stripe_handle_typeDef)pState;
+}
+
+uint8_t wearleveling_stripe_save(wearleveling_stripe_handle_typeDef stripe, const uint8_t * const pData)
+{
+    if ((stripe == NULL) || (pData == NULL)) return 0;
+
+    const uint16_t INDEX = stripe->indexNext;
+    wearleveling_handle_typeDef handle = stripe->params.pHandles[INDEX];
+    if (wearleveling_v2_isBusy(handle)) return 0;
+
+    const uint16_t SEQUENCE = (uint16_t)(stripe->submitSequence + 1);
+    wearleveling_stripe_prepareRecord(stripe, SEQUENCE, pData);
+    if (wearleveling_v2_save(handle, stripe->params.pScratch) == 0) return 0;
+
+    stripe->submitSequence = SEQUENCE;
+    stripe->indexNext = (uint16_t)((INDEX + 1) % stripe->params.numOfHandles);
+    wearleveling_stripe_setNewest(stripe, INDEX, SEQUENCE);
+    return 1;
+}
+
+uint8_t wearleveling_stripe_saveAsync(wearleveling_stripe_handle_typeDef stripe, const uint8_t * const pData, wearleveling_done_callback_typeDef done, void * pContext)
+{
+    if ((stripe == NULL) || (pData == NULL)) return 0;
+    if (stripe->params.pSlots == NULL) return 0;
+
+    const uint16_t INDEX = stripe->indexNext;
+    wearleveling_handle_typeDef handle = stripe->params.pHandles[INDEX];
+    if (wearleveling_v2_isBusy(handle)) return 0;
+
+    /* the erase would take the newest record with it while the others are still in flight */
+    if ((stripe->params.numOfHandles > 1) && stripe->hasRecord && (INDEX == stripe->indexNewest) && wearleveling_stripe_isBusy(stripe))
+    {
+        if (wearleveling_v2_getNumOfFreeBuckets(handle) == 0) return 0;
+    }
+
+    wearleveling_stripe_slot_typeDef * const pSlot = &stripe->params.pSlots[INDEX];
+    const uint16_t SEQUENCE = (uint16_t)(stripe->submitSequence + 1);
+    pSlot->sequence = SEQUENCE;
+    pSlot->done = done;
+    pSlot->pContext = pContext;
+
+    /* the member copies the record, the scratch is free again on return */
+    wearleveling_stripe_prepareRecord(stripe, SEQUENCE, pData);
+    if (wearleveling_v2_saveAsync(handle, stripe->params.pScratch, wearleveling_stripe_onSaveDone, pSlot) == 0) return 0;
+
+    stripe->submitSequence = SEQUENCE;
+    stripe->indexNext = (uint16_t)((INDEX + 1) % stripe->params.numOfHandles);
+    return 1;
+}
+
+uint8_t wearleveling_stripe_read(wearleveling_stripe_handle_typeDef stripe, uint8_t * const pData)
+{
+    if ((stripe == NULL) || (pData == NULL)) return 0;
+    if (stripe->hasRecord == 0) return 0;
+
+    if (wearleveling_v2_read(stripe->params.pHandles[stripe->indexNewest], stripe->params.pScratch) == 0) return 0;
+    memcpy(pData, stripe->params.pScratch + WEARLEVELING_STRIPE_SEQUENCE_SIZE, stripe->dataSizeInByte);
+    return 1;
+}
+
+uint8_t wearleveling_stripe_isBusy(wearleveling_stripe_handle_typeDef stripe)
+{
+    if (stripe == NULL) return 0;
+
+    for(uint16_t i = 0; i < stripe->params.numOfHandles; i++)
+    {
+        if (wearleveling_v2_isBusy(stripe->params.pHandles[i])) return 1;
+    }
+
+    return 0;
+}
+
+uint32_t wearleveling_stripe_getEraseWriteCycleMultiplier(wearleveling_stripe_handle_typeDef stripe)
+{
+    if (stripe == NULL) return 0;
+
+    uint32_t multiplier = 0;
+    for(uint16_t i = 0; i < stripe->params.numOfHandles; i++)
+    {
+        multiplier += wearleveling_v2_getEraseWriteCycleMultiplier(stripe->params.pHandles[i]);
+    }
+
+    return multiplier;
+}
+
+static void wearleveling_stripe_prepareRecord(wearleveling_stripe_state_typeDef * const pState, const uint16_t sequence, const uint8_t * const pData)
+{
+    pState->params.pScratch[0] = (uint8_t)sequence;
+    pState->params.pScratch[1] = (uint8_t)(sequence >> 8);
+    memcpy(pState->params.pScratch + WEARLEVELING_STRIPE_SEQUENCE_SIZE, pData, pState->dataSizeInByte);
+}
+
+static void wearleveling_stripe_setNewest(wearleveling_stripe_state_typeDef * const pState, const uint16_t index, const uint16_t sequence)
+{
+    pState->indexNewest = index;
+    pState->sequence = sequence;
+    pState->hasRecord = 1;
+}
+
+static void wearleveling_stripe_onSaveDone(void * pContext, uint8_t isSuccess)
+{
+    wearleveling_stripe_slot_typeDef * const pSlot = (wearleveling_stripe_slot_typeDef *)pContext;
+    wearleveling_stripe_state_typeDef * const pState = (wearleveling_stripe_state_typeDef *)pSlot->pStripe;
+
+    /* devices finish in any order, an older record never replaces a newer one */
+    if (isSuccess && ((pState->hasRecord == 0) || ((int16_t)(pSlot->sequence - pState->sequence) > 0)))
+    {
+        wearleveling_stripe_setNewest(pState, pSlot->index, pSlot->sequence);
+    }
+
+    if (pSlot->done != NULL) pSlot->done(pSlot->pContext, isSuccess);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "wearleveling.h"
+
+//
+// One store striped over several flash devices. Every member is a handle
+// of its own, with the callbacks (and async driver) of its device; saves
+// go round robin over the members, each record prefixed with a sequence
+// number so a mount finds the newest one again:
+//
+//   member record: [sequence low][sequence high][data ...]
+//
+// A member page fills numOfHandles times slower, and with async drivers
+// the saves on different devices are in flight at the same time. An async
+// save is refused while its member would have to erase the newest record.
+//
+typedef struct
+{
+    void * pStripe;
+    uint16_t index;
+    uint16_t sequence;
+    wearleveling_done_callback_typeDef done;
+    void * pContext;
+}wearleveling_stripe_slot_typeDef;
+
+typedef struct
+{
+    wearleveling_handle_typeDef * pHandles;         /* dataSizeInByte == 2 + record size, all the same */
+    uint16_t numOfHandles;
+    uint8_t * pScratch;                             /* member dataSizeInByte bytes */
+    wearleveling_stripe_slot_typeDef * pSlots;      /* numOfHandles entries, NULL without async saves */
+}wearleveling_stripe_params_typeDef;
+
+typedef struct
+{
+    wearleveling_stripe_params_typeDef params;
+    uint16_t dataSizeInByte;
+    uint16_t sequence;
+    uint16_t submitSequence;
+    uint16_t indexNewest;
+    uint16_t indexNext;
+    uint8_t hasRecord;
+}wearleveling_stripe_state_typeDef;
+
+typedef wearleveling_stripe_state_typeDef* wearleveling_stripe_handle_typeDef;
+
+wearleveling_stripe_handle_typeDef wearleveling_stripe_construct(wearleveling_stripe_state_typeDef * const pState, const wearleveling_stripe_params_typeDef * const pParam);
+uint8_t wearleveling_stripe_save(wearleveling_stripe_handle_typeDef stripe, const uint8_t * const pData);
+uint8_t wearleveling_stripe_saveAsync(wearleveling_stripe_handle_typeDef stripe, const uint8_t * const pData, wearleveling_done_callback_typeDef done, void * pContext);
+uint8_t wearleveling_stripe_read(wearleveling_stripe_handle_typeDef stripe, uint8_t * const pData);
+uint8_t wearleveling_stripe_isBusy(wearleveling_stripe_handle_typeDef stripe);
+uint32_t wearleveling_stripe_getEraseWriteCycleMultiplier(wearleveling_stripe_handle_typeDef stripe);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,140 @@
+#include <string.h>
+#include "wearleveling_throttle.h"
+
+#define WEARLEVELING_THROTTLE_MILLI             (1000U)
+#define WEARLEVELING_THROTTLE_MAX               ((uint32_t)0xFFFFFFFF)
+
+static void wearleveling_throttle_refill(wearleveling_throttle_state_typeDef * const pState);
+static uint8_t wearleveling_throttle_writePending(wearleveling_throttle_state_typeDef * const pState);
+static uint32_t wearleveling_throttle_saturate(const uint64_t value);
+
+wearleveling_throttle_handle_typeDef
+wearleveling_throttle_construct(wearleveling_throttle_state_typeDef * const pState, wearleveling_handle_typeDef handle, const wearleveling_throttle_params_typeDef * const pParam)
+{
+    if ((pState == NULL) || (handle == NULL) || (pParam == NULL)) return NULL;
+    if ((pParam->getTimeInSecond == NULL) || (pParam->pPending == NULL)) return NULL;
+    if ((pParam->ratedCycles == 0) || (pParam->targetLifetimeInSecond == 0)) return NULL;
+
+    memset((void *)pState, 0, sizeof(wearleveling_throttle_state_typeDef));
+    pState->params = *pParam;
+    pState->handle = handle;
+
+    /* every erase buys a page of saves, a ping-pong store has two sectors to wear */
+    const uint64_t NUM_OF_SECTORS = handle->isPingPong ? 2U : 1U;
+    const uint64_t NUM_OF_SAVES = (uint64_t)pParam->ratedCycles * handle->numOfBuckets * NUM_OF_SECTORS;
+    pState->budgetInMilliPerSecond = wearleveling_throttle_saturate((NUM_OF_SAVES * WEARLEVELING_THROTTLE_MILLI) / pParam->targetLifetimeInSecond);
+    if (pState->budgetInMilliPerSecond == 0) pState->budgetInMilliPerSecond = 1;
+
+    pState->maxTokensInMilli = wearleveling_throttle_saturate((uint64_t)handle->numOfBuckets * WEARLEVELING_THROTTLE_MILLI);
+    pState->tokensInMilli = pState->maxTokensInMilli;
+    pState->lastTime = pParam->getTimeInSecond();
+
+    return (wearleveling_throttle_handle_typeDef)pState;
+}
+
+uint8_t wearleveling_throttle_save(wearleveling_throttle_handle_typeDef throttle, uint8_t * const pData)
+{
+    if ((throttle == NULL) || (pData == NULL)) return 0;
+
+    wearleveling_throttle_refill(throttle);
+
+    if (throttle->tokensInMilli >= WEARLEVELING_THROTTLE_MILLI)
+    {
+        if (wearleveling_v2_save(throttle->handle, pData) == 0) return 0;
+
+        /* anything coalesced before is older than this one */
+        throttle->tokensInMilli -= WEARLEVELING_THROTTLE_MILLI;
+        throttle->isPending = 0;
+        return 1;
+    }
+
+    /* over budget, the newest save waits in RAM */
+    if (throttle->isPending) throttle->numOfCoalesced++;
+    memcpy(throttle->params.pPending, pData, throttle->handle->params.dataSizeInByte);
+    throttle->isPending = 1;
+    throttle->numOfThrottled++;
+    return 1;
+}
+
+uint8_t wearleveling_throttle_read(wearleveling_throttle_handle_typeDef throttle, uint8_t * const pData)
+{
+    if ((throttle == NULL) || (pData == NULL)) return 0;
+
+    if (throttle->isPending)
+    {
+        memcpy(pData, throttle->params.pPending, throttle->handle->params.dataSizeInByte);
+        return 1;
+    }
+
+    return wearleveling_v2_read(throttle->handle, pData);
+}
+
+uint8_t wearleveling_throttle_run(wearleveling_throttle_handle_typeDef throttle)
+{
+    if (throttle == NULL) return 0;
+
+    wearleveling_throttle_refill(throttle);
+    if (throttle->isPending == 0) return 1;
+    if (throttle->tokensInMilli < WEARLEVELING_THROTTLE_MILLI) return 1;
+
+    if (wearleveling_throttle_writePending(throttle) == 0) return 0;
+    throttle->tokensInMilli -= WEARLEVELING_THROTTLE_MILLI;
+    return 1;
+}
+
+uint8_t wearleveling_throttle_flush(wearleveling_throttle_handle_typeDef throttle)
+{
+    if (throttle == NULL) return 0;
+
+    wearleveling_throttle_refill(throttle);
+    if (throttle->isPending == 0) return 1;
+
+    /* forced out, the budget may go short for a while */
+    if (wearleveling_throttle_writePending(throttle) == 0) return 0;
+    throttle->tokensInMilli = throttle->tokensInMilli > WEARLEVELING_THROTTLE_MILLI ? throttle->tokensInMilli - WEARLEVELING_THROTTLE_MILLI : 0;
+    return 1;
+}
+
+uint8_t wearleveling_throttle_isPending(wearleveling_throttle_handle_typeDef throttle)
+{
+    return throttle == NULL ? 0 : throttle->isPending;
+}
+
+uint32_t wearleveling_throttle_getBudgetInMilliPerSecond(wearleveling_throttle_handle_typeDef throttle)
+{
+    return throttle == NULL ? 0 : throttle->budgetInMilliPerSecond;
+}
+
+uint32_t wearleveling_throttle_getNumOfThrottled(wearleveling_throttle_handle_typeDef throttle)
+{
+    return throttle == NULL ? 0 : throttle->numOfThrottled;
+}
+
+uint32_t wearleveling_throttle_getNumOfCoalesced(wearleveling_throttle_handle_typeDef throttle)
+{
+    return throttle == NULL ? 0 : throttle->numOfCoalesced;
+}
+
+static void wearleveling_throttle_refill(wearleveling_throttle_state_typeDef * const pState)
+{
+    const uint32_t NOW = pState->params.getTimeInSecond();
+    const uint32_t ELAPSED = NOW - pState->lastTime;
+    if (ELAPSED == 0) return;
+    pState->lastTime = NOW;
+
+    const uint64_t TOKENS = (uint64_t)pState->tokensInMilli + ((uint64_t)ELAPSED * pState->budgetInMilliPerSecond);
+    pState->tokensInMilli = TOKENS > pState->maxTokensInMilli ? pState->maxTokensInMilli : (uint32_t)TOKENS;
+}
+
+static uint8_t wearleveling_throttle_writePending(wearleveling_throttle_state_typeDef * const pState)
+{
+    if (wearleveling_v2_save(pState->handle, pState->params.pPending) == 0) return 0;
+
+    pState->isPending = 0;
+    return 1;
+}
+
+static uint32_t wearleveling_throttle_saturate(const uint64_t value)
+{
+    return value > WEARLEVELING_THROTTLE_MAX ? WEARLEVELING_THROTTLE_MAX : (uint32_t)value;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "wearleveling.h"
+
+//
+// Endurance budget for a store. The rated erase cycles spread over the
+// target lifetime give the saves per second the store can afford; saves
+// beyond that budget are coalesced in RAM, only the newest is kept and
+// programmed once wearleveling_throttle_run() finds budget again, or when
+// the caller forces it out with wearleveling_throttle_flush() (before a
+// shutdown, say). Up to one page of saves may be spent in a burst.
+//
+// Deferred and coalesced saves are counted, one throttle per caller makes
+// the offending one easy to find.
+//
+typedef struct
+{
+    uint32_t ratedCycles;                   /* per sector, from the datasheet */
+    uint32_t targetLifetimeInSecond;
+    uint32_t (*getTimeInSecond) (void);
+    uint8_t * pPending;                     /* dataSizeInByte bytes, the newest coalesced save */
+}wearleveling_throttle_params_typeDef;
+
+typedef struct
+{
+    wearleveling_throttle_params_typeDef params;
+    wearleveling_handle_typeDef handle;
+    uint32_t budgetInMilliPerSecond;
+    uint32_t tokensInMilli;
+    uint32_t maxTokensInMilli;
+    uint32_t lastTime;
+    uint32_t numOfThrottled;
+    uint32_t numOfCoalesced;
+    uint8_t isPending;
+}wearleveling_throttle_state_typeDef;
+
+typedef wearleveling_throttle_state_typeDef* wearleveling_throttle_handle_typeDef;
+
+wearleveling_throttle_handle_typeDef wearleveling_throttle_construct(wearleveling_throttle_state_typeDef * const pState, wearleveling_handle_typeDef handle, const wearleveling_throttle_params_typeDef * const pParam);
+uint8_t wearleveling_throttle_save(wearleveling_throttle_handle_typeDef throttle, uint8_t * const pData);
+uint8_t wearleveling_throttle_read(wearleveling_throttle_handle_typeDef throttle, uint8_t * const pData);
+uint8_t wearleveling_throttle_run(wearleveling_throttle_handle_typeDef throttle);
+uint8_t wearleveling_throttle_flush(wearleveling_throttle_handle_typeDef throttle);
+uint8_t wearleveling_throttle_isPending(wearleveling_throttle_handle_typeDef throttle);
+uint32_t wearleveling_throttle_getBudgetInMilliPerSecond(wearleveling_throttle_handle_typeDef throttle);
+uint32_t wearleveling_throttle_getNumOfThrottled(wearleveling_throttle_handle_typeDef throttle);
+uint32_t wearleveling_throttle_getNumOfCoalesced(wearleveling_throttle_handle_typeDef throttle);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,210 @@
+#include <string.h>
+#include "wearleveling_txn.h"
+
+#ifdef WEARLEVELING_BACKEND_HEADER
+#error "transactions need several stores, a compile time backend binds a single one"
+#endif
+
+#define WEARLEVELING_TXN_ADDR_TRANSACTION_ID    (0U)
+#define WEARLEVELING_TXN_ADDR_FIRST_INDEX       (2U)
+
+static uint16_t wearleveling_txn_getTwoByte(const uint8_t * const pRecord, const uint16_t offset);
+static void wearleveling_txn_putTwoByte(uint8_t * const pRecord, const uint16_t offset, const uint16_t twoByte);
+static uint16_t wearleveling_txn_getCommittedIndex(wearleveling_txn_state_typeDef * const pState, const uint16_t slot);
+static uint8_t wearleveling_txn_rollBack(wearleveling_txn_state_typeDef * const pState);
+static uint8_t wearleveling_txn_saveJournal(wearleveling_txn_state_typeDef * const pState, const uint16_t transactionId);
+static uint8_t wearleveling_txn_isParticipant(wearleveling_txn_state_typeDef * const pState, wearleveling_handle_typeDef handle);
+static uint8_t wearleveling_txn_mountAll(wearleveling_txn_state_typeDef * const pState);
+
+wearleveling_txn_handle_typeDef
+wearleveling_txn_construct(wearleveling_txn_state_typeDef * const pState, const wearleveling_txn_params_typeDef * const pParam)
+{
+    if ((pState == NULL) || (pParam == NULL)) return NULL;
+    if ((pParam->journal == NULL) || (pParam->pHandles == NULL) || (pParam->numOfHandles == 0)) return NULL;
+    if ((pParam->pJournalRecord == NULL) || (pParam->pScratch == NULL)) return NULL;
+    if (pParam->journal->params.dataSizeInByte != (WEARLEVELING_TXN_ADDR_FIRST_INDEX + (pParam->numOfHandles * 2))) return NULL;
+
+    memset((void *)pState, 0, sizeof(wearleveling_txn_state_typeDef));
+    pState->params = *pParam;
+    if (wearleveling_txn_mountAll(pState) == 0) return NULL;
+
+    /* nothing journaled yet, whatever the participants hold counts as committed */
+    if (pParam->journal->indexBucketWrite == 0)
+    {
+        pState->isJournalStale = 1;
+        return (wearleveling_txn_handle_typeDef)pState;
+    }
+
+    if (wearleveling_v2_read(pParam->journal, pParam->pJournalRecord) == 0) return NULL;
+    pState->transactionId = wearleveling_txn_getTwoByte(pParam->pJournalRecord, WEARLEVELING_TXN_ADDR_TRANSACTION_ID);
+    if (wearleveling_txn_rollBack(pState) == 0) return NULL;
+
+    return (wearleveling_txn_handle_typeDef)pState;
+}
+
+uint8_t wearleveling_txn_begin(wearleveling_txn_handle_typeDef txn)
+{
+    if (txn == NULL) return 0;
+    if (txn->isOpen) return 0;
+    if (wearleveling_txn_mountAll(txn) == 0) return 0;
+
+    for(uint16_t i = 0; i < txn->params.numOfHandles; i++)
+    {
+        wearleveling_handle_typeDef handle = txn->params.pHandles[i];
+        if (handle->indexBucketWrite == 0) return 0;
+
+        /* moved since the last journal (a compaction commit or a roll over from outside), journal again */
+        if (handle->indexBucketRead != wearleveling_txn_getCommittedIndex(txn, i)) txn->isJournalStale = 1;
+
+        /* a staged save must never erase the committed record it may have to fall back to */
+        if (wearleveling_v2_getNumOfFreeBuckets(handle) == 0)
+        {
+            if (wearleveling_v2_rollOver(handle, txn->params.pScratch) == 0) return 0;
+            txn->isJournalStale = 1;
+        }
+    }
+
+    if (txn->isJournalStale)
+    {
+        if (wearleveling_txn_saveJournal(txn, txn->transactionId) == 0) return 0;
+        txn->isJournalStale = 0;
+    }
+
+    txn->isOpen = 1;
+    return 1;
+}
+
+uint8_t wearleveling_txn_save(wearleveling_txn_handle_typeDef txn, wearleveling_handle_typeDef handle, uint8_t * const pData)
+{
+    if ((txn == NULL) || (handle == NULL) || (pData == NULL)) return 0;
+    if (txn->isOpen == 0) return 0;
+    if (wearleveling_txn_isParticipant(txn, handle) == 0) return 0;
+    if (wearleveling_v2_getNumOfFreeBuckets(handle) == 0) return 0;
+
+    return wearleveling_v2_save(handle, pData);
+}
+
+uint8_t wearleveling_txn_commit(wearleveling_txn_handle_typeDef txn)
+{
+    if (txn == NULL) return 0;
+    if (txn->isOpen == 0) return 0;
+
+    /* the one program that makes every staged record visible after a reset */
+    if (wearleveling_txn_saveJournal(txn, (uint16_t)(txn->transactionId + 1)) == 0)
+    {
+        /* keep the journal copy in RAM at the last commit, abort falls back to it */
+        wearleveling_v2_read(txn->params.journal, txn->params.pJournalRecord);
+        return 0;
+    }
+
+    txn->transactionId++;
+    txn->isOpen = 0;
+    return 1;
+}
+
+uint8_t wearleveling_txn_abort(wearleveling_txn_handle_typeDef txn)
+{
+    if (txn == NULL) return 0;
+    if (txn->isOpen == 0) return 0;
+
+    if (wearleveling_txn_rollBack(txn) == 0) return 0;
+    txn->isOpen = 0;
+    return 1;
+}
+
+uint16_t wearleveling_txn_getTransactionId(wearleveling_txn_handle_typeDef txn)
+{
+    return txn == NULL ? 0 : txn->transactionId;
+}
+
+uint16_t wearleveling_txn_getNumOfRolledBack(wearleveling_txn_handle_typeDef txn)
+{
+    return txn == NULL ? 0 : txn->numOfRolledBack;
+}
+
+static uint16_t wearleveling_txn_getTwoByte(const uint8_t * const pRecord, const uint16_t offset)
+{
+    return (uint16_t)(pRecord[offset] | (pRecord[offset + 1] << 8));
+}
+
+static void wearleveling_txn_putTwoByte(uint8_t * const pRecord, const uint16_t offset, const uint16_t twoByte)
+{
+    pRecord[offset] = (uint8_t)twoByte;
+    pRecord[offset + 1] = (uint8_t)(twoByte >> 8);
+}
+
+static uint16_t wearleveling_txn_getCommittedIndex(wearleveling_txn_state_typeDef * const pState, const uint16_t slot)
+{
+    return wearleveling_txn_getTwoByte(pState->params.pJournalRecord, (uint16_t)(WEARLEVELING_TXN_ADDR_FIRST_INDEX + (slot * 2)));
+}
+
+static uint8_t wearleveling_txn_rollBack(wearleveling_txn_state_typeDef * const pState)
+{
+    if (pState == NULL) return 0;
+
+    for(uint16_t i = 0; i < pState->params.numOfHandles; i++)
+    {
+        wearleveling_handle_typeDef handle = pState->params.pHandles[i];
+        const uint16_t COMMITTED_INDEX = wearleveling_txn_getCommittedIndex(pState, i);
+
+        /* an unmounted participant would look empty and keep its staged records */
+        if (wearleveling_v2_mount(handle) == 0) return 0;
+        if (handle->indexBucketWrite == 0) continue;
+
+        /* behind the journal: rolled over after the commit, the newest record is the committed one */
+        if (handle->indexBucketRead < COMMITTED_INDEX)
+        {
+            pState->isJournalStale = 1;
+            continue;
+        }
+
+        if (handle->indexBucketRead == COMMITTED_INDEX) continue;
+
+        /* the staged buckets stay used, the next save goes after them */
+        handle->indexBucketRead = COMMITTED_INDEX;
+        handle->generation++;
+        pState->numOfRolledBack++;
+        if (handle->pReadCache != NULL) wearleveling_v2_setReadCache(handle, handle->pReadCache);
+    }
+
+    return 1;
+}
+
+static uint8_t wearleveling_txn_saveJournal(wearleveling_txn_state_typeDef * const pState, const uint16_t transactionId)
+{
+    if (pState == NULL) return 0;
+
+    uint8_t * const pRecord = pState->params.pJournalRecord;
+    wearleveling_txn_putTwoByte(pRecord, WEARLEVELING_TXN_ADDR_TRANSACTION_ID, transactionId);
+    for(uint16_t i = 0; i < pState->params.numOfHandles; i++)
+    {
+        wearleveling_txn_putTwoByte(pRecord, (uint16_t)(WEARLEVELING_TXN_ADDR_FIRST_INDEX + (i * 2)), pState->params.pHandles[i]->indexBucketRead);
+    }
+
+    return wearleveling_v2_save(pState->params.journal, pRecord);
+}
+
+static uint8_t wearleveling_txn_isParticipant(wearleveling_txn_state_typeDef * const pState, wearleveling_handle_typeDef handle)
+{
+    if (pState == NULL) return 0;
+
+    for(uint16_t i = 0; i < pState->params.numOfHandles; i++)
+    {
+        if (pState->params.pHandles[i] == handle) return 1;
+    }
+
+    return 0;
+}
+
+static uint8_t wearleveling_txn_mountAll(wearleveling_txn_state_typeDef * const pState)
+{
+    if (pState == NULL) return 0;
+    if (wearleveling_v2_mount(pState->params.journal) == 0) return 0;
+
+    for(uint16_t i = 0; i < pState->params.numOfHandles; i++)
+    {
+        if (wearleveling_v2_mount(pState->params.pHandles[i]) == 0) return 0;
+    }
+
+    return 1;
+}
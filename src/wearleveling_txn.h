@@ -0,0 +1,60 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "wearleveling.h"
+
+//
+// Transactions over several handles. Records are staged with plain saves
+// on the participants; commit is one save on a journal handle, holding the
+// transaction id and, per participant, the bucket index of its newest
+// committed record:
+//
+//   journal record: [transaction id][bucket index 0][bucket index 1] ...
+//
+// At construct, a participant whose newest record lies past the journaled
+// index is rolled back to it. A participant can not roll back across an
+// erase, so begin rolls full participants over (and journals the moved
+// records) before anything is staged. The journal itself should be a
+// ping-pong handle, a single page loses its record during its own erase.
+//
+// Participants must hold a record before their first transaction and be
+// written through this module only. Lazily constructed handles are
+// mounted by construct and begin. A participant compacted or rolled over
+// between transactions is journaled again by the next begin; none may be
+// compacted while a transaction is open.
+//
+typedef struct
+{
+    wearleveling_handle_typeDef journal;            /* dataSizeInByte == 2 + 2 * numOfHandles */
+    wearleveling_handle_typeDef * pHandles;
+    uint16_t numOfHandles;
+    uint8_t * pJournalRecord;                       /* journal dataSizeInByte bytes */
+    uint8_t * pScratch;                             /* largest participant dataSizeInByte bytes */
+}wearleveling_txn_params_typeDef;
+
+typedef struct
+{
+    wearleveling_txn_params_typeDef params;
+    uint16_t transactionId;
+    uint16_t numOfRolledBack;
+    uint8_t isJournalStale;
+    uint8_t isOpen;
+}wearleveling_txn_state_typeDef;
+
+typedef wearleveling_txn_state_typeDef* wearleveling_txn_handle_typeDef;
+
+wearleveling_txn_handle_typeDef wearleveling_txn_construct(wearleveling_txn_state_typeDef * const pState, const wearleveling_txn_params_typeDef * const pParam);
+uint8_t wearleveling_txn_begin(wearleveling_txn_handle_typeDef txn);
+uint8_t wearleveling_txn_save(wearleveling_txn_handle_typeDef txn, wearleveling_handle_typeDef handle, uint8_t * const pData);
+uint8_t wearleveling_txn_commit(wearleveling_txn_handle_typeDef txn);
+uint8_t wearleveling_txn_abort(wearleveling_txn_handle_typeDef txn);
+uint16_t wearleveling_txn_getTransactionId(wearleveling_txn_handle_typeDef txn);
+uint16_t wearleveling_txn_getNumOfRolledBack(wearleveling_txn_handle_typeDef txn);
+
+#ifdef __cplusplus
+}
+#endif
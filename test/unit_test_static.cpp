@@ -0,0 +1,116 @@
+#include <stdint.h>
+#include <string.h>
+#include "gtest/gtest.h"
+#include "wearleveling.h"
+#include "mem_backend.h"
+
+//
+// The library built with WEARLEVELING_BACKEND_HEADER="mem_backend.h": the
+// flash callbacks in the params are left NULL, a call through one of them
+// would crash the test.
+//
+uint8_t mem_flash[MEM_BACKEND_MAX_PAGE_SIZE];
+uint32_t mem_flashSize;
+
+static uint8_t mock_sectorErase64(uint32_t addr)
+{
+    if ((addr + 64) > mem_flashSize) return 0;
+    memset(&mem_flash[addr], 0xFF, 64);
+    return 1;
+}
+
+namespace wearlevelingStaticBackendTest
+{
+    class wearlevelingStaticBackendTest:public::testing::Test
+    {
+        protected:
+
+            virtual void SetUp()
+            {
+                mem_flashSize = 64;
+                memset(mem_flash, 0xFF, sizeof(mem_flash));
+            }
+
+            virtual void TearDown()
+            {
+            }
+    };
+
+    TEST_F(wearlevelingStaticBackendTest, single_page)
+    {
+        /* 10 buckets: the format at construct and 9 roll overs in 100 saves */
+        wearleveling_params_typeDef params =
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 5,
+            .readTwoByte = NULL,
+            .writeTwoByte = NULL,
+            .pageErase = NULL,
+        };
+
+        uint8_t dummy_data [5] = { 0 };
+        uint8_t dummy_data_read [5] = { 0 };
+
+        wearleveling_state_typeDef wearlevelingState;
+        wearleveling_state_typeDef remountState;
+        wearleveling_handle_typeDef handle = wearleveling_v2_construct(&wearlevelingState, &params);
+        ASSERT_NE((wearleveling_handle_typeDef)NULL, handle);
+        ASSERT_EQ(0x34, mem_flash[0]);
+        ASSERT_EQ(0x12, mem_flash[1]);
+
+        for(uint16_t i = 0; i < 100; i++)
+        {
+            dummy_data[0] = (uint8_t)i;
+            dummy_data[4] = (uint8_t)(i * 3);
+            ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data));
+
+            wearleveling_handle_typeDef remount = wearleveling_v2_construct(&remountState, &params);
+            ASSERT_EQ(1, wearleveling_v2_read(remount, dummy_data_read));
+            ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+        }
+
+        ASSERT_EQ(10U, wearleveling_v2_getNumOfErases(handle));
+    }
+
+    TEST_F(wearlevelingStaticBackendTest, ping_pong)
+    {
+        /* both sectors in the backend page, sectorErase stays a pointer */
+        wearleveling_params_typeDef params =
+        {
+            .pageCapacityInByte = 64,
+            .dataSizeInByte = 6,
+            .readTwoByte = NULL,
+            .writeTwoByte = NULL,
+            .pageErase = NULL,
+        };
+
+        wearleveling_sector_params_typeDef sectorParams =
+        {
+            .spareSectorAddr = 64,
+            .sectorErase = mock_sectorErase64,
+        };
+
+        uint8_t dummy_data [6] = { 0 };
+        uint8_t dummy_data_read [6] = { 0 };
+
+        mem_flashSize = 128;
+        wearleveling_state_typeDef wearlevelingState;
+        wearleveling_handle_typeDef handle = wearleveling_v2_constructPingPong(&wearlevelingState, &params, &sectorParams);
+        ASSERT_NE((wearleveling_handle_typeDef)NULL, handle);
+
+        for(uint16_t i = 0; i < 100; i++)
+        {
+            dummy_data[0] = (uint8_t)i;
+            dummy_data[5] = (uint8_t)(i >> 8);
+            ASSERT_EQ(1, wearleveling_v2_save(handle, dummy_data));
+            while (wearleveling_v2_compactStep(handle, 2));
+
+            handle = wearleveling_v2_constructPingPong(&wearlevelingState, &params, &sectorParams);
+            ASSERT_EQ(1, wearleveling_v2_read(handle, dummy_data_read));
+            ASSERT_EQ(0, memcmp(dummy_data, dummy_data_read, sizeof(dummy_data)));
+        }
+
+        ASSERT_NE(0, handle->sequence);
+        ASSERT_EQ(0U, wearleveling_v2_getNumOfForegroundErases(handle));
+    }
+}